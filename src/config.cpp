@@ -28,6 +28,55 @@ Config Config::load(const std::string& path) {
             if (v.contains("height")) config.video.height = v["height"].get<int>();
             if (v.contains("fps")) config.video.fps = v["fps"].get<int>();
             if (v.contains("reconnect_delay_ms")) config.video.reconnect_delay_ms = v["reconnect_delay_ms"].get<int>();
+            if (v.contains("low_latency")) config.video.low_latency = v["low_latency"].get<bool>();
+            if (v.contains("max_latency_ms")) config.video.max_latency_ms = v["max_latency_ms"].get<int>();
+            if (v.contains("main_source")) config.video.main_source = v["main_source"].get<std::string>();
+            if (v.contains("main_width")) config.video.main_width = v["main_width"].get<int>();
+            if (v.contains("main_height")) config.video.main_height = v["main_height"].get<int>();
+            if (v.contains("switch_zoom")) config.video.switch_zoom = v["switch_zoom"].get<float>();
+            if (v.contains("switch_band")) config.video.switch_band = v["switch_band"].get<float>();
+            if (v.contains("warm_frames")) config.video.warm_frames = v["warm_frames"].get<int>();
+            
+            if (v.contains("lens")) {
+                auto& l = v["lens"];
+                if (l.contains("enabled")) config.video.lens.enabled = l["enabled"].get<bool>();
+                if (l.contains("width")) config.video.lens.width = l["width"].get<int>();
+                if (l.contains("height")) config.video.lens.height = l["height"].get<int>();
+                if (l.contains("steps_per_doubling")) config.video.lens.steps_per_doubling = l["steps_per_doubling"].get<int>();
+                if (l.contains("cache_tables")) config.video.lens.cache_tables = l["cache_tables"].get<int>();
+                if (l.contains("alpha")) config.video.lens.alpha = l["alpha"].get<double>();
+                
+                if (l.contains("calibration")) {
+                    for (auto& c : l["calibration"]) {
+                        LensCalibration lc;
+                        if (c.contains("zoom")) lc.zoom = c["zoom"].get<float>();
+                        if (c.contains("fx")) lc.fx = c["fx"].get<double>();
+                        if (c.contains("fy")) lc.fy = c["fy"].get<double>();
+                        if (c.contains("cx")) lc.cx = c["cx"].get<double>();
+                        if (c.contains("cy")) lc.cy = c["cy"].get<double>();
+                        if (c.contains("distortion")) lc.distortion = c["distortion"].get<std::vector<double>>();
+                        config.video.lens.calibration.push_back(lc);
+                    }
+                }
+            }
+        }
+        
+        // File playback config
+        if (j.contains("playback")) {
+            auto& p = j["playback"];
+            if (p.contains("enabled")) config.playback.enabled = p["enabled"].get<bool>();
+            if (p.contains("loop")) config.playback.loop = p["loop"].get<bool>();
+            if (p.contains("speed")) config.playback.speed = p["speed"].get<double>();
+            if (p.contains("decode_ahead")) config.playback.decode_ahead = p["decode_ahead"].get<int>();
+            if (p.contains("seek_step")) config.playback.seek_step = p["seek_step"].get<double>();
+        }
+        
+        // Frame bus config
+        if (j.contains("frame_bus")) {
+            auto& fb = j["frame_bus"];
+            if (fb.contains("enabled")) config.frame_bus.enabled = fb["enabled"].get<bool>();
+            if (fb.contains("name")) config.frame_bus.name = fb["name"].get<std::string>();
+            if (fb.contains("slots")) config.frame_bus.slots = fb["slots"].get<int>();
         }
         
         // Joystick config
@@ -60,6 +109,7 @@ Config Config::load(const std::string& path) {
             if (h.contains("show_telemetry")) config.hud.show_telemetry = h["show_telemetry"].get<bool>();
             if (h.contains("show_timestamp")) config.hud.show_timestamp = h["show_timestamp"].get<bool>();
             if (h.contains("show_joystick_indicator")) config.hud.show_joystick_indicator = h["show_joystick_indicator"].get<bool>();
+            if (h.contains("show_detections")) config.hud.show_detections = h["show_detections"].get<bool>();
             if (h.contains("font_scale")) config.hud.font_scale = h["font_scale"].get<double>();
             if (h.contains("telemetry_position")) config.hud.telemetry_position = h["telemetry_position"].get<std::string>();
             
@@ -76,6 +126,41 @@ Config Config::load(const std::string& path) {
                     config.hud.text_color = {c[0], c[1], c[2]};
                 }
             }
+            
+            if (h.contains("widgets")) {
+                for (auto& w : h["widgets"]) {
+                    HudWidgetConfig wc;
+                    if (w.contains("type")) wc.type = w["type"].get<std::string>();
+                    if (w.contains("anchor")) wc.anchor = w["anchor"].get<std::string>();
+                    if (w.contains("align")) wc.align = w["align"].get<std::string>();
+                    if (w.contains("bind")) wc.bind = w["bind"].get<std::string>();
+                    if (w.contains("when")) wc.when = w["when"].get<std::string>();
+                    if (w.contains("label")) wc.label = w["label"].get<std::string>();
+                    if (w.contains("suffix")) wc.suffix = w["suffix"].get<std::string>();
+                    if (w.contains("precision")) wc.precision = w["precision"].get<int>();
+                    if (w.contains("scale")) wc.scale = w["scale"].get<double>();
+                    if (w.contains("thickness")) wc.thickness = w["thickness"].get<int>();
+                    if (w.contains("size")) wc.size = w["size"].get<int>();
+                    if (w.contains("gap")) wc.gap = w["gap"].get<int>();
+                    if (w.contains("min")) wc.min = w["min"].get<double>();
+                    if (w.contains("max")) wc.max = w["max"].get<double>();
+                    
+                    if (w.contains("offset")) {
+                        auto o = w["offset"].get<std::vector<int>>();
+                        if (o.size() >= 2) {
+                            wc.offset = {o[0], o[1]};
+                        }
+                    }
+                    
+                    if (w.contains("color")) {
+                        auto c = w["color"].get<std::vector<int>>();
+                        if (c.size() >= 3) {
+                            wc.color = {c[0], c[1], c[2]};
+                        }
+                    }
+                    config.hud.widgets.push_back(wc);
+                }
+            }
         }
         
         // Recording config
@@ -86,6 +171,205 @@ Config Config::load(const std::string& path) {
             if (r.contains("format")) config.recording.format = r["format"].get<std::string>();
             if (r.contains("codec")) config.recording.codec = r["codec"].get<std::string>();
             if (r.contains("include_hud")) config.recording.include_hud = r["include_hud"].get<bool>();
+            if (r.contains("dual_stream")) config.recording.dual_stream = r["dual_stream"].get<bool>();
+            if (r.contains("proxy_scale")) config.recording.proxy_scale = r["proxy_scale"].get<double>();
+            if (r.contains("queue_frames")) config.recording.queue_frames = r["queue_frames"].get<int>();
+            if (r.contains("segment_seconds")) config.recording.segment_seconds = r["segment_seconds"].get<double>();
+            if (r.contains("max_size_gb")) config.recording.max_size_gb = r["max_size_gb"].get<double>();
+            if (r.contains("max_age_hours")) config.recording.max_age_hours = r["max_age_hours"].get<double>();
+            if (r.contains("raw")) config.recording.raw = r["raw"].get<bool>();
+            if (r.contains("raw_workers")) config.recording.raw_workers = r["raw_workers"].get<int>();
+            if (r.contains("raw_chunk_mb")) config.recording.raw_chunk_mb = r["raw_chunk_mb"].get<int>();
+            if (r.contains("raw_queue_frames")) config.recording.raw_queue_frames = r["raw_queue_frames"].get<int>();
+            if (r.contains("encoder")) config.recording.encoder = r["encoder"].get<std::string>();
+            if (r.contains("encoder_codec")) config.recording.encoder_codec = r["encoder_codec"].get<std::string>();
+            if (r.contains("encoder_preset")) config.recording.encoder_preset = r["encoder_preset"].get<std::string>();
+            if (r.contains("encoder_crf")) config.recording.encoder_crf = r["encoder_crf"].get<int>();
+            if (r.contains("encoder_workers")) config.recording.encoder_workers = r["encoder_workers"].get<int>();
+            if (r.contains("encoder_threads")) config.recording.encoder_threads = r["encoder_threads"].get<int>();
+            if (r.contains("encoder_gop_seconds")) config.recording.encoder_gop_seconds = r["encoder_gop_seconds"].get<double>();
+            if (r.contains("encoder_buffer_frames")) config.recording.encoder_buffer_frames = r["encoder_buffer_frames"].get<int>();
+        }
+        
+        // Detector config
+        if (j.contains("detector")) {
+            auto& d = j["detector"];
+            if (d.contains("enabled")) config.detector.enabled = d["enabled"].get<bool>();
+            if (d.contains("scale")) config.detector.scale = d["scale"].get<double>();
+            if (d.contains("frame_interval")) config.detector.frame_interval = d["frame_interval"].get<int>();
+            if (d.contains("history")) config.detector.history = d["history"].get<int>();
+            if (d.contains("var_threshold")) config.detector.var_threshold = d["var_threshold"].get<double>();
+            if (d.contains("min_area")) config.detector.min_area = d["min_area"].get<int>();
+            if (d.contains("max_detections")) config.detector.max_detections = d["max_detections"].get<int>();
+        }
+        
+        // Scenario injection config
+        if (j.contains("scenario")) {
+            auto& s = j["scenario"];
+            if (s.contains("enabled")) config.scenario.enabled = s["enabled"].get<bool>();
+            if (s.contains("file")) config.scenario.file = s["file"].get<std::string>();
+            if (s.contains("ground_truth_dir")) config.scenario.ground_truth_dir = s["ground_truth_dir"].get<std::string>();
+            if (s.contains("budget_ms")) config.scenario.budget_ms = s["budget_ms"].get<double>();
+        }
+        
+        // Sensor effects config
+        if (j.contains("effects")) {
+            auto& e = j["effects"];
+            if (e.contains("enabled")) config.effects.enabled = e["enabled"].get<bool>();
+            if (e.contains("palette")) config.effects.palette = e["palette"].get<std::string>();
+            if (e.contains("noise_sigma")) config.effects.noise_sigma = e["noise_sigma"].get<float>();
+            if (e.contains("noise_seed")) config.effects.noise_seed = e["noise_seed"].get<int>();
+            if (e.contains("haze_visibility")) config.effects.haze_visibility = e["haze_visibility"].get<float>();
+            if (e.contains("haze_range")) config.effects.haze_range = e["haze_range"].get<float>();
+            if (e.contains("haze_color")) {
+                auto c = e["haze_color"].get<std::vector<int>>();
+                if (c.size() >= 3) {
+                    config.effects.haze_color = {c[0], c[1], c[2]};
+                }
+            }
+            if (e.contains("motion_blur_ms")) config.effects.motion_blur_ms = e["motion_blur_ms"].get<float>();
+            if (e.contains("dead_pixels")) config.effects.dead_pixels = e["dead_pixels"].get<int>();
+            if (e.contains("budget_ms")) config.effects.budget_ms = e["budget_ms"].get<double>();
+        }
+        
+        // Image enhancement config
+        if (j.contains("enhance")) {
+            auto& e = j["enhance"];
+            if (e.contains("clahe")) config.enhance.clahe = e["clahe"].get<bool>();
+            if (e.contains("dehaze")) config.enhance.dehaze = e["dehaze"].get<bool>();
+            if (e.contains("sharpen")) config.enhance.sharpen = e["sharpen"].get<bool>();
+            if (e.contains("clahe_clip")) config.enhance.clahe_clip = e["clahe_clip"].get<double>();
+            if (e.contains("clahe_tiles")) config.enhance.clahe_tiles = e["clahe_tiles"].get<int>();
+            if (e.contains("dehaze_strength")) config.enhance.dehaze_strength = e["dehaze_strength"].get<double>();
+            if (e.contains("dehaze_patch")) config.enhance.dehaze_patch = e["dehaze_patch"].get<int>();
+            if (e.contains("sharpen_amount")) config.enhance.sharpen_amount = e["sharpen_amount"].get<double>();
+            if (e.contains("sharpen_sigma")) config.enhance.sharpen_sigma = e["sharpen_sigma"].get<double>();
+            if (e.contains("static_threshold")) config.enhance.static_threshold = e["static_threshold"].get<double>();
+            if (e.contains("static_refresh")) config.enhance.static_refresh = e["static_refresh"].get<int>();
+            if (e.contains("budget_ms")) config.enhance.budget_ms = e["budget_ms"].get<double>();
+        }
+        
+        // Gimbal config
+        if (j.contains("gimbal")) {
+            auto& g = j["gimbal"];
+            if (g.contains("max_pan_rate")) config.gimbal.max_pan_rate = g["max_pan_rate"].get<float>();
+            if (g.contains("max_tilt_rate")) config.gimbal.max_tilt_rate = g["max_tilt_rate"].get<float>();
+            if (g.contains("min_tilt")) config.gimbal.min_tilt = g["min_tilt"].get<float>();
+            if (g.contains("max_tilt")) config.gimbal.max_tilt = g["max_tilt"].get<float>();
+            if (g.contains("min_zoom")) config.gimbal.min_zoom = g["min_zoom"].get<float>();
+            if (g.contains("max_zoom")) config.gimbal.max_zoom = g["max_zoom"].get<float>();
+            if (g.contains("hfov_wide")) config.gimbal.hfov_wide = g["hfov_wide"].get<float>();
+        }
+        
+        // Gimbal link config
+        if (j.contains("gimbal_link")) {
+            auto& l = j["gimbal_link"];
+            if (l.contains("enabled")) config.gimbal_link.enabled = l["enabled"].get<bool>();
+            if (l.contains("host")) config.gimbal_link.host = l["host"].get<std::string>();
+            if (l.contains("port")) config.gimbal_link.port = l["port"].get<int>();
+            if (l.contains("rate_hz")) config.gimbal_link.rate_hz = l["rate_hz"].get<double>();
+            if (l.contains("mode")) config.gimbal_link.mode = l["mode"].get<std::string>();
+        }
+        
+        // Telemetry config
+        if (j.contains("telemetry")) {
+            auto& t = j["telemetry"];
+            if (t.contains("enabled")) config.telemetry.enabled = t["enabled"].get<bool>();
+            if (t.contains("bind")) config.telemetry.bind = t["bind"].get<std::string>();
+            if (t.contains("port")) config.telemetry.port = t["port"].get<int>();
+            if (t.contains("stale_ms")) config.telemetry.stale_ms = t["stale_ms"].get<int>();
+        }
+        
+        // Map config
+        if (j.contains("map")) {
+            auto& m = j["map"];
+            if (m.contains("enabled")) config.map.enabled = m["enabled"].get<bool>();
+            if (m.contains("tile_pack")) config.map.tile_pack = m["tile_pack"].get<std::string>();
+            if (m.contains("zoom")) config.map.zoom = m["zoom"].get<int>();
+            if (m.contains("size")) config.map.size = m["size"].get<int>();
+            if (m.contains("cache_tiles")) config.map.cache_tiles = m["cache_tiles"].get<int>();
+            if (m.contains("prefetch_seconds")) config.map.prefetch_seconds = m["prefetch_seconds"].get<double>();
+        }
+        
+        // Replay config
+        if (j.contains("replay")) {
+            auto& rp = j["replay"];
+            if (rp.contains("enabled")) config.replay.enabled = rp["enabled"].get<bool>();
+            if (rp.contains("budget_mb")) config.replay.budget_mb = rp["budget_mb"].get<int>();
+            if (rp.contains("quality")) config.replay.quality = rp["quality"].get<int>();
+            if (rp.contains("thumbnail_width")) config.replay.thumbnail_width = rp["thumbnail_width"].get<int>();
+            if (rp.contains("workers")) config.replay.workers = rp["workers"].get<int>();
+            if (rp.contains("hat")) config.replay.hat = rp["hat"].get<int>();
+            if (rp.contains("scrub_speed")) config.replay.scrub_speed = rp["scrub_speed"].get<double>();
+            if (rp.contains("jump_seconds")) config.replay.jump_seconds = rp["jump_seconds"].get<double>();
+        }
+        
+        // Tracker config
+        if (j.contains("governor")) {
+            auto& g = j["governor"];
+            if (g.contains("enabled")) config.governor.enabled = g["enabled"].get<bool>();
+            if (g.contains("target_fps")) config.governor.target_fps = g["target_fps"].get<double>();
+            if (g.contains("shed_order")) config.governor.shed_order = g["shed_order"].get<std::vector<std::string>>();
+            if (g.contains("degrade_load")) config.governor.degrade_load = g["degrade_load"].get<double>();
+            if (g.contains("restore_load")) config.governor.restore_load = g["restore_load"].get<double>();
+            if (g.contains("degrade_seconds")) config.governor.degrade_seconds = g["degrade_seconds"].get<double>();
+            if (g.contains("restore_seconds")) config.governor.restore_seconds = g["restore_seconds"].get<double>();
+            if (g.contains("hud_interval")) config.governor.hud_interval = g["hud_interval"].get<int>();
+            if (g.contains("detector_throttle")) config.governor.detector_throttle = g["detector_throttle"].get<int>();
+            if (g.contains("render_scale")) config.governor.render_scale = g["render_scale"].get<double>();
+            if (g.contains("stage_budgets")) {
+                config.governor.stage_budgets = g["stage_budgets"].get<std::map<std::string, double>>();
+            }
+        }
+        
+        if (j.contains("pipeline")) {
+            auto& p = j["pipeline"];
+            if (p.contains("mode")) config.pipeline.mode = p["mode"].get<std::string>();
+            if (p.contains("depth")) config.pipeline.depth = p["depth"].get<int>();
+            if (p.contains("workers")) config.pipeline.workers = p["workers"].get<int>();
+        }
+        
+        if (j.contains("tracker")) {
+            auto& t = j["tracker"];
+            if (t.contains("enabled")) config.tracker.enabled = t["enabled"].get<bool>();
+            if (t.contains("window")) config.tracker.window = t["window"].get<int>();
+            if (t.contains("filter_size")) config.tracker.filter_size = t["filter_size"].get<int>();
+            if (t.contains("learning_rate")) config.tracker.learning_rate = t["learning_rate"].get<double>();
+            if (t.contains("psr_threshold")) config.tracker.psr_threshold = t["psr_threshold"].get<double>();
+            if (t.contains("budget_ms")) config.tracker.budget_ms = t["budget_ms"].get<double>();
+            if (t.contains("drive_gimbal")) config.tracker.drive_gimbal = t["drive_gimbal"].get<bool>();
+            if (t.contains("steering_gain")) config.tracker.steering_gain = t["steering_gain"].get<float>();
+        }
+        
+        // Thread topology config
+        if (j.contains("threads")) {
+            for (auto& [role, t] : j["threads"].items()) {
+                ThreadConfig tc;
+                if (t.contains("name")) tc.name = t["name"].get<std::string>();
+                if (t.contains("cpus")) tc.cpus = t["cpus"].get<std::vector<int>>();
+                if (t.contains("nice")) tc.nice = t["nice"].get<int>();
+                if (t.contains("fifo_priority")) tc.fifo_priority = t["fifo_priority"].get<int>();
+                if (t.contains("memory_node")) tc.memory_node = t["memory_node"].get<int>();
+                if (t.contains("memory_follows")) tc.memory_follows = t["memory_follows"].get<std::string>();
+                config.threads[role] = tc;
+            }
+        }
+        
+        // Metrics config
+        if (j.contains("metrics")) {
+            auto& m = j["metrics"];
+            if (m.contains("enabled")) config.metrics.enabled = m["enabled"].get<bool>();
+            if (m.contains("bind")) config.metrics.bind = m["bind"].get<std::string>();
+            if (m.contains("port")) config.metrics.port = m["port"].get<int>();
+            if (m.contains("allow_remote")) config.metrics.allow_remote = m["allow_remote"].get<bool>();
+        }
+        
+        // Trace config
+        if (j.contains("trace")) {
+            auto& t = j["trace"];
+            if (t.contains("enabled")) config.trace.enabled = t["enabled"].get<bool>();
+            if (t.contains("buffer_events")) config.trace.buffer_events = t["buffer_events"].get<int>();
+            if (t.contains("output_dir")) config.trace.output_dir = t["output_dir"].get<std::string>();
         }
         
         // Window config
@@ -113,6 +397,43 @@ void Config::save(const std::string& path) const {
     j["video"]["height"] = video.height;
     j["video"]["fps"] = video.fps;
     j["video"]["reconnect_delay_ms"] = video.reconnect_delay_ms;
+    j["video"]["low_latency"] = video.low_latency;
+    j["video"]["max_latency_ms"] = video.max_latency_ms;
+    j["video"]["main_source"] = video.main_source;
+    j["video"]["main_width"] = video.main_width;
+    j["video"]["main_height"] = video.main_height;
+    j["video"]["switch_zoom"] = video.switch_zoom;
+    j["video"]["switch_band"] = video.switch_band;
+    j["video"]["warm_frames"] = video.warm_frames;
+    j["video"]["lens"]["enabled"] = video.lens.enabled;
+    j["video"]["lens"]["width"] = video.lens.width;
+    j["video"]["lens"]["height"] = video.lens.height;
+    j["video"]["lens"]["steps_per_doubling"] = video.lens.steps_per_doubling;
+    j["video"]["lens"]["cache_tables"] = video.lens.cache_tables;
+    j["video"]["lens"]["alpha"] = video.lens.alpha;
+    j["video"]["lens"]["calibration"] = json::array();
+    for (const auto& lc : video.lens.calibration) {
+        json c;
+        c["zoom"] = lc.zoom;
+        c["fx"] = lc.fx;
+        c["fy"] = lc.fy;
+        c["cx"] = lc.cx;
+        c["cy"] = lc.cy;
+        c["distortion"] = lc.distortion;
+        j["video"]["lens"]["calibration"].push_back(c);
+    }
+    
+    // File playback
+    j["playback"]["enabled"] = playback.enabled;
+    j["playback"]["loop"] = playback.loop;
+    j["playback"]["speed"] = playback.speed;
+    j["playback"]["decode_ahead"] = playback.decode_ahead;
+    j["playback"]["seek_step"] = playback.seek_step;
+    
+    // Frame bus
+    j["frame_bus"]["enabled"] = frame_bus.enabled;
+    j["frame_bus"]["name"] = frame_bus.name;
+    j["frame_bus"]["slots"] = frame_bus.slots;
     
     // Joystick
     j["joystick"]["device_index"] = joystick.device_index;
@@ -129,17 +450,190 @@ void Config::save(const std::string& path) const {
     j["hud"]["show_telemetry"] = hud.show_telemetry;
     j["hud"]["show_timestamp"] = hud.show_timestamp;
     j["hud"]["show_joystick_indicator"] = hud.show_joystick_indicator;
+    j["hud"]["show_detections"] = hud.show_detections;
     j["hud"]["crosshair_color"] = hud.crosshair_color;
     j["hud"]["text_color"] = hud.text_color;
     j["hud"]["font_scale"] = hud.font_scale;
     j["hud"]["telemetry_position"] = hud.telemetry_position;
     
+    if (!hud.widgets.empty()) {
+        j["hud"]["widgets"] = json::array();
+        for (const auto& wc : hud.widgets) {
+            json w;
+            w["type"] = wc.type;
+            w["anchor"] = wc.anchor;
+            w["offset"] = wc.offset;
+            w["align"] = wc.align;
+            w["bind"] = wc.bind;
+            w["when"] = wc.when;
+            w["label"] = wc.label;
+            w["suffix"] = wc.suffix;
+            w["precision"] = wc.precision;
+            w["scale"] = wc.scale;
+            w["thickness"] = wc.thickness;
+            w["size"] = wc.size;
+            w["gap"] = wc.gap;
+            w["min"] = wc.min;
+            w["max"] = wc.max;
+            w["color"] = wc.color;
+            j["hud"]["widgets"].push_back(w);
+        }
+    }
+    
     // Recording
     j["recording"]["enabled"] = recording.enabled;
     j["recording"]["output_dir"] = recording.output_dir;
     j["recording"]["format"] = recording.format;
     j["recording"]["codec"] = recording.codec;
     j["recording"]["include_hud"] = recording.include_hud;
+    j["recording"]["dual_stream"] = recording.dual_stream;
+    j["recording"]["proxy_scale"] = recording.proxy_scale;
+    j["recording"]["queue_frames"] = recording.queue_frames;
+    j["recording"]["segment_seconds"] = recording.segment_seconds;
+    j["recording"]["max_size_gb"] = recording.max_size_gb;
+    j["recording"]["max_age_hours"] = recording.max_age_hours;
+    j["recording"]["raw"] = recording.raw;
+    j["recording"]["raw_workers"] = recording.raw_workers;
+    j["recording"]["raw_chunk_mb"] = recording.raw_chunk_mb;
+    j["recording"]["raw_queue_frames"] = recording.raw_queue_frames;
+    j["recording"]["encoder"] = recording.encoder;
+    j["recording"]["encoder_codec"] = recording.encoder_codec;
+    j["recording"]["encoder_preset"] = recording.encoder_preset;
+    j["recording"]["encoder_crf"] = recording.encoder_crf;
+    j["recording"]["encoder_workers"] = recording.encoder_workers;
+    j["recording"]["encoder_threads"] = recording.encoder_threads;
+    j["recording"]["encoder_gop_seconds"] = recording.encoder_gop_seconds;
+    j["recording"]["encoder_buffer_frames"] = recording.encoder_buffer_frames;
+    
+    // Detector
+    j["detector"]["enabled"] = detector.enabled;
+    j["detector"]["scale"] = detector.scale;
+    j["detector"]["frame_interval"] = detector.frame_interval;
+    j["detector"]["history"] = detector.history;
+    j["detector"]["var_threshold"] = detector.var_threshold;
+    j["detector"]["min_area"] = detector.min_area;
+    j["detector"]["max_detections"] = detector.max_detections;
+    
+    // Scenario injection
+    j["scenario"]["enabled"] = scenario.enabled;
+    j["scenario"]["file"] = scenario.file;
+    j["scenario"]["ground_truth_dir"] = scenario.ground_truth_dir;
+    j["scenario"]["budget_ms"] = scenario.budget_ms;
+    
+    // Sensor effects
+    j["effects"]["enabled"] = effects.enabled;
+    j["effects"]["palette"] = effects.palette;
+    j["effects"]["noise_sigma"] = effects.noise_sigma;
+    j["effects"]["noise_seed"] = effects.noise_seed;
+    j["effects"]["haze_visibility"] = effects.haze_visibility;
+    j["effects"]["haze_range"] = effects.haze_range;
+    j["effects"]["haze_color"] = effects.haze_color;
+    j["effects"]["motion_blur_ms"] = effects.motion_blur_ms;
+    j["effects"]["dead_pixels"] = effects.dead_pixels;
+    j["effects"]["budget_ms"] = effects.budget_ms;
+    
+    j["enhance"]["clahe"] = enhance.clahe;
+    j["enhance"]["dehaze"] = enhance.dehaze;
+    j["enhance"]["sharpen"] = enhance.sharpen;
+    j["enhance"]["clahe_clip"] = enhance.clahe_clip;
+    j["enhance"]["clahe_tiles"] = enhance.clahe_tiles;
+    j["enhance"]["dehaze_strength"] = enhance.dehaze_strength;
+    j["enhance"]["dehaze_patch"] = enhance.dehaze_patch;
+    j["enhance"]["sharpen_amount"] = enhance.sharpen_amount;
+    j["enhance"]["sharpen_sigma"] = enhance.sharpen_sigma;
+    j["enhance"]["static_threshold"] = enhance.static_threshold;
+    j["enhance"]["static_refresh"] = enhance.static_refresh;
+    j["enhance"]["budget_ms"] = enhance.budget_ms;
+    
+    // Gimbal
+    j["gimbal"]["max_pan_rate"] = gimbal.max_pan_rate;
+    j["gimbal"]["max_tilt_rate"] = gimbal.max_tilt_rate;
+    j["gimbal"]["min_tilt"] = gimbal.min_tilt;
+    j["gimbal"]["max_tilt"] = gimbal.max_tilt;
+    j["gimbal"]["min_zoom"] = gimbal.min_zoom;
+    j["gimbal"]["max_zoom"] = gimbal.max_zoom;
+    j["gimbal"]["hfov_wide"] = gimbal.hfov_wide;
+    
+    // Gimbal link
+    j["gimbal_link"]["enabled"] = gimbal_link.enabled;
+    j["gimbal_link"]["host"] = gimbal_link.host;
+    j["gimbal_link"]["port"] = gimbal_link.port;
+    j["gimbal_link"]["rate_hz"] = gimbal_link.rate_hz;
+    j["gimbal_link"]["mode"] = gimbal_link.mode;
+    
+    // Telemetry
+    j["telemetry"]["enabled"] = telemetry.enabled;
+    j["telemetry"]["bind"] = telemetry.bind;
+    j["telemetry"]["port"] = telemetry.port;
+    j["telemetry"]["stale_ms"] = telemetry.stale_ms;
+    
+    // Map
+    j["map"]["enabled"] = map.enabled;
+    j["map"]["tile_pack"] = map.tile_pack;
+    j["map"]["zoom"] = map.zoom;
+    j["map"]["size"] = map.size;
+    j["map"]["cache_tiles"] = map.cache_tiles;
+    j["map"]["prefetch_seconds"] = map.prefetch_seconds;
+    
+    // Replay
+    j["replay"]["enabled"] = replay.enabled;
+    j["replay"]["budget_mb"] = replay.budget_mb;
+    j["replay"]["quality"] = replay.quality;
+    j["replay"]["thumbnail_width"] = replay.thumbnail_width;
+    j["replay"]["workers"] = replay.workers;
+    j["replay"]["hat"] = replay.hat;
+    j["replay"]["scrub_speed"] = replay.scrub_speed;
+    j["replay"]["jump_seconds"] = replay.jump_seconds;
+    
+    // Frame-time governor
+    j["governor"]["enabled"] = governor.enabled;
+    j["governor"]["target_fps"] = governor.target_fps;
+    j["governor"]["shed_order"] = governor.shed_order;
+    j["governor"]["degrade_load"] = governor.degrade_load;
+    j["governor"]["restore_load"] = governor.restore_load;
+    j["governor"]["degrade_seconds"] = governor.degrade_seconds;
+    j["governor"]["restore_seconds"] = governor.restore_seconds;
+    j["governor"]["hud_interval"] = governor.hud_interval;
+    j["governor"]["detector_throttle"] = governor.detector_throttle;
+    j["governor"]["render_scale"] = governor.render_scale;
+    j["governor"]["stage_budgets"] = governor.stage_budgets;
+    
+    // Pipeline
+    j["pipeline"]["mode"] = pipeline.mode;
+    j["pipeline"]["depth"] = pipeline.depth;
+    j["pipeline"]["workers"] = pipeline.workers;
+    
+    // Tracker
+    j["tracker"]["enabled"] = tracker.enabled;
+    j["tracker"]["window"] = tracker.window;
+    j["tracker"]["filter_size"] = tracker.filter_size;
+    j["tracker"]["learning_rate"] = tracker.learning_rate;
+    j["tracker"]["psr_threshold"] = tracker.psr_threshold;
+    j["tracker"]["budget_ms"] = tracker.budget_ms;
+    j["tracker"]["drive_gimbal"] = tracker.drive_gimbal;
+    j["tracker"]["steering_gain"] = tracker.steering_gain;
+    
+    // Thread topology
+    j["threads"] = json::object();
+    for (const auto& [role, tc] : threads) {
+        j["threads"][role]["name"] = tc.name;
+        j["threads"][role]["cpus"] = tc.cpus;
+        j["threads"][role]["nice"] = tc.nice;
+        j["threads"][role]["fifo_priority"] = tc.fifo_priority;
+        j["threads"][role]["memory_node"] = tc.memory_node;
+        j["threads"][role]["memory_follows"] = tc.memory_follows;
+    }
+    
+    // Metrics
+    j["metrics"]["enabled"] = metrics.enabled;
+    j["metrics"]["bind"] = metrics.bind;
+    j["metrics"]["port"] = metrics.port;
+    j["metrics"]["allow_remote"] = metrics.allow_remote;
+    
+    // Trace
+    j["trace"]["enabled"] = trace.enabled;
+    j["trace"]["buffer_events"] = trace.buffer_events;
+    j["trace"]["output_dir"] = trace.output_dir;
     
     // Window
     j["window"]["title"] = window.title;
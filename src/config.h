@@ -3,16 +3,65 @@
 #include <string>
 #include <array>
 #include <map>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 namespace sar {
 
+// Calibrated pinhole + Brown-Conrady model at one zoom position
+struct LensCalibration {
+    float zoom = 1.0f;
+    double fx = 0.0;               // Focal length in pixels at lens width/height; 0 derives it from gimbal.hfov_wide
+    double fy = 0.0;               // 0 uses fx
+    double cx = 0.0;               // Principal point; 0 is the image centre
+    double cy = 0.0;
+    std::vector<double> distortion;    // k1, k2, p1, p2[, k3]
+};
+
+struct LensConfig {
+    bool enabled = false;          // Undistort frames before effects, HUD and analysis
+    int width = 0;                 // Resolution the calibration was made at; 0 uses video width/height
+    int height = 0;
+    std::vector<LensCalibration> calibration;  // One entry per zoom; interpolated between, clamped outside
+    int steps_per_doubling = 4;    // Zoom quantisation of the cached remap tables
+    int cache_tables = 8;          // Remap tables kept (least recently used evicted)
+    double alpha = 0.0;            // 0 crops to valid pixels, 1 keeps every source pixel
+};
+
 struct VideoConfig {
     std::string source = "0";
     int width = 1280;
     int height = 720;
     int fps = 30;
     int reconnect_delay_ms = 3000;
+    bool low_latency = false;      // Minimal buffering, drop stale frames (network/camera sources)
+    int max_latency_ms = 150;      // Source-to-publish lag bound in low-latency mode
+    
+    // Dual-resolution live sources: source is then the camera's substream
+    std::string main_source;       // High-resolution stream of the same camera; empty = source only
+    int main_width = 3840;
+    int main_height = 2160;
+    float switch_zoom = 4.0f;      // Simulated zoom at and above which the main stream is shown
+    float switch_band = 1.0f;      // Zoom below switch_zoom where the other stream is kept decoding, ready to switch
+    int warm_frames = 3;           // Frames a stream must decode before it is shown
+    
+    LensConfig lens;
+};
+
+// Applies when video.source is a file
+struct PlaybackConfig {
+    bool enabled = true;           // Decode-ahead, timestamp-paced playback; false reads files like cameras
+    bool loop = true;
+    double speed = 1.0;            // 0.25 to 8
+    int decode_ahead = 8;          // Decoded frames buffered ahead of presentation
+    double seek_step = 5.0;        // Seconds per seek key press
+};
+
+// Shared-memory frame ring for other local processes (viewers, recorders, analysis)
+struct FrameBusConfig {
+    bool enabled = false;
+    std::string name = "sar_frames";   // Readers use video.source "shm:<name>"
+    int slots = 4;                     // Frames kept; a reader slower than this skips ahead
 };
 
 struct JoystickConfig {
@@ -25,16 +74,38 @@ struct JoystickConfig {
     bool invert_tilt = false;
 };
 
+// One declarative HUD element; compiled into a draw command by Hud::init
+struct HudWidgetConfig {
+    std::string type;                   // reticle, text, value, joystick_name, clock, gauge, indicator, stick, detections, track
+    std::string anchor = "top_left";    // top_left, top_center, top_right, center, bottom_left, bottom_center, bottom_right
+    std::array<int, 2> offset = {0, 0};
+    std::string align = "left";         // left, center, right
+    std::string bind;                   // Telemetry value for value/gauge, e.g. "gimbal.pan"
+    std::string when = "always";        // always, joystick.connected, joystick.disconnected, recording, gimbal, tracking, detections
+    std::string label;                  // Text, or the prefix of a value
+    std::string suffix;
+    int precision = 2;
+    double scale = 1.0;                 // Multiplies hud.font_scale
+    int thickness = 1;
+    int size = 0;                       // Reticle arm, stick diameter, gauge length (0 = type default)
+    int gap = 8;                        // Reticle centre gap
+    double min = -1.0;                  // Gauge range
+    double max = 1.0;
+    std::array<int, 3> color = {-1, -1, -1};  // RGB; -1 keeps the HUD default for the type
+};
+
 struct HudConfig {
     bool enabled = true;
     bool show_crosshair = true;
     bool show_telemetry = true;
     bool show_timestamp = true;
     bool show_joystick_indicator = true;
+    bool show_detections = true;
     std::array<int, 3> crosshair_color = {0, 255, 0};
     std::array<int, 3> text_color = {0, 255, 0};
     double font_scale = 0.6;
     std::string telemetry_position = "top_left";
+    std::vector<HudWidgetConfig> widgets;   // Empty: built-in layout from the show_* flags
 };
 
 struct RecordingConfig {
@@ -42,7 +113,179 @@ struct RecordingConfig {
     std::string output_dir = "./recordings";
     std::string format = "mp4";
     std::string codec = "mp4v";
-    bool include_hud = true;
+    bool include_hud = true;        // Single-stream recordings: HUD-burned or clean
+    bool dual_stream = false;       // Record HUD-burned and clean streams side by side
+    double proxy_scale = 0.0;       // > 0 adds a downscaled HUD stream for quick review, e.g. 0.25
+    int queue_frames = 16;          // Per-stream encode queue; frames beyond it are dropped
+    double segment_seconds = 0.0;   // > 0 splits each stream into files of this length
+    double max_size_gb = 0.0;       // Delete the oldest recordings beyond this total (0 = no limit)
+    double max_age_hours = 0.0;     // Delete recordings older than this (0 = keep)
+    bool raw = false;               // Also record the clean feed losslessly (.sarraw chunks)
+    int raw_workers = 0;            // Compression threads; 0 = half the cores, at most 8
+    int raw_chunk_mb = 1024;        // Preallocated size of each raw chunk file
+    int raw_queue_frames = 32;      // Raw frames in flight before new ones are dropped
+    std::string encoder = "opencv"; // "opencv" (cv::VideoWriter, codec above) or "parallel" (GOP-parallel libav, needs FFmpeg)
+    std::string encoder_codec = "libx264";  // Parallel encoder: libx264 or libx265
+    std::string encoder_preset = "veryfast";
+    int encoder_crf = 23;
+    int encoder_workers = 0;        // GOPs encoded at once; 0 = half the cores, at least 2
+    int encoder_threads = 2;        // Codec threads per GOP
+    double encoder_gop_seconds = 1.0;   // Closed-GOP length; the unit of parallelism
+    int encoder_buffer_frames = 120;    // Frames waiting for an encoder before new ones are dropped
+};
+
+struct DetectorConfig {
+    bool enabled = false;
+    double scale = 0.25;           // Processing resolution relative to source
+    int frame_interval = 2;        // Process every Nth source frame
+    int history = 300;
+    double var_threshold = 25.0;
+    int min_area = 6;              // Minimum blob area in processing pixels
+    int max_detections = 32;
+};
+
+// Synthetic training targets composited into the feed from a scenario file
+struct ScenarioConfig {
+    bool enabled = false;
+    std::string file;              // Scenario JSON: sprites and timed target injections
+    std::string ground_truth_dir = "./recordings";  // Where truth_<timestamp>.csv is written; empty disables
+    double budget_ms = 1.0;        // Frames over this are counted
+};
+
+// Simulated sensor effects applied to each source frame; each one is off at its zero value
+struct EffectsConfig {
+    bool enabled = false;          // Initial state; the effects_toggle button switches at runtime
+    std::string palette = "none";  // none, white_hot, black_hot, ironbow, rainbow
+    float noise_sigma = 0.0f;      // Sensor noise (grey levels)
+    int noise_seed = 1;
+    float haze_visibility = 0.0f;  // Metres at which haze covers 63% of the scene
+    float haze_range = 500.0f;     // Assumed range at min zoom when there is no ground point
+    std::array<int, 3> haze_color = {200, 200, 210};
+    float motion_blur_ms = 0.0f;   // Exposure time smeared by gimbal motion
+    int dead_pixels = 0;
+    double budget_ms = 5.0;        // Frames over this are counted
+};
+
+// Operator image enhancement; the *_toggle buttons and keys switch each stage at runtime
+struct EnhanceConfig {
+    bool clahe = false;            // Initial states
+    bool dehaze = false;
+    bool sharpen = false;
+    double clahe_clip = 2.0;       // Local contrast limit, multiple of the mean histogram bin (1-8)
+    int clahe_tiles = 8;           // Contrast tiles across and down
+    double dehaze_strength = 0.8;  // Fraction of the estimated haze removed (0.1-0.95)
+    int dehaze_patch = 15;         // Dark-channel window (pixels)
+    double sharpen_amount = 0.8;   // Unsharp mask gain (0.1-3)
+    double sharpen_sigma = 1.5;    // Unsharp mask blur radius (pixels)
+    double static_threshold = 0.5; // Mean grey change under which a contrast tile keeps its histogram; 0 always rebuilds
+    int static_refresh = 30;       // Kept histograms are rebuilt at least every N frames
+    double budget_ms = 4.0;        // Frames over this are counted
+};
+
+struct GimbalConfig {
+    float max_pan_rate = 60.0f;    // deg/s at full deflection
+    float max_tilt_rate = 40.0f;
+    float min_tilt = -90.0f;
+    float max_tilt = 20.0f;
+    float min_zoom = 1.0f;
+    float max_zoom = 30.0f;
+    float hfov_wide = 60.0f;       // Horizontal field of view at min_zoom (degrees)
+};
+
+struct GimbalLinkConfig {
+    bool enabled = false;
+    std::string host = "127.0.0.1";
+    int port = 14600;
+    double rate_hz = 50.0;
+    std::string mode = "rate";     // "rate": deg/s commands, "angle": absolute pointing (deg)
+};
+
+struct TelemetryConfig {
+    bool enabled = false;
+    std::string bind = "0.0.0.0";
+    int port = 14650;
+    int stale_ms = 500;            // Older data is flagged STALE on the HUD
+};
+
+struct MapConfig {
+    bool enabled = false;
+    std::string tile_pack = "maps/area.sartiles";
+    int zoom = 15;                 // Slippy-map zoom level drawn from the pack
+    int size = 220;                // Inset size (pixels, square)
+    int cache_tiles = 64;          // Decoded tiles kept in memory
+    double prefetch_seconds = 10.0;  // Look-ahead along the ground track
+};
+
+// In-session instant replay from a RAM cache of recent frames
+struct ReplayConfig {
+    bool enabled = false;
+    int budget_mb = 256;           // JPEG frames plus thumbnails kept in memory
+    int quality = 85;              // JPEG quality of the cached frames
+    int thumbnail_width = 256;     // Uncompressed scrub track width (pixels)
+    int workers = 2;               // Encode/decode threads
+    int hat = 0;                   // Joystick hat: left/right scrub, up/down jump
+    double scrub_speed = 1.0;      // Held-hat scrub rate, x real time
+    double jump_seconds = 5.0;
+};
+
+// Sheds optional work when the render loop runs over its frame budget
+struct GovernorConfig {
+    bool enabled = false;
+    double target_fps = 0;         // Frame budget; 0 = the source frame rate
+    std::vector<std::string> shed_order = {"hud_rate", "detector", "effects", "resolution"};
+    double degrade_load = 0.95;    // Smoothed frame cost / budget that sheds the next step
+    double restore_load = 0.7;     // ... and below which the last step is restored
+    double degrade_seconds = 0.5;  // How long the load must stay over before shedding
+    double restore_seconds = 3.0;  // ... and under before restoring
+    int hud_interval = 3;          // hud_rate: refresh HUD values every N frames
+    int detector_throttle = 2;     // detector: multiply the detector's frame interval
+    double render_scale = 0.5;     // resolution: display/HUD resolution, upscaled by the window
+    // Share of the frame budget each step's stage may use before it is shed out of order
+    std::map<std::string, double> stage_budgets = {
+        {"hud_rate", 0.2}, {"detector", 0.15}, {"effects", 0.3}, {"resolution", 0.25}};
+};
+
+// How the render loop runs its per-frame stages
+struct PipelineConfig {
+    std::string mode = "serial";   // "serial" (one thread) or "graph" (pipelined stages)
+    int depth = 3;                 // graph: frames in flight; more trades latency for throughput
+    int workers = 0;               // graph: stage worker threads; 0 = one per stage, at most the core count
+};
+
+struct TrackerConfig {
+    bool enabled = true;
+    int window = 96;               // Source pixels around the crosshair to track
+    int filter_size = 64;          // Correlation filter size (resampled window)
+    double learning_rate = 0.125;
+    double psr_threshold = 7.0;    // Peak-to-sidelobe ratio below which the track is lost
+    double budget_ms = 1.0;        // Per-frame cost target; updates are skipped when exceeded
+    bool drive_gimbal = false;     // Steer the simulated gimbal to keep the target centred
+    float steering_gain = 2.0f;
+};
+
+struct ThreadConfig {
+    std::string name;              // pthread name (max 15 chars); defaults to "sar-<role>"
+    std::vector<int> cpus;         // CPU affinity; empty = float freely
+    int nice = 0;
+    int fifo_priority = 0;         // >0 requests SCHED_FIFO at this priority
+    int memory_node = -1;          // Preferred NUMA node for allocations made by this thread
+    std::string memory_follows;    // Or: allocate on the node of this role's first CPU
+};
+
+// Keyed by pipeline role: "capture", "render", "detector", ...
+using ThreadsConfig = std::map<std::string, ThreadConfig>;
+
+struct MetricsConfig {
+    bool enabled = false;
+    std::string bind = "127.0.0.1";
+    int port = 9464;
+    bool allow_remote = false;      // Required to bind anything but loopback (no auth, no TLS)
+};
+
+struct TraceConfig {
+    bool enabled = false;
+    int buffer_events = 65536;      // Per-thread ring size (most recent spans kept)
+    std::string output_dir = "traces";
 };
 
 struct WindowConfig {
@@ -53,9 +296,26 @@ struct WindowConfig {
 
 struct Config {
     VideoConfig video;
+    PlaybackConfig playback;
+    FrameBusConfig frame_bus;
     JoystickConfig joystick;
     HudConfig hud;
     RecordingConfig recording;
+    DetectorConfig detector;
+    ScenarioConfig scenario;
+    EffectsConfig effects;
+    EnhanceConfig enhance;
+    GimbalConfig gimbal;
+    GimbalLinkConfig gimbal_link;
+    TelemetryConfig telemetry;
+    MapConfig map;
+    ReplayConfig replay;
+    GovernorConfig governor;
+    PipelineConfig pipeline;
+    TrackerConfig tracker;
+    ThreadsConfig threads;
+    MetricsConfig metrics;
+    TraceConfig trace;
     WindowConfig window;
     
     static Config load(const std::string& path);
@@ -0,0 +1,215 @@
+#include "detector.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <cmath>
+
+namespace sar {
+
+// Background model is reset while the view moves faster than this (processing px/frame)
+static constexpr double kMaxStableShift = 1.5;
+
+static Counter& s_processed = Metrics::instance().counter(
+    "sar_detector_frames_total", "Frames processed by the detector");
+static Counter& s_skipped = Metrics::instance().counter(
+    "sar_detector_skipped_frames_total", "Submitted frames replaced before the detector reached them");
+static Gauge& s_latency = Metrics::instance().gauge(
+    "sar_detector_latency_ms", "Smoothed detector submit-to-publish latency");
+static Histogram& s_processTime = Metrics::instance().stage("detector");
+
+Detector::Detector() {}
+
+Detector::~Detector() {
+    shutdown();
+}
+
+bool Detector::init(const DetectorConfig& config) {
+    m_config = config;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    if (m_config.scale <= 0.0 || m_config.scale > 1.0) m_config.scale = 0.25;
+    if (m_config.frame_interval < 1) m_config.frame_interval = 1;
+    
+    m_subtractor = cv::createBackgroundSubtractorMOG2(m_config.history, m_config.var_threshold, false);
+    m_kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(3, 3));
+    
+    m_rateStart = Clock::now();
+    m_running = true;
+    m_thread = std::thread(&Detector::workerThread, this);
+    
+    std::cout << "Detector started: scale " << m_config.scale
+              << ", every " << m_config.frame_interval << " frame(s)" << std::endl;
+    return true;
+}
+
+void Detector::shutdown() {
+    if (!m_running) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_inputMutex);
+        m_running = false;
+    }
+    m_inputCv.notify_all();
+    
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    DetectorStats stats = getStats();
+    std::cout << "Detector stopped: " << stats.processed << " frames processed, "
+              << stats.skipped << " skipped" << std::endl;
+}
+
+void Detector::submit(const cv::Mat& frame, uint64_t sequence) {
+    if (!m_running || frame.empty()) return;
+    
+    // Decimate by rate; the same sequence may be offered more than once
+    if (m_lastSubmitted != 0 && sequence < m_lastSubmitted + static_cast<uint64_t>(m_config.frame_interval) * m_throttle) return;
+    
+    // Never wait for the worker: if it holds the mailbox, drop this frame
+    std::unique_lock<std::mutex> lock(m_inputMutex, std::try_to_lock);
+    if (!lock.owns_lock()) return;
+    
+    if (m_hasPending) {
+        std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_stats.skipped++;
+        s_skipped.inc();
+    }
+    
+    // Shallow copy: Video hands out a fresh buffer per frame, so this one is never written again
+    m_pendingFrame = frame;
+    m_pendingSequence = sequence;
+    m_pendingTime = Clock::now();
+    m_hasPending = true;
+    m_lastSubmitted = sequence;
+    
+    lock.unlock();
+    m_inputCv.notify_one();
+}
+
+bool Detector::getResult(DetectionResult& result) {
+    if (m_resultVersion.load() == m_readVersion) return false;
+    
+    std::unique_lock<std::mutex> lock(m_resultMutex, std::try_to_lock);
+    if (!lock.owns_lock()) return false;
+    
+    result.sequence = m_result.sequence;
+    result.boxes = m_result.boxes;
+    result.motion = m_result.motion;
+    m_readVersion = m_resultVersion.load();
+    return true;
+}
+
+DetectorStats Detector::getStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void Detector::workerThread() {
+    applyThreadTopology("detector");
+    
+    cv::Mat frame;
+    uint64_t sequence = 0;
+    Clock::time_point submitted;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_inputMutex);
+            m_inputCv.wait(lock, [this] { return m_hasPending || !m_running; });
+            if (!m_running) break;
+            
+            frame = std::move(m_pendingFrame);
+            m_pendingFrame = cv::Mat();
+            sequence = m_pendingSequence;
+            submitted = m_pendingTime;
+            m_hasPending = false;
+        }
+        
+        {
+            SAR_TRACE_SCOPE("detector.process");
+            ScopedTimer timer(s_processTime);
+            process(frame, sequence);
+        }
+        frame.release();
+        s_processed.inc();
+        
+        auto now = Clock::now();
+        double latencyMs = std::chrono::duration<double, std::milli>(now - submitted).count();
+        
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.processed++;
+        m_stats.latencyMs = (m_stats.processed == 1) ? latencyMs
+                                                     : m_stats.latencyMs * 0.9 + latencyMs * 0.1;
+        s_latency.set(m_stats.latencyMs);
+        m_rateCount++;
+        double elapsed = std::chrono::duration<double>(now - m_rateStart).count();
+        if (elapsed >= 1.0) {
+            m_stats.fps = m_rateCount / elapsed;
+            m_rateCount = 0;
+            m_rateStart = now;
+        }
+    }
+}
+
+void Detector::process(const cv::Mat& frame, uint64_t sequence) {
+    const double scale = m_config.scale;
+    
+    cv::resize(frame, m_small, cv::Size(), scale, scale, cv::INTER_AREA);
+    cv::cvtColor(m_small, m_gray, cv::COLOR_BGR2GRAY);
+    m_gray.convertTo(m_grayFloat, CV_32F);
+    
+    // Global motion between processed frames so the HUD can carry boxes forward
+    double learningRate = -1.0;
+    if (!m_prevGrayFloat.empty() && m_prevGrayFloat.size() == m_grayFloat.size() &&
+        sequence > m_prevSequence) {
+        if (m_window.size() != m_grayFloat.size()) {
+            cv::createHanningWindow(m_window, m_grayFloat.size(), CV_32F);
+        }
+        
+        cv::Point2d shift = cv::phaseCorrelate(m_prevGrayFloat, m_grayFloat, m_window);
+        double frames = static_cast<double>(sequence - m_prevSequence);
+        m_motion = cv::Point2f(static_cast<float>(shift.x / scale / frames),
+                               static_cast<float>(shift.y / scale / frames));
+        
+        // A panning camera invalidates the background model; relearn instead of flagging everything
+        if (std::hypot(shift.x, shift.y) > kMaxStableShift * frames) {
+            learningRate = 1.0;
+        }
+    } else {
+        m_motion = cv::Point2f(0, 0);
+        learningRate = 1.0;
+    }
+    std::swap(m_prevGrayFloat, m_grayFloat);
+    m_prevSequence = sequence;
+    
+    m_subtractor->apply(m_small, m_mask, learningRate);
+    cv::morphologyEx(m_mask, m_mask, cv::MORPH_OPEN, m_kernel);
+    
+    int count = cv::connectedComponentsWithStats(m_mask, m_labels, m_ccStats, m_centroids, 8, CV_32S);
+    
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_result.sequence = sequence;
+    m_result.motion = m_motion;
+    m_result.boxes.clear();
+    
+    // Label 0 is the background
+    for (int i = 1; i < count; i++) {
+        if (static_cast<int>(m_result.boxes.size()) >= m_config.max_detections) break;
+        
+        const int* s = m_ccStats.ptr<int>(i);
+        if (s[cv::CC_STAT_AREA] < m_config.min_area) continue;
+        
+        m_result.boxes.emplace_back(
+            static_cast<int>(s[cv::CC_STAT_LEFT] / scale),
+            static_cast<int>(s[cv::CC_STAT_TOP] / scale),
+            static_cast<int>(std::ceil(s[cv::CC_STAT_WIDTH] / scale)),
+            static_cast<int>(std::ceil(s[cv::CC_STAT_HEIGHT] / scale)));
+    }
+    m_resultVersion++;
+}
+
+} // namespace sar
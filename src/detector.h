@@ -0,0 +1,93 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include "config.h"
+
+namespace sar {
+
+struct DetectionResult {
+    uint64_t sequence = 0;          // Source frame the boxes were computed on
+    std::vector<cv::Rect> boxes;    // Source frame pixel coordinates
+    cv::Point2f motion;             // Global image motion, source pixels per frame
+};
+
+struct DetectorStats {
+    double fps = 0;                 // Detector throughput
+    double latencyMs = 0;           // Submit-to-publish latency (smoothed)
+    uint64_t processed = 0;
+    uint64_t skipped = 0;           // Submitted frames overwritten before processing
+};
+
+class Detector {
+public:
+    Detector();
+    ~Detector();
+    
+    bool init(const DetectorConfig& config);
+    void shutdown();
+    
+    // Called from the display loop; never blocks on the worker
+    void submit(const cv::Mat& frame, uint64_t sequence);
+    bool getResult(DetectionResult& result);
+    
+    // Frame-time governor: submit only every factor * frame_interval frames
+    void setThrottle(int factor) { m_throttle = std::max(1, factor); }
+    
+    DetectorStats getStats() const;
+    bool isRunning() const { return m_running.load(); }
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    void workerThread();
+    void process(const cv::Mat& frame, uint64_t sequence);
+    
+    DetectorConfig m_config;
+    cv::Ptr<cv::BackgroundSubtractorMOG2> m_subtractor;
+    cv::Mat m_kernel;
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    // Single-slot mailbox: the newest submitted frame replaces any unprocessed one
+    std::mutex m_inputMutex;
+    std::condition_variable m_inputCv;
+    cv::Mat m_pendingFrame;
+    uint64_t m_pendingSequence = 0;
+    Clock::time_point m_pendingTime;
+    bool m_hasPending = false;
+    uint64_t m_lastSubmitted = 0;
+    int m_throttle = 1;
+    
+    std::mutex m_resultMutex;
+    DetectionResult m_result;
+    std::atomic<uint64_t> m_resultVersion{0};
+    uint64_t m_readVersion = 0;
+    
+    // Worker-owned scratch buffers
+    cv::Mat m_small;
+    cv::Mat m_gray;
+    cv::Mat m_grayFloat;
+    cv::Mat m_prevGrayFloat;
+    cv::Mat m_window;
+    cv::Mat m_mask;
+    cv::Mat m_labels;
+    cv::Mat m_ccStats;
+    cv::Mat m_centroids;
+    uint64_t m_prevSequence = 0;
+    cv::Point2f m_motion;
+    
+    mutable std::mutex m_statsMutex;
+    DetectorStats m_stats;
+    Clock::time_point m_rateStart;
+    uint64_t m_rateCount = 0;
+};
+
+} // namespace sar
@@ -0,0 +1,279 @@
+#include "effects.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace sar {
+
+// Rows per parallel band; small enough to spread 1080p over many cores
+static constexpr int kBandRows = 64;
+
+// Noise source length per sign; each row reads a randomly offset window of it
+static constexpr size_t kNoiseLength = 1 << 22;
+
+static Counter& s_overBudget = Metrics::instance().counter(
+    "sar_effects_over_budget_total", "Frames whose sensor effects exceeded effects.budget_ms");
+static Histogram& s_effectsTime = Metrics::instance().stage("effects");
+
+static const char* const kPaletteNames[] = {"none", "white_hot", "black_hot", "ironbow", "rainbow"};
+
+struct PaletteStop {
+    double at;
+    int r, g, b;
+};
+
+static const PaletteStop kIronbow[] = {
+    {0.0, 0, 0, 0}, {0.2, 60, 0, 120}, {0.4, 160, 0, 140}, {0.6, 230, 60, 30},
+    {0.8, 255, 170, 0}, {1.0, 255, 255, 230}
+};
+
+static const PaletteStop kRainbow[] = {
+    {0.0, 0, 0, 128}, {0.2, 0, 0, 255}, {0.4, 0, 255, 255}, {0.6, 0, 255, 0},
+    {0.8, 255, 255, 0}, {1.0, 255, 0, 0}
+};
+
+template <size_t N>
+static void fillGradient(cv::Mat& lut, const PaletteStop (&stops)[N]) {
+    for (int i = 0; i < 256; i++) {
+        double t = i / 255.0;
+        size_t k = 1;
+        while (k < N - 1 && stops[k].at < t) k++;
+        const PaletteStop& a = stops[k - 1];
+        const PaletteStop& b = stops[k];
+        double f = std::clamp((t - a.at) / (b.at - a.at), 0.0, 1.0);
+        lut.at<cv::Vec3b>(0, i) = cv::Vec3b(cv::saturate_cast<uint8_t>(a.b + (b.b - a.b) * f),
+                                            cv::saturate_cast<uint8_t>(a.g + (b.g - a.g) * f),
+                                            cv::saturate_cast<uint8_t>(a.r + (b.r - a.r) * f));
+    }
+}
+
+static uint64_t mixBits(uint64_t x) {
+    // splitmix64 finaliser
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+Effects::Effects() {}
+
+void Effects::init(const EffectsConfig& config, const GimbalConfig& gimbal) {
+    m_config = config;
+    m_gimbal = gimbal;
+    
+    int palette = 0;
+    for (int i = 0; i < static_cast<int>(ThermalPalette::Count); i++) {
+        if (config.palette == kPaletteNames[i]) palette = i;
+    }
+    if (palette == 0 && config.palette != "none") {
+        std::cerr << "Effects: unknown palette '" << config.palette << "', using none" << std::endl;
+    }
+    m_palette = palette;
+    
+    buildPalettes();
+    if (m_config.noise_sigma > 0) {
+        buildNoise();
+    }
+    
+    bool configured = palette != 0 || m_config.noise_sigma > 0 || m_config.haze_visibility > 0 ||
+                      m_config.motion_blur_ms > 0 || m_config.dead_pixels > 0;
+    m_active = config.enabled && configured;
+    
+    if (m_active) {
+        std::cout << "Sensor effects: palette " << kPaletteNames[palette] << ", noise " << m_config.noise_sigma
+                  << ", haze visibility " << m_config.haze_visibility << " m, motion blur "
+                  << m_config.motion_blur_ms << " ms, " << m_config.dead_pixels << " dead pixels" << std::endl;
+    }
+}
+
+void Effects::buildPalettes() {
+    for (auto& lut : m_palettes) {
+        lut.create(1, 256, CV_8UC3);
+    }
+    for (int i = 0; i < 256; i++) {
+        uint8_t v = static_cast<uint8_t>(i);
+        m_palettes[static_cast<int>(ThermalPalette::None)].at<cv::Vec3b>(0, i) = cv::Vec3b(v, v, v);
+        m_palettes[static_cast<int>(ThermalPalette::WhiteHot)].at<cv::Vec3b>(0, i) = cv::Vec3b(v, v, v);
+        m_palettes[static_cast<int>(ThermalPalette::BlackHot)].at<cv::Vec3b>(0, i) =
+            cv::Vec3b(255 - v, 255 - v, 255 - v);
+    }
+    fillGradient(m_palettes[static_cast<int>(ThermalPalette::Ironbow)], kIronbow);
+    fillGradient(m_palettes[static_cast<int>(ThermalPalette::Rainbow)], kRainbow);
+    m_lut.create(1, 256, CV_8UC3);
+}
+
+void Effects::buildNoise() {
+    // Fixed seed, so a session replays with the same noise
+    std::mt19937 rng(static_cast<uint32_t>(m_config.noise_seed));
+    std::normal_distribution<float> normal(0.0f, m_config.noise_sigma);
+    
+    m_noisePos.resize(kNoiseLength);
+    m_noiseNeg.resize(kNoiseLength);
+    for (size_t i = 0; i < kNoiseLength; i++) {
+        int n = static_cast<int>(std::lround(normal(rng)));
+        n = std::clamp(n, -255, 255);
+        m_noisePos[i] = static_cast<uint8_t>(std::max(n, 0));
+        m_noiseNeg[i] = static_cast<uint8_t>(std::max(-n, 0));
+    }
+}
+
+void Effects::placeDeadPixels(cv::Size size) {
+    std::mt19937 rng(static_cast<uint32_t>(m_config.noise_seed) * 2654435761u + 1);
+    std::uniform_int_distribution<int> xs(0, size.width - 1);
+    std::uniform_int_distribution<int> ys(0, size.height - 1);
+    std::uniform_real_distribution<float> kind(0.0f, 1.0f);
+    
+    m_deadPixels.clear();
+    for (int i = 0; i < m_config.dead_pixels; i++) {
+        // Mostly dead, some stuck hot
+        m_deadPixels.push_back({ys(rng), xs(rng), static_cast<uint8_t>(kind(rng) < 0.7f ? 0 : 255)});
+    }
+    std::sort(m_deadPixels.begin(), m_deadPixels.end(),
+              [](const DeadPixel& a, const DeadPixel& b) { return a.y < b.y; });
+    m_deadPixelSize = size;
+}
+
+void Effects::updateLut(ThermalPalette palette, double hazeAlpha) {
+    if (palette == m_lutPalette && std::abs(hazeAlpha - m_lutHaze) < 1.0 / 512.0) return;
+    m_lutPalette = palette;
+    m_lutHaze = hazeAlpha;
+    
+    const double keep = 1.0 - hazeAlpha;
+    const auto& h = m_config.haze_color;
+    const cv::Mat& source = m_palettes[static_cast<int>(palette)];
+    
+    for (int i = 0; i < 256; i++) {
+        cv::Vec3b& out = m_lut.at<cv::Vec3b>(0, i);
+        if (palette == ThermalPalette::None) {
+            // Colour haze per channel (BGR)
+            out = cv::Vec3b(cv::saturate_cast<uint8_t>(i * keep + h[2] * hazeAlpha),
+                            cv::saturate_cast<uint8_t>(i * keep + h[1] * hazeAlpha),
+                            cv::saturate_cast<uint8_t>(i * keep + h[0] * hazeAlpha));
+        } else {
+            // Thermal haze flattens contrast toward the haze brightness before the palette
+            double hazeGray = 0.299 * h[0] + 0.587 * h[1] + 0.114 * h[2];
+            out = source.at<cv::Vec3b>(0, cv::saturate_cast<uint8_t>(i * keep + hazeGray * hazeAlpha));
+        }
+    }
+}
+
+void Effects::apply(cv::Mat& frame, const GimbalState& gimbal, const GroundPoint& target, uint64_t sequence) {
+    if (!m_active || frame.empty() || frame.type() != CV_8UC3) return;
+    
+    SAR_TRACE_SCOPE("effects");
+    ScopedTimer timer(s_effectsTime);
+    auto start = std::chrono::steady_clock::now();
+    
+    const ThermalPalette palette = static_cast<ThermalPalette>(m_palette.load());
+    const double stripes = std::max(1, frame.rows / kBandRows);
+    
+    // Motion blur reads neighbouring rows, so it writes a second buffer
+    if (m_config.motion_blur_ms > 0 && !m_reduced) {
+        double pixelsPerDegree = frame.cols / std::max(gimbal.hfov, 0.1f);
+        double exposure = m_config.motion_blur_ms / 1000.0;
+        int lx = static_cast<int>(std::lround(std::abs(gimbal.panRate * m_gimbal.max_pan_rate) * exposure * pixelsPerDegree));
+        int ly = static_cast<int>(std::lround(std::abs(gimbal.tiltRate * m_gimbal.max_tilt_rate) * exposure * pixelsPerDegree));
+        lx = std::clamp(lx, 1, std::max(1, frame.cols / 8));
+        ly = std::clamp(ly, 1, std::max(1, frame.rows / 8));
+        
+        if (lx > 1 || ly > 1) {
+            SAR_TRACE_SCOPE("effects.blur");
+            // The previous frame may still be queued for the recorder; never write into it
+            if (m_scratch.u && m_scratch.u->refcount > 1) {
+                m_scratch.release();
+            }
+            m_scratch.create(frame.size(), frame.type());
+            const cv::Mat source = frame;
+            cv::Mat blurred = m_scratch;
+            cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+                cv::Rect band(0, rows.start, source.cols, rows.end - rows.start);
+                cv::Mat out = blurred(band);
+                cv::blur(source(band), out, cv::Size(lx, ly), cv::Point(-1, -1), cv::BORDER_REPLICATE);
+            }, stripes);
+            std::swap(frame, m_scratch);
+        }
+    }
+    
+    // Haze thickens with range: the ground point when known, otherwise zoom
+    double hazeAlpha = 0.0;
+    if (m_config.haze_visibility > 0) {
+        double range = target.valid ? target.slantRange
+                                    : m_config.haze_range * gimbal.zoom / std::max(m_gimbal.min_zoom, 0.01f);
+        hazeAlpha = 1.0 - std::exp(-range / m_config.haze_visibility);
+    }
+    const bool thermal = palette != ThermalPalette::None;
+    const bool lutPass = thermal || hazeAlpha >= 1.0 / 256.0;
+    if (lutPass) {
+        updateLut(palette, hazeAlpha);
+    }
+    
+    const bool noise = !m_reduced && !m_noisePos.empty();
+    if (m_config.dead_pixels > 0 && frame.size() != m_deadPixelSize) {
+        placeDeadPixels(frame.size());
+    }
+    
+    if (!lutPass && !noise && m_deadPixels.empty()) return;
+    
+    // Adds this frame's noise to rows [begin, end) of an 8-bit image, one randomly
+    // offset window of the noise source per row
+    const uint64_t seed = mixBits(static_cast<uint64_t>(m_config.noise_seed) ^ mixBits(sequence));
+    auto addNoise = [&](cv::Mat& image, int firstRow) {
+        const int rowBytes = image.cols * image.channels();
+        const size_t span = kNoiseLength - static_cast<size_t>(rowBytes);
+        for (int y = 0; y < image.rows; y++) {
+            size_t offset = mixBits(seed + static_cast<uint64_t>(firstRow + y)) % span;
+            cv::Mat row(1, rowBytes, CV_8U, image.ptr(y));
+            cv::add(row, cv::Mat(1, rowBytes, CV_8U, &m_noisePos[offset]), row);
+            cv::subtract(row, cv::Mat(1, rowBytes, CV_8U, &m_noiseNeg[offset]), row);
+        }
+    };
+    
+    cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+        cv::Rect band(0, rows.start, frame.cols, rows.end - rows.start);
+        cv::Mat image = frame(band);
+        
+        if (thermal) {
+            // Sensor noise lives in the intensity image, before the palette
+            thread_local cv::Mat gray;
+            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+            if (noise) addNoise(gray, rows.start);
+            cv::cvtColor(gray, image, cv::COLOR_GRAY2BGR);
+            cv::LUT(image, m_lut, image);
+        } else {
+            if (lutPass) cv::LUT(image, m_lut, image);
+            if (noise) addNoise(image, rows.start);
+        }
+        
+        auto it = std::lower_bound(m_deadPixels.begin(), m_deadPixels.end(), rows.start,
+                                   [](const DeadPixel& p, int y) { return p.y < y; });
+        for (; it != m_deadPixels.end() && it->y < rows.end; ++it) {
+            frame.at<cv::Vec3b>(it->y, it->x) = cv::Vec3b(it->value, it->value, it->value);
+        }
+    }, stripes);
+    
+    double costMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (m_config.budget_ms > 0 && costMs > m_config.budget_ms) {
+        s_overBudget.inc();
+    }
+}
+
+void Effects::toggle() {
+    m_active = !m_active;
+    std::cout << "Sensor effects " << (m_active ? "on" : "off") << std::endl;
+}
+
+void Effects::cyclePalette() {
+    int next = (m_palette.load() + 1) % static_cast<int>(ThermalPalette::Count);
+    m_palette = next;
+    m_active = true;
+    std::cout << "Sensor palette: " << kPaletteNames[next] << std::endl;
+}
+
+const char* Effects::paletteName() const {
+    return kPaletteNames[m_palette.load()];
+}
+
+} // namespace sar
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "config.h"
+#include "gimbal.h"
+#include "geo.h"
+
+namespace sar {
+
+enum class ThermalPalette : uint8_t { None, WhiteHot, BlackHot, Ironbow, Rainbow, Count };
+
+// Simulated sensor degradation applied in place to each source frame. Every stage
+// runs over horizontal bands in parallel, and each band is a handful of OpenCV
+// vector kernels (LUT, saturating add/subtract, box filter).
+class Effects {
+public:
+    Effects();
+    
+    void init(const EffectsConfig& config, const GimbalConfig& gimbal);
+    
+    // target supplies the haze range when valid; sequence seeds the frame's noise, so
+    // a repeated source frame gets identical noise
+    void apply(cv::Mat& frame, const GimbalState& gimbal, const GroundPoint& target, uint64_t sequence);
+    
+    // Runtime switches (joystick buttons); safe from any thread
+    void toggle();
+    void cyclePalette();
+    bool isActive() const { return m_active.load(); }
+    
+    // Frame-time governor: drop motion blur and noise, the per-pixel passes; palette,
+    // haze and dead pixels stay so the picture keeps its character
+    void setReduced(bool reduced) { m_reduced = reduced; }
+    const char* paletteName() const;
+    
+private:
+    void buildPalettes();
+    void buildNoise();
+    void placeDeadPixels(cv::Size size);
+    void updateLut(ThermalPalette palette, double hazeAlpha);
+    
+    EffectsConfig m_config;
+    GimbalConfig m_gimbal;
+    
+    std::atomic<bool> m_active{false};
+    std::atomic<int> m_palette{0};
+    bool m_reduced = false;             // Render thread only
+    
+    // 256-entry BGR palettes, and the per-frame LUT with haze folded in
+    cv::Mat m_palettes[static_cast<int>(ThermalPalette::Count)];
+    cv::Mat m_lut;
+    ThermalPalette m_lutPalette = ThermalPalette::Count;
+    double m_lutHaze = -1.0;
+    
+    // Gaussian noise split into saturating positive and negative parts
+    std::vector<uint8_t> m_noisePos;
+    std::vector<uint8_t> m_noiseNeg;
+    
+    struct DeadPixel {
+        int y;
+        int x;
+        uint8_t value;                  // 0 dead, 255 stuck hot
+    };
+    std::vector<DeadPixel> m_deadPixels;    // Sorted by row
+    cv::Size m_deadPixelSize;
+    
+    cv::Mat m_scratch;                  // Motion blur target, swapped with the frame
+};
+
+} // namespace sar
@@ -0,0 +1,374 @@
+#include "enhance.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+namespace sar {
+
+// Work tiles: a 256x64 BGR tile and its luma planes stay within L2
+static constexpr int kTileCols = 256;
+static constexpr int kTileRows = 64;
+
+// Dehaze estimates transmission at this fraction of the frame size
+static constexpr int kDehazeScale = 4;
+
+// Floor on transmission; lower values blow up noise in the densest haze and sky
+static constexpr double kMinTransmission = 0.15;
+
+// Fraction of the haziest pixels whose brightness gives the airlight
+static constexpr double kAirlightFraction = 0.001;
+
+// Subsampling step of the CLAHE tile signature, in both directions
+static constexpr int kSignatureStep = 4;
+
+static Counter& s_overBudget = Metrics::instance().counter(
+    "sar_enhance_over_budget_total", "Frames whose enhancement exceeded enhance.budget_ms");
+static Counter& s_tilesBuilt = Metrics::instance().counter(
+    "sar_enhance_histograms_total", "CLAHE tile histograms computed");
+static Counter& s_tilesReused = Metrics::instance().counter(
+    "sar_enhance_histograms_reused_total", "CLAHE tiles that kept the previous frame's histogram");
+static Histogram& s_enhanceTime = Metrics::instance().stage("enhance");
+
+static const char* const kStageNames[] = {"clahe", "dehaze", "sharpen"};
+
+struct StrengthRange {
+    float min;
+    float max;
+    float step;
+};
+
+// CLAHE clip limit, fraction of haze removed, unsharp amount
+static const StrengthRange kStrengthRange[] = {{1.0f, 8.0f, 0.5f}, {0.1f, 0.95f, 0.05f}, {0.1f, 3.0f, 0.2f}};
+
+Enhancer::Enhancer() {
+    for (int i = 0; i < static_cast<int>(EnhanceStage::Count); i++) {
+        m_enabled[i] = false;
+        m_strength[i] = 0.0f;
+    }
+}
+
+void Enhancer::init(const EnhanceConfig& config) {
+    m_config = config;
+    m_config.clahe_tiles = std::clamp(m_config.clahe_tiles, 1, 32);
+    if (m_config.dehaze_patch < 1) m_config.dehaze_patch = 15;
+    if (m_config.sharpen_sigma <= 0.0) m_config.sharpen_sigma = 1.5;
+    
+    auto clampStrength = [](EnhanceStage stage, double value) {
+        const StrengthRange& range = kStrengthRange[static_cast<int>(stage)];
+        return std::clamp(static_cast<float>(value), range.min, range.max);
+    };
+    m_strength[static_cast<int>(EnhanceStage::Clahe)] = clampStrength(EnhanceStage::Clahe, m_config.clahe_clip);
+    m_strength[static_cast<int>(EnhanceStage::Dehaze)] = clampStrength(EnhanceStage::Dehaze, m_config.dehaze_strength);
+    m_strength[static_cast<int>(EnhanceStage::Sharpen)] = clampStrength(EnhanceStage::Sharpen, m_config.sharpen_amount);
+    m_enabled[static_cast<int>(EnhanceStage::Clahe)] = m_config.clahe;
+    m_enabled[static_cast<int>(EnhanceStage::Dehaze)] = m_config.dehaze;
+    m_enabled[static_cast<int>(EnhanceStage::Sharpen)] = m_config.sharpen;
+    
+    m_reciprocal[0] = 65536 * 255;
+    for (int t = 1; t < 256; t++) {
+        m_reciprocal[t] = 65536 * 255 / t;
+    }
+}
+
+bool Enhancer::isActive() const {
+    for (const auto& enabled : m_enabled) {
+        if (enabled.load()) return true;
+    }
+    return false;
+}
+
+void Enhancer::toggle(EnhanceStage stage) {
+    const int index = static_cast<int>(stage);
+    bool on = !m_enabled[index].load();
+    m_enabled[index] = on;
+    if (on) m_selected = index;
+    m_generation++;
+    std::cout << "Enhancement " << kStageNames[index] << (on ? " on" : " off") << std::endl;
+}
+
+void Enhancer::adjustStrength(int direction) {
+    const int index = m_selected.load();
+    const StrengthRange& range = kStrengthRange[index];
+    float strength = std::clamp(m_strength[index].load() + (direction < 0 ? -range.step : range.step), range.min, range.max);
+    m_strength[index] = strength;
+    m_generation++;
+    std::cout << "Enhancement " << kStageNames[index] << " strength " << strength << std::endl;
+}
+
+void Enhancer::apply(cv::Mat& frame) {
+    if (frame.empty() || frame.type() != CV_8UC3 || !isActive()) return;
+    
+    SAR_TRACE_SCOPE("enhance");
+    ScopedTimer timer(s_enhanceTime);
+    auto start = std::chrono::steady_clock::now();
+    
+    if (frame.size() != m_size) {
+        m_size = frame.size();
+        m_tiles.clear();
+        for (int y = 0; y < frame.rows; y += kTileRows) {
+            for (int x = 0; x < frame.cols; x += kTileCols) {
+                m_tiles.emplace_back(x, y, std::min(kTileCols, frame.cols - x), std::min(kTileRows, frame.rows - y));
+            }
+        }
+        m_claheTiles.clear();
+        m_airlight = -1.0;
+    }
+    
+    cv::cvtColor(frame, m_luma, cv::COLOR_BGR2GRAY);
+    
+    // Each enabled stage reads the previous one's luma
+    const cv::Mat* luma = &m_luma;
+    if (m_enabled[static_cast<int>(EnhanceStage::Dehaze)]) {
+        dehaze(frame, *luma, m_dehazed, m_tiles);
+        luma = &m_dehazed;
+    }
+    if (m_enabled[static_cast<int>(EnhanceStage::Clahe)]) {
+        clahe(*luma, m_contrast, m_tiles);
+        luma = &m_contrast;
+    }
+    if (m_enabled[static_cast<int>(EnhanceStage::Sharpen)]) {
+        sharpen(*luma, m_sharpened, m_tiles);
+        luma = &m_sharpened;
+    }
+    
+    // Add the change in luma to every channel: brightness moves, colour differences stay
+    const cv::Mat& original = m_luma;
+    const cv::Mat& result = *luma;
+    cv::parallel_for_(cv::Range(0, static_cast<int>(m_tiles.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const cv::Rect& tile = m_tiles[i];
+            for (int y = tile.y; y < tile.y + tile.height; y++) {
+                const uint8_t* before = original.ptr<uint8_t>(y) + tile.x;
+                const uint8_t* after = result.ptr<uint8_t>(y) + tile.x;
+                uint8_t* pixel = frame.ptr<uint8_t>(y) + tile.x * 3;
+                for (int x = 0; x < tile.width; x++, pixel += 3) {
+                    int delta = after[x] - before[x];
+                    pixel[0] = cv::saturate_cast<uint8_t>(pixel[0] + delta);
+                    pixel[1] = cv::saturate_cast<uint8_t>(pixel[1] + delta);
+                    pixel[2] = cv::saturate_cast<uint8_t>(pixel[2] + delta);
+                }
+            }
+        }
+    });
+    
+    double costMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (m_config.budget_ms > 0 && costMs > m_config.budget_ms) {
+        s_overBudget.inc();
+    }
+}
+
+void Enhancer::dehaze(const cv::Mat& frame, const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles) {
+    SAR_TRACE_SCOPE("enhance.dehaze");
+    const double omega = m_strength[static_cast<int>(EnhanceStage::Dehaze)].load();
+    
+    // Dark channel (per-pixel minimum over B, G, R, then over a patch); haze lifts it
+    cv::resize(frame, m_small, cv::Size(std::max(1, frame.cols / kDehazeScale), std::max(1, frame.rows / kDehazeScale)),
+               0, 0, cv::INTER_AREA);
+    m_dark.create(m_small.size(), CV_8U);
+    for (int y = 0; y < m_small.rows; y++) {
+        const uint8_t* bgr = m_small.ptr<uint8_t>(y);
+        uint8_t* dark = m_dark.ptr<uint8_t>(y);
+        for (int x = 0; x < m_small.cols; x++, bgr += 3) {
+            dark[x] = std::min(bgr[0], std::min(bgr[1], bgr[2]));
+        }
+    }
+    int patch = std::max(3, (m_config.dehaze_patch / kDehazeScale) | 1);
+    cv::erode(m_dark, m_dark, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(patch, patch)));
+    
+    // Airlight: brightness of the haziest pixels, smoothed so it does not flicker
+    int histogram[256] = {};
+    for (int y = 0; y < m_dark.rows; y++) {
+        const uint8_t* dark = m_dark.ptr<uint8_t>(y);
+        for (int x = 0; x < m_dark.cols; x++) histogram[dark[x]]++;
+    }
+    int wanted = std::max(1, static_cast<int>(m_dark.total() * kAirlightFraction));
+    int threshold = 255;
+    for (int count = 0; threshold > 0 && (count += histogram[threshold]) < wanted; threshold--) {}
+    double sum = 0.0;
+    int samples = 0;
+    for (int y = 0; y < m_small.rows; y++) {
+        const uint8_t* bgr = m_small.ptr<uint8_t>(y);
+        const uint8_t* dark = m_dark.ptr<uint8_t>(y);
+        for (int x = 0; x < m_small.cols; x++, bgr += 3) {
+            if (dark[x] < threshold) continue;
+            sum += 0.114 * bgr[0] + 0.587 * bgr[1] + 0.299 * bgr[2];
+            samples++;
+        }
+    }
+    double airlight = samples > 0 ? sum / samples : 255.0;
+    m_airlight = m_airlight < 0 ? airlight : 0.9 * m_airlight + 0.1 * airlight;
+    const double a = std::max(m_airlight, 1.0);
+    
+    // Transmission t = 1 - omega * dark / A, 8-bit, upsampled bilinearly
+    for (int y = 0; y < m_dark.rows; y++) {
+        uint8_t* dark = m_dark.ptr<uint8_t>(y);
+        for (int x = 0; x < m_dark.cols; x++) {
+            double t = std::max(kMinTransmission, 1.0 - omega * dark[x] / a);
+            dark[x] = static_cast<uint8_t>(std::lround(t * 255.0));
+        }
+    }
+    cv::resize(m_dark, m_transmission, luma.size(), 0, 0, cv::INTER_LINEAR);
+    
+    // Scene radiance J = (I - A) / t + A, fixed point
+    out.create(luma.size(), CV_8U);
+    const int airlightLevel = static_cast<int>(std::lround(a));
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const cv::Rect& tile = tiles[i];
+            for (int y = tile.y; y < tile.y + tile.height; y++) {
+                const uint8_t* in = luma.ptr<uint8_t>(y) + tile.x;
+                const uint8_t* t = m_transmission.ptr<uint8_t>(y) + tile.x;
+                uint8_t* o = out.ptr<uint8_t>(y) + tile.x;
+                for (int x = 0; x < tile.width; x++) {
+                    int recovered = airlightLevel + (((in[x] - airlightLevel) * m_reciprocal[t[x]]) >> 16);
+                    o[x] = cv::saturate_cast<uint8_t>(recovered);
+                }
+            }
+        }
+    });
+}
+
+void Enhancer::buildClaheLut(const cv::Mat& tile, ClaheTile& state, double clip) {
+    int histogram[256] = {};
+    for (int y = 0; y < tile.rows; y++) {
+        const uint8_t* p = tile.ptr<uint8_t>(y);
+        for (int x = 0; x < tile.cols; x++) histogram[p[x]]++;
+    }
+    
+    // Clip at clip x the mean bin and spread the excess evenly
+    const int area = std::max(1, tile.rows * tile.cols);
+    const int limit = std::max(1, static_cast<int>(clip * area / 256));
+    int excess = 0;
+    for (int& bin : histogram) {
+        if (bin > limit) {
+            excess += bin - limit;
+            bin = limit;
+        }
+    }
+    const int bonus = excess / 256;
+    const int remainder = excess % 256;
+    
+    int cdf = 0;
+    for (int i = 0; i < 256; i++) {
+        cdf += histogram[i] + bonus + (i < remainder ? 1 : 0);
+        state.lut[i] = static_cast<uint8_t>(std::min<int64_t>(255, (static_cast<int64_t>(cdf) * 255 + area / 2) / area));
+    }
+}
+
+void Enhancer::clahe(const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles) {
+    SAR_TRACE_SCOPE("enhance.clahe");
+    const int grid = m_config.clahe_tiles;
+    const int tileWidth = (luma.cols + grid - 1) / grid;
+    const int tileHeight = (luma.rows + grid - 1) / grid;
+    
+    if (m_gridX != grid || m_gridY != grid || m_claheTiles.size() != static_cast<size_t>(grid * grid) ||
+        m_colTile.size() != static_cast<size_t>(luma.cols)) {
+        m_gridX = grid;
+        m_gridY = grid;
+        m_claheTiles.assign(grid * grid, ClaheTile());
+        
+        // Each column blends the LUTs of the two nearest tile centres
+        m_colTile.resize(luma.cols);
+        m_colWeight.resize(luma.cols);
+        for (int x = 0; x < luma.cols; x++) {
+            double f = (x + 0.5) / tileWidth - 0.5;
+            int t = static_cast<int>(std::floor(f));
+            double w = f - t;
+            if (t < 0) { t = 0; w = 0.0; }
+            if (t >= grid - 1) { t = grid - 1; w = 0.0; }
+            m_colTile[x] = t;
+            m_colWeight[x] = static_cast<int>(std::lround(w * 256.0));
+        }
+    }
+    
+    // Per-tile contrast LUTs; a tile whose content barely moved keeps its histogram
+    const double clip = m_strength[static_cast<int>(EnhanceStage::Clahe)].load();
+    const uint32_t generation = m_generation.load();
+    cv::parallel_for_(cv::Range(0, grid * grid), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            cv::Rect rect((i % grid) * tileWidth, (i / grid) * tileHeight, tileWidth, tileHeight);
+            rect &= cv::Rect(0, 0, luma.cols, luma.rows);
+            ClaheTile& state = m_claheTiles[i];
+            if (rect.width <= 0 || rect.height <= 0) {
+                for (int v = 0; v < 256; v++) state.lut[v] = static_cast<uint8_t>(v);
+                continue;
+            }
+            const cv::Mat tile = luma(rect);
+            
+            double sum = 0.0;
+            int samples = 0;
+            for (int y = 0; y < tile.rows; y += kSignatureStep) {
+                const uint8_t* p = tile.ptr<uint8_t>(y);
+                for (int x = 0; x < tile.cols; x += kSignatureStep, samples++) sum += p[x];
+            }
+            double signature = sum / std::max(1, samples);
+            
+            bool reuse = m_config.static_threshold > 0 && state.generation == generation &&
+                         state.age < m_config.static_refresh &&
+                         std::abs(signature - state.signature) < m_config.static_threshold;
+            if (reuse) {
+                state.age++;
+                s_tilesReused.inc();
+                continue;
+            }
+            buildClaheLut(tile, state, clip);
+            state.signature = signature;
+            state.age = 0;
+            state.generation = generation;
+            s_tilesBuilt.inc();
+        }
+    });
+    
+    // Bilinear blend of the four surrounding tiles' LUTs
+    out.create(luma.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const cv::Rect& tile = tiles[i];
+            for (int y = tile.y; y < tile.y + tile.height; y++) {
+                double f = (y + 0.5) / tileHeight - 0.5;
+                int ty = static_cast<int>(std::floor(f));
+                double w = f - ty;
+                if (ty < 0) { ty = 0; w = 0.0; }
+                if (ty >= grid - 1) { ty = grid - 1; w = 0.0; }
+                const int wy = static_cast<int>(std::lround(w * 256.0));
+                const ClaheTile* upper = &m_claheTiles[ty * grid];
+                const ClaheTile* lower = &m_claheTiles[std::min(ty + 1, grid - 1) * grid];
+                
+                const uint8_t* in = luma.ptr<uint8_t>(y);
+                uint8_t* o = out.ptr<uint8_t>(y);
+                for (int x = tile.x; x < tile.x + tile.width; x++) {
+                    const int t0 = m_colTile[x];
+                    const int t1 = std::min(t0 + 1, grid - 1);
+                    const int wx = m_colWeight[x];
+                    const uint8_t v = in[x];
+                    int top = upper[t0].lut[v] * (256 - wx) + upper[t1].lut[v] * wx;
+                    int bottom = lower[t0].lut[v] * (256 - wx) + lower[t1].lut[v] * wx;
+                    o[x] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + (1 << 15)) >> 16);
+                }
+            }
+        }
+    });
+}
+
+void Enhancer::sharpen(const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles) {
+    SAR_TRACE_SCOPE("enhance.sharpen");
+    const double amount = m_strength[static_cast<int>(EnhanceStage::Sharpen)].load();
+    const double sigma = m_config.sharpen_sigma;
+    
+    // Unsharp mask: out = luma + amount * (luma - blur); tiles read their neighbours' rows
+    out.create(luma.size(), CV_8U);
+    m_blurred.create(luma.size(), CV_8U);
+    cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            const cv::Rect& tile = tiles[i];
+            cv::Mat blurred = m_blurred(tile);
+            cv::Mat sharpened = out(tile);
+            cv::GaussianBlur(luma(tile), blurred, cv::Size(0, 0), sigma, sigma, cv::BORDER_REPLICATE);
+            cv::addWeighted(luma(tile), 1.0 + amount, blurred, -amount, 0.0, sharpened);
+        }
+    });
+}
+
+} // namespace sar
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+enum class EnhanceStage : uint8_t { Clahe, Dehaze, Sharpen, Count };
+
+// Operator-side image enhancement for low-visibility search: dark-channel dehaze,
+// local contrast (CLAHE) and unsharp masking. All three work on luma only; the
+// change in luma is added back to each colour channel, so hue is untouched. The
+// frame is cut into cache-sized tiles spread over OpenCV's thread pool, and CLAHE
+// tiles whose content has not changed keep last frame's histogram.
+class Enhancer {
+public:
+    Enhancer();
+    
+    void init(const EnhanceConfig& config);
+    
+    // In place; one caller at a time (the render loop or its graph stage)
+    void apply(cv::Mat& frame);
+    
+    // Runtime switches (keys, joystick buttons); safe from any thread. Strength
+    // changes apply to the stage most recently switched on.
+    void toggle(EnhanceStage stage);
+    void adjustStrength(int direction);
+    bool isActive() const;
+    
+private:
+    struct ClaheTile {
+        std::array<uint8_t, 256> lut;
+        double signature = -1.0;        // Subsampled mean of the tile's input
+        int age = 0;                    // Frames since the histogram was built
+        uint32_t generation = 0;        // Settings the LUT was built with
+    };
+    
+    void dehaze(const cv::Mat& frame, const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles);
+    void clahe(const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles);
+    void buildClaheLut(const cv::Mat& tile, ClaheTile& state, double clip);
+    void sharpen(const cv::Mat& luma, cv::Mat& out, const std::vector<cv::Rect>& tiles);
+    
+    EnhanceConfig m_config;
+    
+    std::atomic<bool> m_enabled[static_cast<int>(EnhanceStage::Count)];
+    std::atomic<float> m_strength[static_cast<int>(EnhanceStage::Count)];
+    std::atomic<int> m_selected{static_cast<int>(EnhanceStage::Clahe)};
+    std::atomic<uint32_t> m_generation{1};
+    
+    // Work tiles for the current frame size
+    cv::Size m_size;
+    std::vector<cv::Rect> m_tiles;
+    
+    // Luma planes between stages
+    cv::Mat m_luma;
+    cv::Mat m_dehazed;
+    cv::Mat m_contrast;
+    cv::Mat m_sharpened;
+    cv::Mat m_blurred;
+    
+    // Dehaze: transmission estimated at reduced resolution
+    cv::Mat m_small;
+    cv::Mat m_dark;
+    cv::Mat m_transmission;
+    double m_airlight = -1.0;
+    std::array<int, 256> m_reciprocal;   // 65536 * 255 / t for an 8-bit transmission t
+    
+    // CLAHE grid state and per-column interpolation weights
+    std::vector<ClaheTile> m_claheTiles;
+    int m_gridX = 0;
+    int m_gridY = 0;
+    std::vector<int> m_colTile;
+    std::vector<int> m_colWeight;       // 0..256 toward the next tile column
+};
+
+} // namespace sar
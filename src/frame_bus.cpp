@@ -0,0 +1,322 @@
+#include "frame_bus.h"
+#include <iostream>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace sar {
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static std::string segmentName(const std::string& name) {
+#ifdef _WIN32
+    return "Local\\" + name;
+#else
+    return "/" + name;
+#endif
+}
+
+static FrameBusSlot* slotsOf(FrameBusHeader* header) {
+    return reinterpret_cast<FrameBusSlot*>(reinterpret_cast<uint8_t*>(header) + sizeof(FrameBusHeader));
+}
+
+static const FrameBusSlot* slotsOf(const FrameBusHeader* header) {
+    return reinterpret_cast<const FrameBusSlot*>(reinterpret_cast<const uint8_t*>(header) + sizeof(FrameBusHeader));
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+FrameBusWriter::FrameBusWriter() {}
+
+FrameBusWriter::~FrameBusWriter() {
+    close();
+}
+
+void FrameBusWriter::open(const std::string& name, int slots) {
+    close();
+    m_name = name;
+    m_slots = slots < 2 ? 2 : slots;
+    m_warned = false;
+}
+
+void FrameBusWriter::close() {
+    release();
+    m_name.clear();
+}
+
+void FrameBusWriter::release() {
+    if (!m_header) return;
+    
+    // Tell attached readers to drop their mapping before the name goes away
+    m_header->closed.store(1, std::memory_order_release);
+    
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    m_mapping = nullptr;
+#else
+    munmap(m_base, m_size);
+    shm_unlink(segmentName(m_name).c_str());
+#endif
+    m_base = nullptr;
+    m_header = nullptr;
+    m_size = 0;
+}
+
+bool FrameBusWriter::create(int width, int height, int type, size_t rowBytes) {
+    const size_t stride = alignUp(rowBytes, 64);
+    const size_t slotBytes = alignUp(stride * static_cast<size_t>(height), 4096);
+    const size_t dataOffset = alignUp(sizeof(FrameBusHeader) + sizeof(FrameBusSlot) * m_slots, 4096);
+    const size_t size = dataOffset + slotBytes * m_slots;
+    const std::string name = segmentName(m_name);
+    
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                        static_cast<DWORD>(size & 0xFFFFFFFFu), name.c_str());
+    if (!mapping) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Readers still hold the previous segment; it is freed once they detach
+        CloseHandle(mapping);
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    m_mapping = mapping;
+#else
+    // Replace any segment left behind by a crashed writer
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+#endif
+    
+    m_base = static_cast<uint8_t*>(base);
+    m_size = size;
+    m_header = new (m_base) FrameBusHeader();
+    m_header->version = kFrameBusVersion;
+    m_header->slotCount = static_cast<uint32_t>(m_slots);
+    m_header->width = static_cast<uint32_t>(width);
+    m_header->height = static_cast<uint32_t>(height);
+    m_header->type = type;
+    m_header->stride = static_cast<uint32_t>(stride);
+    m_header->slotBytes = slotBytes;
+    m_header->dataOffset = dataOffset;
+    m_header->latest.store(0, std::memory_order_relaxed);
+    m_header->closed.store(0, std::memory_order_relaxed);
+#ifdef _WIN32
+    m_header->writerPid = static_cast<int32_t>(GetCurrentProcessId());
+#else
+    m_header->writerPid = static_cast<int32_t>(getpid());
+#endif
+    
+    FrameBusSlot* slots = slotsOf(m_header);
+    for (int i = 0; i < m_slots; i++) {
+        FrameBusSlot* slot = new (&slots[i]) FrameBusSlot();
+        slot->generation.store(0, std::memory_order_relaxed);
+        slot->timestampNs = 0;
+    }
+    
+    // Magic last: a reader attaching mid-setup sees an invalid segment and retries
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_header->magic, kFrameBusMagic, sizeof(kFrameBusMagic));
+    
+    std::cout << "Frame bus: publishing " << width << "x" << height << " frames to shared memory '"
+              << m_name << "' (" << m_slots << " slots, " << (size >> 20) << " MB)" << std::endl;
+    return true;
+}
+
+bool FrameBusWriter::publish(const uint8_t* data, int width, int height, int type, size_t stride,
+                             int64_t timestampNs) {
+    if (m_name.empty() || !data || width <= 0 || height <= 0) return false;
+    
+    // Bytes of pixel data per row, independent of the source's padding (OpenCV type encoding)
+    int channels = 1 + (type >> 3);
+    int depth = type & 7;
+    size_t depthBytes = depth < 2 ? 1 : (depth < 4 || depth == 7) ? 2 : depth == 6 ? 8 : 4;
+    size_t elementBytes = static_cast<size_t>(channels) * depthBytes;
+    size_t lineBytes = elementBytes * static_cast<size_t>(width);
+    
+    if (m_header && (m_header->width != static_cast<uint32_t>(width) ||
+                     m_header->height != static_cast<uint32_t>(height) || m_header->type != type)) {
+        release();
+    }
+    if (!m_header && !create(width, height, type, lineBytes)) {
+        if (!m_warned) {
+            std::cerr << "Frame bus: cannot create shared memory '" << m_name << "'" << std::endl;
+            m_warned = true;
+        }
+        return false;
+    }
+    
+    const uint64_t sequence = ++m_sequence;
+    FrameBusSlot& slot = slotsOf(m_header)[sequence % m_header->slotCount];
+    uint8_t* dst = m_base + m_header->dataOffset + (sequence % m_header->slotCount) * m_header->slotBytes;
+    
+    // Seqlock write: odd generation while the pixels are in flux
+    slot.generation.store(sequence * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    if (stride == lineBytes && lineBytes == m_header->stride) {
+        std::memcpy(dst, data, lineBytes * static_cast<size_t>(height));
+    } else {
+        for (int y = 0; y < height; y++) {
+            std::memcpy(dst + y * static_cast<size_t>(m_header->stride), data + y * stride, lineBytes);
+        }
+    }
+    slot.timestampNs = timestampNs;
+    
+    slot.generation.store(sequence * 2, std::memory_order_release);
+    m_header->latest.store(sequence, std::memory_order_release);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+FrameBusReader::FrameBusReader() {}
+
+FrameBusReader::~FrameBusReader() {
+    detach();
+}
+
+bool FrameBusReader::attach(const std::string& name) {
+    detach();
+    const std::string segment = segmentName(name);
+    
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, segment.c_str());
+    if (!mapping) return false;
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    size_t size = VirtualQuery(base, &info, sizeof(info)) ? info.RegionSize : 0;
+    m_mapping = mapping;
+#else
+    int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FrameBusHeader))) {
+        ::close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+#endif
+    
+    m_base = static_cast<const uint8_t*>(base);
+    m_size = size;
+    m_header = reinterpret_cast<const FrameBusHeader*>(m_base);
+    
+    // Reject half-initialised or foreign segments
+    const FrameBusHeader* h = m_header;
+    bool valid = std::memcmp(h->magic, kFrameBusMagic, sizeof(kFrameBusMagic)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && h->version == kFrameBusVersion && h->slotCount >= 2 &&
+            h->dataOffset >= sizeof(FrameBusHeader) + sizeof(FrameBusSlot) * h->slotCount &&
+            h->slotBytes >= static_cast<uint64_t>(h->stride) * h->height &&
+            h->dataOffset + h->slotBytes * h->slotCount <= m_size;
+    if (!valid) {
+        detach();
+        return false;
+    }
+    return true;
+}
+
+void FrameBusReader::detach() {
+    if (!m_base) return;
+    
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    m_mapping = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_base), m_size);
+#endif
+    m_base = nullptr;
+    m_header = nullptr;
+    m_size = 0;
+}
+
+bool FrameBusReader::writerClosed() const {
+    return m_header && m_header->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool FrameBusReader::writerAlive() const {
+    if (!m_header || m_header->writerPid <= 0) return false;
+    
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(m_header->writerPid));
+    if (!process) return GetLastError() == ERROR_ACCESS_DENIED;
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    // Signal 0 only checks; EPERM means it exists under another user
+    return kill(static_cast<pid_t>(m_header->writerPid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+bool FrameBusReader::acquire(FrameView& view, uint64_t after) const {
+    if (!m_header) return false;
+    
+    uint64_t sequence = m_header->latest.load(std::memory_order_acquire);
+    if (sequence == 0 || sequence <= after) return false;
+    
+    const uint32_t index = static_cast<uint32_t>(sequence % m_header->slotCount);
+    const FrameBusSlot& slot = slotsOf(m_header)[index];
+    if (slot.generation.load(std::memory_order_acquire) != sequence * 2) {
+        return false;   // Already being overwritten; the next call sees a newer frame
+    }
+    
+    view.data = m_base + m_header->dataOffset + index * m_header->slotBytes;
+    view.width = static_cast<int>(m_header->width);
+    view.height = static_cast<int>(m_header->height);
+    view.type = m_header->type;
+    view.stride = m_header->stride;
+    view.sequence = sequence;
+    view.timestampNs = slot.timestampNs;
+    return true;
+}
+
+bool FrameBusReader::stillValid(const FrameView& view) const {
+    if (!m_header || view.sequence == 0) return false;
+    
+    // Order the caller's pixel reads before re-checking the generation
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const FrameBusSlot& slot = slotsOf(m_header)[view.sequence % m_header->slotCount];
+    return slot.generation.load(std::memory_order_relaxed) == view.sequence * 2;
+}
+
+} // namespace sar
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sar {
+
+// Shared-memory frame ring published by the simulator and read by any number of
+// local processes. This header has no OpenCV or JSON dependency so viewers,
+// recorders and analysis tools can link the small sar_framebus library alone.
+//
+// Segment layout: FrameBusHeader, then slotCount FrameBusSlot records, then
+// slotCount frame buffers of slotBytes each (rows of `stride` bytes). Frame n
+// lives in slot n % slotCount. The writer never waits for readers: a slot's
+// generation is odd while it is being overwritten and 2 * sequence once the
+// frame is complete, so a reader that was too slow detects it rather than
+// blocking anyone.
+static constexpr char kFrameBusMagic[8] = {'S', 'A', 'R', 'F', 'B', 'U', 'S', '1'};
+static constexpr uint32_t kFrameBusVersion = 1;
+
+struct alignas(64) FrameBusHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t width;
+    uint32_t height;
+    int32_t type;                       // OpenCV type, e.g. CV_8UC3 (16)
+    uint32_t stride;                    // Bytes per row
+    uint64_t slotBytes;
+    uint64_t dataOffset;                // From the start of the segment
+    std::atomic<uint64_t> latest;       // Newest complete frame sequence, 0 = none yet
+    std::atomic<uint32_t> closed;       // Writer stopped or resized; detach and reattach
+    int32_t writerPid;
+};
+
+struct alignas(64) FrameBusSlot {
+    std::atomic<uint64_t> generation;   // 2 * sequence when readable, odd while being written
+    int64_t timestampNs;                // Writer steady clock at capture
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "frame bus needs lock-free 64-bit atomics");
+
+// A frame still in shared memory. Valid until the writer laps the ring; check
+// FrameBusReader::stillValid() after using the pixels.
+struct FrameView {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int type = 0;
+    size_t stride = 0;
+    uint64_t sequence = 0;
+    int64_t timestampNs = 0;
+};
+
+class FrameBusWriter {
+public:
+    FrameBusWriter();
+    ~FrameBusWriter();
+    
+    FrameBusWriter(const FrameBusWriter&) = delete;
+    FrameBusWriter& operator=(const FrameBusWriter&) = delete;
+    
+    // The segment is created on the first publish, sized for that frame
+    void open(const std::string& name, int slots);
+    void close();
+    
+    // Copies one frame into the next slot; recreates the segment if the geometry changed
+    bool publish(const uint8_t* data, int width, int height, int type, size_t stride, int64_t timestampNs);
+    
+    uint64_t getSequence() const { return m_sequence; }
+    
+private:
+    bool create(int width, int height, int type, size_t rowBytes);
+    void release();
+    
+    std::string m_name;
+    int m_slots = 4;
+    uint64_t m_sequence = 0;
+    bool m_warned = false;
+    
+    uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+    FrameBusHeader* m_header = nullptr;
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
+
+class FrameBusReader {
+public:
+    FrameBusReader();
+    ~FrameBusReader();
+    
+    FrameBusReader(const FrameBusReader&) = delete;
+    FrameBusReader& operator=(const FrameBusReader&) = delete;
+    
+    // Maps the segment read-only; false if no writer has published yet
+    bool attach(const std::string& name);
+    void detach();
+    bool isAttached() const { return m_header != nullptr; }
+    
+    // True once the writer has closed or resized the segment
+    bool writerClosed() const;
+    
+    // False if the writing process has exited without closing (crashed or killed);
+    // its segment stays mapped but will never see another frame
+    bool writerAlive() const;
+    
+    // Latest frame newer than `after`, without copying; false if there is none
+    bool acquire(FrameView& view, uint64_t after = 0) const;
+    
+    // False if the writer has started overwriting the view's slot since acquire()
+    bool stillValid(const FrameView& view) const;
+    
+private:
+    const uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+    const FrameBusHeader* m_header = nullptr;
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
+
+} // namespace sar
@@ -0,0 +1,291 @@
+#include "frame_graph.h"
+#include "threads.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+
+namespace sar {
+
+static Gauge& s_inFlight = Metrics::instance().gauge(
+    "sar_graph_frames_in_flight", "Frames between the source and the last stage of the frame graph");
+
+// Set on pool workers so submit() can prefer the caller's own deque
+static thread_local WorkerPool* t_pool = nullptr;
+static thread_local int t_worker = -1;
+
+FrameHandle::FrameHandle(FramePool* pool, int index, FrameSlot* slot)
+    : m_pool(pool), m_index(index), m_slot(slot) {}
+
+FrameHandle::FrameHandle(const FrameHandle& other)
+    : m_pool(other.m_pool), m_index(other.m_index), m_slot(other.m_slot) {
+    if (m_pool) m_pool->retain(m_index);
+}
+
+FrameHandle::FrameHandle(FrameHandle&& other) noexcept
+    : m_pool(other.m_pool), m_index(other.m_index), m_slot(other.m_slot) {
+    other.m_pool = nullptr;
+    other.m_index = -1;
+    other.m_slot = nullptr;
+}
+
+FrameHandle& FrameHandle::operator=(FrameHandle other) noexcept {
+    std::swap(m_pool, other.m_pool);
+    std::swap(m_index, other.m_index);
+    std::swap(m_slot, other.m_slot);
+    return *this;
+}
+
+FrameHandle::~FrameHandle() {
+    reset();
+}
+
+void FrameHandle::reset() {
+    if (m_pool) m_pool->release(m_index);
+    m_pool = nullptr;
+    m_index = -1;
+    m_slot = nullptr;
+}
+
+FramePool::FramePool(int size, Factory factory) {
+    size = std::max(1, size);
+    for (int i = 0; i < size; i++) {
+        auto entry = std::make_unique<Entry>();
+        entry->slot = factory ? factory() : std::make_unique<FrameSlot>();
+        entry->next.store(i + 1 < size ? i + 1 : -1, std::memory_order_relaxed);
+        m_slots.push_back(std::move(entry));
+    }
+    m_free.store(0, std::memory_order_release);
+}
+
+FrameHandle FramePool::acquire() {
+    int head = m_free.load(std::memory_order_acquire);
+    while (head >= 0) {
+        int next = m_slots[head]->next.load(std::memory_order_relaxed);
+        if (m_free.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            Entry& entry = *m_slots[head];
+            entry.refs.store(1, std::memory_order_relaxed);
+            s_inFlight.set(m_inFlight.fetch_add(1, std::memory_order_acq_rel) + 1);
+            return FrameHandle(this, head, entry.slot.get());
+        }
+    }
+    return FrameHandle();
+}
+
+void FramePool::retain(int index) {
+    m_slots[index]->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FramePool::release(int index) {
+    Entry& entry = *m_slots[index];
+    if (entry.refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    
+    // Last reference: push back onto the free stack
+    int head = m_free.load(std::memory_order_relaxed);
+    do {
+        entry.next.store(head, std::memory_order_relaxed);
+    } while (!m_free.compare_exchange_weak(head, index, std::memory_order_release, std::memory_order_relaxed));
+    s_inFlight.set(m_inFlight.fetch_sub(1, std::memory_order_acq_rel) - 1);
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(int workers, const std::string& role) {
+    stop();
+    m_stopping = false;
+    for (int i = 0; i < std::max(1, workers); i++) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 0; i < static_cast<int>(m_workers.size()); i++) {
+        m_workers[i]->thread = std::thread(&WorkerPool::workerThread, this, i, role);
+    }
+}
+
+void WorkerPool::stop() {
+    if (m_workers.empty()) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker->thread.join();
+    }
+    m_workers.clear();
+    m_pending = 0;
+}
+
+void WorkerPool::submit(TaskFn fn, void* arg) {
+    int index = (t_pool == this) ? t_worker
+                                 : static_cast<int>(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+    {
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back({fn, arg});
+    }
+    m_pending.fetch_add(1, std::memory_order_release);
+    
+    // Lock so a worker between its pending check and its wait cannot miss this
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+}
+
+bool WorkerPool::take(int index, Task& task) {
+    // Own deque newest-first (its data is still warm in cache)...
+    {
+        Worker& own = *m_workers[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    
+    // ...then steal the oldest from the others
+    const int count = static_cast<int>(m_workers.size());
+    for (int i = 1; i < count; i++) {
+        Worker& victim = *m_workers[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::workerThread(int index, std::string role) {
+    applyThreadTopology(role);
+    t_pool = this;
+    t_worker = index;
+    
+    while (true) {
+        Task task;
+        if (m_pending.load(std::memory_order_acquire) > 0 && take(index, task)) {
+            m_pending.fetch_sub(1, std::memory_order_acq_rel);
+            task.fn(task.arg);
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        if (m_stopping) break;
+        m_wake.wait(lock, [this] { return m_stopping || m_pending.load(std::memory_order_acquire) > 0; });
+        if (m_stopping) break;
+    }
+    
+    t_pool = nullptr;
+    t_worker = -1;
+}
+
+FrameGraph::~FrameGraph() {
+    stop();
+}
+
+int FrameGraph::addNode(const std::string& name, NodeFn fn, Histogram* timing, bool mainThread) {
+    auto node = std::make_unique<Node>();
+    node->name = name;
+    node->fn = std::move(fn);
+    node->timing = timing;
+    node->mainThread = mainThread;
+    node->graph = this;
+    m_nodes.push_back(std::move(node));
+    return static_cast<int>(m_nodes.size()) - 1;
+}
+
+void FrameGraph::connect(int from, int to) {
+    // Queues are single-producer: a node may feed many, but be fed by one
+    for (const auto& node : m_nodes) {
+        if (std::find(node->next.begin(), node->next.end(), to) != node->next.end()) {
+            std::cerr << "Frame graph: '" << m_nodes[to]->name << "' already has an input, '"
+                      << m_nodes[from]->name << "' not connected" << std::endl;
+            return;
+        }
+    }
+    m_nodes[from]->next.push_back(to);
+}
+
+int FrameGraph::workerStages() const {
+    return static_cast<int>(std::count_if(m_nodes.begin(), m_nodes.end(),
+                                          [](const auto& node) { return !node->mainThread; }));
+}
+
+void FrameGraph::start(int workers, int depth) {
+    stop();
+    for (auto& node : m_nodes) {
+        node->queue = std::make_unique<SpscQueue<FrameHandle>>(static_cast<size_t>(std::max(1, depth)));
+        node->scheduled = false;
+    }
+    m_pool.start(workers, "pipeline");
+    m_running = true;
+    
+    std::cout << "Frame graph: " << m_nodes.size() << " stages, " << std::max(1, workers) << " workers, "
+              << std::max(1, depth) << " frames in flight" << std::endl;
+}
+
+void FrameGraph::stop() {
+    if (!m_running) return;
+    m_pool.stop();
+    m_running = false;
+    
+    // Drop whatever was still queued so the slots return to their pool
+    FrameHandle frame;
+    for (auto& node : m_nodes) {
+        while (node->queue->pop(frame)) frame.reset();
+    }
+}
+
+void FrameGraph::submit(int node, const FrameHandle& frame) {
+    deliver(*m_nodes[node], frame);
+}
+
+void FrameGraph::deliver(Node& node, const FrameHandle& frame) {
+    // Sized for the in-flight depth, so this only spins if a pool outgrows its graph
+    while (!node.queue->push(frame)) {
+        std::this_thread::yield();
+    }
+    if (!node.mainThread && !node.scheduled.exchange(true, std::memory_order_acq_rel)) {
+        m_pool.submit(&FrameGraph::runTask, &node);
+    }
+}
+
+void FrameGraph::runTask(void* arg) {
+    Node& node = *static_cast<Node*>(arg);
+    while (true) {
+        node.graph->drain(node);
+        node.scheduled.store(false, std::memory_order_release);
+        
+        // A frame pushed after the last pop but before the flag cleared found the
+        // node still scheduled; pick it up rather than strand it
+        if (node.queue->empty() || node.scheduled.exchange(true, std::memory_order_acq_rel)) break;
+    }
+}
+
+void FrameGraph::drain(Node& node) {
+    FrameHandle frame;
+    while (node.queue->pop(frame)) {
+        {
+            SAR_TRACE_SCOPE(node.name.c_str());
+            if (node.timing) {
+                ScopedTimer timer(*node.timing);
+                node.fn(frame);
+            } else {
+                node.fn(frame);
+            }
+        }
+        for (int next : node.next) {
+            deliver(*m_nodes[next], frame);
+        }
+        frame.reset();
+    }
+}
+
+void FrameGraph::runMainThread() {
+    for (auto& node : m_nodes) {
+        if (node->mainThread) drain(*node);
+    }
+}
+
+} // namespace sar
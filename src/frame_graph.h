@@ -0,0 +1,221 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+
+namespace sar {
+
+// Bounded single-producer/single-consumer ring. Capacity is rounded up to a
+// power of two; push fails rather than blocks when full.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        m_items.resize(size);
+        m_mask = size - 1;
+    }
+    
+    bool push(T item) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) > m_mask) return false;
+        m_items[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        item = std::move(m_items[head & m_mask]);
+        m_items[head & m_mask] = T();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+    
+private:
+    std::vector<T> m_items;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+// One frame travelling through the graph. Applications derive from it to carry
+// whatever per-frame state their stages need (a snapshot of the controls, results).
+struct FrameSlot {
+    virtual ~FrameSlot() = default;
+    
+    cv::Mat image;                  // Source frame, after any in-place stages
+    cv::Mat display;                // Composited output
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point captured;
+};
+
+class FramePool;
+
+// Reference-counted handle to a pooled slot; the slot goes back to its pool when
+// the last handle is dropped, on whichever thread that happens
+class FrameHandle {
+public:
+    FrameHandle() = default;
+    FrameHandle(const FrameHandle& other);
+    FrameHandle(FrameHandle&& other) noexcept;
+    FrameHandle& operator=(FrameHandle other) noexcept;
+    ~FrameHandle();
+    
+    FrameSlot* operator->() const { return m_slot; }
+    FrameSlot& operator*() const { return *m_slot; }
+    explicit operator bool() const { return m_slot != nullptr; }
+    
+    template <typename T>
+    T& as() const { return static_cast<T&>(*m_slot); }
+    
+    void reset();
+    
+private:
+    friend class FramePool;
+    FrameHandle(FramePool* pool, int index, FrameSlot* slot);
+    
+    FramePool* m_pool = nullptr;
+    int m_index = -1;
+    FrameSlot* m_slot = nullptr;
+};
+
+// Fixed set of slots whose buffers are reused frame after frame. The pool size is
+// the pipeline's in-flight depth: when every slot is out, acquire() returns an
+// empty handle and the source simply waits for the next tick.
+class FramePool {
+public:
+    using Factory = std::function<std::unique_ptr<FrameSlot>()>;
+    
+    FramePool(int size, Factory factory = nullptr);
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+    
+    // Single consumer: call from one thread only (the source)
+    FrameHandle acquire();
+    
+    int size() const { return static_cast<int>(m_slots.size()); }
+    int inFlight() const { return m_inFlight.load(std::memory_order_acquire); }
+    
+private:
+    friend class FrameHandle;
+    void retain(int index);
+    void release(int index);
+    
+    struct Entry {
+        std::unique_ptr<FrameSlot> slot;
+        std::atomic<int> refs{0};
+        std::atomic<int> next{-1};  // Free-list link
+    };
+    
+    std::vector<std::unique_ptr<Entry>> m_slots;
+    std::atomic<int> m_free{-1};    // Lock-free stack; one popper, so no ABA
+    std::atomic<int> m_inFlight{0};
+};
+
+// Work-stealing thread pool: every worker owns a deque, runs its newest task
+// first and steals the oldest from the others when it runs dry
+class WorkerPool {
+public:
+    using TaskFn = void (*)(void*);
+    
+    WorkerPool() = default;
+    ~WorkerPool();
+    
+    void start(int workers, const std::string& role);
+    void stop();
+    
+    // Any thread; from a worker the task goes to that worker's own deque
+    void submit(TaskFn fn, void* arg);
+    
+private:
+    struct Task {
+        TaskFn fn;
+        void* arg;
+    };
+    
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+    
+    void workerThread(int index, std::string role);
+    bool take(int index, Task& task);
+    
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_pending{0};
+    std::atomic<unsigned> m_nextWorker{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
+
+// Pipelined frame-graph executor. Stages are nodes joined by bounded SPSC queues;
+// each node processes one frame at a time, in order, on whichever pool worker picks
+// it up, so different frames occupy different stages concurrently and throughput
+// approaches the cost of the slowest stage. Nodes flagged mainThread (display, or
+// anything touching state the main loop owns) are run by runMainThread() instead.
+class FrameGraph {
+public:
+    using NodeFn = std::function<void(FrameHandle&)>;
+    
+    FrameGraph() = default;
+    ~FrameGraph();
+    
+    // Build before start(); timing, when given, observes each run of the node
+    int addNode(const std::string& name, NodeFn fn, Histogram* timing = nullptr, bool mainThread = false);
+    void connect(int from, int to);
+    
+    // Nodes the worker pool runs (all but the mainThread ones)
+    int workerStages() const;
+    
+    // depth bounds the frames in flight, so every queue is sized to never fill
+    void start(int workers, int depth);
+    void stop();
+    
+    // Source thread: hands a frame to a root node
+    void submit(int node, const FrameHandle& frame);
+    
+    // Main thread: runs the main-thread nodes on whatever has reached them
+    void runMainThread();
+    
+private:
+    struct Node {
+        std::string name;
+        NodeFn fn;
+        Histogram* timing = nullptr;
+        bool mainThread = false;
+        std::vector<int> next;
+        std::unique_ptr<SpscQueue<FrameHandle>> queue;
+        std::atomic<bool> scheduled{false};
+        FrameGraph* graph = nullptr;
+    };
+    
+    static void runTask(void* arg);
+    void deliver(Node& node, const FrameHandle& frame);
+    void drain(Node& node);
+    
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    WorkerPool m_pool;
+    bool m_running = false;
+};
+
+} // namespace sar
@@ -0,0 +1,94 @@
+#include "geo.h"
+#include <cmath>
+
+namespace sar {
+
+static constexpr double kEarthRadius = 6371008.8;   // Mean radius (m)
+static constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+
+// Rays shallower than this (down component of the unit vector) never reach the ground
+static constexpr double kMinDescent = 1e-3;
+
+GroundPoint computeGroundPoint(const PlatformTelemetry& platform, float gimbalPan, float gimbalTilt,
+                               float hfovDeg) {
+    GroundPoint point;
+    if (!platform.hasPosition || platform.altitudeAgl <= 0.0f) return point;
+    
+    // Boresight in the body frame (x forward, y right, z down)
+    const double pan = gimbalPan * kDegToRad;
+    const double tilt = gimbalTilt * kDegToRad;
+    const double bx = std::cos(tilt) * std::cos(pan);
+    const double by = std::cos(tilt) * std::sin(pan);
+    const double bz = -std::sin(tilt);
+    
+    // Body to north-east-down: yaw, then pitch, then roll
+    const double yaw = platform.heading * kDegToRad;
+    const double pitch = platform.hasAttitude ? platform.pitch * kDegToRad : 0.0;
+    const double roll = platform.hasAttitude ? platform.roll * kDegToRad : 0.0;
+    const double cy = std::cos(yaw), sy = std::sin(yaw);
+    const double cp = std::cos(pitch), sp = std::sin(pitch);
+    const double cr = std::cos(roll), sr = std::sin(roll);
+    
+    const double n = cy * cp * bx + (cy * sp * sr - sy * cr) * by + (cy * sp * cr + sy * sr) * bz;
+    const double e = sy * cp * bx + (sy * sp * sr + cy * cr) * by + (sy * sp * cr - cy * sr) * bz;
+    const double d = -sp * bx + cp * sr * by + cp * cr * bz;
+    
+    if (d < kMinDescent) return point;
+    
+    const double range = platform.altitudeAgl / d;
+    const double north = range * n;
+    const double east = range * e;
+    
+    // Local flat-earth offset; accurate to well under a metre at sensor ranges
+    const double lat = platform.latitude * kDegToRad;
+    point.latitude = platform.latitude + north / kEarthRadius / kDegToRad;
+    point.longitude = platform.longitude + east / (kEarthRadius * std::cos(lat)) / kDegToRad;
+    point.slantRange = range;
+    point.groundRange = std::hypot(north, east);
+    point.footprintWidth = 2.0 * range * std::tan(hfovDeg * 0.5 * kDegToRad);
+    point.valid = true;
+    return point;
+}
+
+ImagePoint projectGroundPoint(const PlatformTelemetry& platform, float gimbalPan, float gimbalTilt,
+                              float hfovDeg, double aspect, double latitude, double longitude) {
+    ImagePoint point;
+    if (!platform.hasPosition || platform.altitudeAgl <= 0.0f) return point;
+    
+    // Line of sight in north-east-down, same flat-earth offset as above
+    const double lat = platform.latitude * kDegToRad;
+    const double n = (latitude - platform.latitude) * kDegToRad * kEarthRadius;
+    const double e = (longitude - platform.longitude) * kDegToRad * kEarthRadius * std::cos(lat);
+    const double d = platform.altitudeAgl;
+    
+    // North-east-down to body: the transpose of the rotation above
+    const double yaw = platform.heading * kDegToRad;
+    const double pitch = platform.hasAttitude ? platform.pitch * kDegToRad : 0.0;
+    const double roll = platform.hasAttitude ? platform.roll * kDegToRad : 0.0;
+    const double cy = std::cos(yaw), sy = std::sin(yaw);
+    const double cp = std::cos(pitch), sp = std::sin(pitch);
+    const double cr = std::cos(roll), sr = std::sin(roll);
+    
+    const double x = cy * cp * n + sy * cp * e - sp * d;
+    const double y = (cy * sp * sr - sy * cr) * n + (sy * sp * sr + cy * cr) * e + cp * sr * d;
+    const double z = (cy * sp * cr + sy * sr) * n + (sy * sp * cr - cy * sr) * e + cp * cr * d;
+    
+    // Camera axes in the body frame: boresight, image right, image down
+    const double pan = gimbalPan * kDegToRad;
+    const double tilt = gimbalTilt * kDegToRad;
+    const double forward = std::cos(tilt) * std::cos(pan) * x + std::cos(tilt) * std::sin(pan) * y - std::sin(tilt) * z;
+    const double right = -std::sin(pan) * x + std::cos(pan) * y;
+    const double down = std::sin(tilt) * std::cos(pan) * x + std::sin(tilt) * std::sin(pan) * y + std::cos(tilt) * z;
+    
+    if (forward <= 0.0) return point;
+    
+    const double halfWidth = std::tan(hfovDeg * 0.5 * kDegToRad);
+    point.x = 0.5 + 0.5 * right / (forward * halfWidth);
+    point.y = 0.5 + 0.5 * down / (forward * halfWidth * aspect);
+    point.depth = forward;
+    point.slantRange = std::sqrt(x * x + y * y + z * z);
+    point.valid = true;
+    return point;
+}
+
+} // namespace sar
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "telemetry.h"
+
+namespace sar {
+
+struct GroundPoint {
+    bool valid = false;
+    double latitude = 0;
+    double longitude = 0;
+    double slantRange = 0;          // Metres along the line of sight
+    double groundRange = 0;         // Horizontal metres from the platform
+    double footprintWidth = 0;      // Ground metres across the image at the crosshair
+};
+
+// Where the boresight (the crosshair at the image centre) meets the ground,
+// treating the terrain under the platform as flat at its AGL height. Gimbal
+// angles are relative to the airframe; hfov is the current horizontal FOV.
+GroundPoint computeGroundPoint(const PlatformTelemetry& platform, float gimbalPan, float gimbalTilt,
+                               float hfovDeg);
+
+struct ImagePoint {
+    bool valid = false;
+    double x = 0;                   // Fraction of the image width from the left edge
+    double y = 0;                   // Fraction of the image height from the top edge
+    double depth = 0;               // Metres along the boresight
+    double slantRange = 0;          // Metres along the line of sight
+};
+
+// The inverse: where a point on the same flat ground appears in the image. Valid
+// when it is in front of the camera; it may still lie outside [0, 1]. aspect is
+// image height over width.
+ImagePoint projectGroundPoint(const PlatformTelemetry& platform, float gimbalPan, float gimbalTilt,
+                              float hfovDeg, double aspect, double latitude, double longitude);
+
+} // namespace sar
@@ -0,0 +1,56 @@
+#include "gimbal.h"
+#include <algorithm>
+#include <cmath>
+
+namespace sar {
+
+static constexpr float kDegToRad = 3.14159265358979f / 180.0f;
+
+Gimbal::Gimbal() {}
+
+void Gimbal::init(const GimbalConfig& config) {
+    m_config = config;
+    reset();
+}
+
+void Gimbal::update(float panRate, float tiltRate, float zoomAxis, double dt) {
+    panRate = std::clamp(panRate, -1.0f, 1.0f);
+    tiltRate = std::clamp(tiltRate, -1.0f, 1.0f);
+    
+    m_state.panRate = panRate;
+    m_state.tiltRate = tiltRate;
+    
+    // Joystick tilt is positive when pushed forward/down, which points the payload down
+    m_state.pan += panRate * m_config.max_pan_rate * static_cast<float>(dt);
+    m_state.tilt -= tiltRate * m_config.max_tilt_rate * static_cast<float>(dt);
+    
+    // Wrap pan to -180..180
+    m_state.pan = std::remainder(m_state.pan, 360.0f);
+    m_state.tilt = std::clamp(m_state.tilt, m_config.min_tilt, m_config.max_tilt);
+    
+    float lever = (std::clamp(zoomAxis, -1.0f, 1.0f) + 1.0f) * 0.5f;
+    m_state.zoom = m_config.min_zoom + lever * (m_config.max_zoom - m_config.min_zoom);
+    
+    if (m_fovModel) {
+        m_state.hfov = m_fovModel(m_state.zoom);
+        return;
+    }
+    
+    // Narrow the FOV with zoom: tan(hfov/2) scales with 1/zoom
+    float wideHalf = m_config.hfov_wide * 0.5f * kDegToRad;
+    float zoomRatio = m_state.zoom / std::max(m_config.min_zoom, 0.01f);
+    m_state.hfov = 2.0f * std::atan(std::tan(wideHalf) / zoomRatio) / kDegToRad;
+}
+
+void Gimbal::reset() {
+    m_state = GimbalState();
+    m_state.zoom = m_config.min_zoom;
+    m_state.hfov = m_fovModel ? m_fovModel(m_state.zoom) : m_config.hfov_wide;
+}
+
+void Gimbal::setFovModel(std::function<float(float zoom)> model) {
+    m_fovModel = std::move(model);
+    m_state.hfov = m_fovModel ? m_fovModel(m_state.zoom) : m_config.hfov_wide;
+}
+
+} // namespace sar
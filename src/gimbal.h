@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include "config.h"
+
+namespace sar {
+
+struct GimbalState {
+    float pan = 0.0f;     // Degrees, positive right
+    float tilt = 0.0f;    // Degrees, positive up
+    float zoom = 1.0f;    // Optical zoom factor
+    float hfov = 60.0f;   // Horizontal field of view at current zoom (degrees)
+    
+    // Commanded rates (-1.0 to 1.0) that produced this state
+    float panRate = 0.0f;
+    float tiltRate = 0.0f;
+};
+
+// Simulated pan/tilt/zoom payload driven by joystick (or tracker) rate commands
+class Gimbal {
+public:
+    Gimbal();
+    
+    void init(const GimbalConfig& config);
+    
+    // panRate/tiltRate are -1.0..1.0 rate commands; zoomAxis is an absolute -1.0..1.0 lever
+    void update(float panRate, float tiltRate, float zoomAxis, double dt);
+    void reset();
+    
+    // Calibrated lens: HFOV as a function of zoom replaces the nominal tan/zoom curve
+    void setFovModel(std::function<float(float zoom)> model);
+    
+    const GimbalState& getState() const { return m_state; }
+    
+private:
+    GimbalConfig m_config;
+    GimbalState m_state;
+    std::function<float(float)> m_fovModel;
+};
+
+} // namespace sar
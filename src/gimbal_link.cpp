@@ -0,0 +1,207 @@
+#include "gimbal_link.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+
+namespace sar {
+
+static Counter& s_packets = Metrics::instance().counter(
+    "sar_gimbal_link_packets_total", "Gimbal command datagrams sent");
+static Counter& s_errors = Metrics::instance().counter(
+    "sar_gimbal_link_send_errors_total", "Gimbal command datagrams the socket refused");
+static Histogram& s_jitter = Metrics::instance().histogram(
+    "sar_gimbal_link_jitter_seconds", "Gimbal command send time minus its schedule", "",
+    {0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.002, 0.005, 0.01});
+
+static void putU16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static void putU64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+static void putF32(uint8_t* p, float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    putU32(p, bits);
+}
+
+GimbalLink::GimbalLink() {}
+
+GimbalLink::~GimbalLink() {
+    shutdown();
+}
+
+bool GimbalLink::init(const GimbalLinkConfig& config, const GimbalConfig& gimbal) {
+    m_config = config;
+    m_gimbal = gimbal;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    if (m_config.rate_hz <= 0.0 || m_config.rate_hz > 1000.0) m_config.rate_hz = 50.0;
+    m_angleMode = (m_config.mode == "angle");
+    
+    if (!netInit() || !makeAddress(m_config.host, m_config.port, m_address)) {
+        std::cerr << "Gimbal link: invalid address " << m_config.host << ":" << m_config.port << std::endl;
+        return false;
+    }
+    
+    m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_socket == kInvalidSocket) {
+        std::cerr << "Gimbal link: failed to create socket" << std::endl;
+        return false;
+    }
+    
+    m_running = true;
+    m_thread = std::thread(&GimbalLink::senderThread, this);
+    
+    std::cout << "Gimbal link: " << (m_angleMode ? "angle" : "rate") << " commands to "
+              << m_config.host << ":" << m_config.port << " at " << m_config.rate_hz << " Hz" << std::endl;
+    return true;
+}
+
+void GimbalLink::shutdown() {
+    if (!m_running) return;
+    
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    closeSocket(m_socket);
+    m_socket = kInvalidSocket;
+    
+    GimbalLinkStats stats = getStats();
+    std::cout << "Gimbal link stopped: " << stats.sent << " commands sent, "
+              << stats.errors << " errors" << std::endl;
+}
+
+void GimbalLink::update(const GimbalState& state, bool joystickConnected, bool tracking) {
+    if (!m_running) return;
+    
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    m_state = state;
+    m_flags = static_cast<uint16_t>((joystickConnected ? 1 : 0) | (tracking ? 2 : 0));
+}
+
+GimbalLinkStats GimbalLink::getStats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void encodeGimbalCommand(uint8_t* packet, const GimbalState& state, const GimbalConfig& gimbal,
+                         bool angleMode, uint16_t flags, uint32_t sequence) {
+    // Gimbal::update moves tilt by -tiltRate, so the rate on the wire is negated to
+    // stay "positive up" like the angle
+    float pan = angleMode ? state.pan : state.panRate * gimbal.max_pan_rate;
+    float tilt = angleMode ? state.tilt : -state.tiltRate * gimbal.max_tilt_rate;
+    
+    auto wallNow = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(wallNow).count();
+    
+    std::memcpy(packet, "SARG", 4);
+    packet[4] = kGimbalPacketVersion;
+    packet[5] = angleMode ? 1 : 0;
+    putU16(packet + 6, flags);
+    putU32(packet + 8, sequence);
+    putU64(packet + 12, timestampUs);
+    putF32(packet + 20, pan);
+    putF32(packet + 24, tilt);
+    putF32(packet + 28, state.zoom);
+}
+
+void GimbalLink::encode(uint32_t sequence) {
+    GimbalState state;
+    uint16_t flags;
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        state = m_state;
+        flags = m_flags;
+    }
+    encodeGimbalCommand(m_packet, state, m_gimbal, m_angleMode, flags, sequence);
+}
+
+void GimbalLink::senderThread() {
+    applyThreadTopology("gimbal_link");
+    
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / m_config.rate_hz));
+    
+    uint32_t sequence = 0;
+    auto next = Clock::now() + period;
+    auto windowStart = Clock::now();
+    uint64_t windowSent = 0;
+    double jitterSum = 0;
+    double jitterMax = 0;
+    
+    while (m_running) {
+        std::this_thread::sleep_until(next);
+        auto now = Clock::now();
+        double jitterUs = std::chrono::duration<double, std::micro>(now - next).count();
+        
+        bool sent;
+        {
+            SAR_TRACE_SCOPE("gimbal_link.send");
+            encode(sequence++);
+            sent = sendto(m_socket, reinterpret_cast<const char*>(m_packet), kGimbalPacketSize, 0,
+                          reinterpret_cast<const sockaddr*>(&m_address), sizeof(m_address)) ==
+                   static_cast<int>(kGimbalPacketSize);
+        }
+        
+        s_jitter.observe(jitterUs / 1e6);
+        jitterSum += jitterUs;
+        if (jitterUs > jitterMax) jitterMax = jitterUs;
+        windowSent++;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            if (sent) {
+                m_stats.sent++;
+                s_packets.inc();
+            } else {
+                m_stats.errors++;
+                s_errors.inc();
+            }
+        }
+        
+        // Keep the schedule anchored to the period; after a stall, resync instead of bursting
+        next += period;
+        if (now - next > period) {
+            next = now + period;
+        }
+        
+        double elapsed = std::chrono::duration<double>(now - windowStart).count();
+        if (elapsed >= 10.0) {
+            GimbalLinkStats stats;
+            {
+                std::lock_guard<std::mutex> lock(m_statsMutex);
+                m_stats.rateHz = windowSent / elapsed;
+                m_stats.jitterMeanUs = jitterSum / windowSent;
+                m_stats.jitterMaxUs = jitterMax;
+                stats = m_stats;
+            }
+            std::cout << "Gimbal link: " << static_cast<int>(stats.rateHz + 0.5) << " Hz, jitter mean "
+                      << static_cast<int>(stats.jitterMeanUs) << " us, max "
+                      << static_cast<int>(stats.jitterMaxUs) << " us" << std::endl;
+            
+            windowStart = now;
+            windowSent = 0;
+            jitterSum = 0;
+            jitterMax = 0;
+        }
+    }
+}
+
+} // namespace sar
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "config.h"
+#include "gimbal.h"
+#include "net.h"
+
+namespace sar {
+
+// Wire format of one command datagram (little-endian, 32 bytes):
+//
+//   offset  type  field
+//    0      u8[4] magic "SARG"
+//    4      u8    version (1)
+//    5      u8    mode: 0 = rate (deg/s), 1 = angle (deg)
+//    6      u16   flags: bit 0 joystick connected, bit 1 tracker steering
+//    8      u32   sequence, +1 per datagram
+//   12      u64   timestamp, microseconds since the Unix epoch at send time
+//   20      f32   pan  (positive right)
+//   24      f32   tilt (positive up)
+//   28      f32   zoom factor
+//
+// Both modes use the payload's sign convention, not the stick's: a joystick pushed
+// forward (positive tiltRate) tilts the simulated gimbal down, so it is sent as a
+// negative tilt rate.
+static constexpr size_t kGimbalPacketSize = 32;
+static constexpr uint8_t kGimbalPacketVersion = 1;
+
+// Fills one datagram from the simulated gimbal's state; timestamped now
+void encodeGimbalCommand(uint8_t* packet, const GimbalState& state, const GimbalConfig& gimbal,
+                         bool angleMode, uint16_t flags, uint32_t sequence);
+
+struct GimbalLinkStats {
+    uint64_t sent = 0;
+    uint64_t errors = 0;
+    double rateHz = 0;              // Measured send rate
+    double jitterMeanUs = 0;        // Send time minus schedule, since the last report
+    double jitterMaxUs = 0;
+};
+
+// Sends the latest gimbal command at a fixed rate on its own thread, independent
+// of the render loop's frame rate
+class GimbalLink {
+public:
+    GimbalLink();
+    ~GimbalLink();
+    
+    bool init(const GimbalLinkConfig& config, const GimbalConfig& gimbal);
+    void shutdown();
+    
+    // Called from the display loop with the state the simulated gimbal just reached
+    void update(const GimbalState& state, bool joystickConnected, bool tracking);
+    
+    GimbalLinkStats getStats() const;
+    bool isRunning() const { return m_running.load(); }
+    
+private:
+    void senderThread();
+    void encode(uint32_t sequence);
+    
+    GimbalLinkConfig m_config;
+    GimbalConfig m_gimbal;
+    bool m_angleMode = false;
+    
+    SocketHandle m_socket = kInvalidSocket;
+    sockaddr_in m_address{};
+    uint8_t m_packet[kGimbalPacketSize] = {};
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    std::mutex m_commandMutex;
+    GimbalState m_state;
+    uint16_t m_flags = 0;
+    
+    mutable std::mutex m_statsMutex;
+    GimbalLinkStats m_stats;
+};
+
+} // namespace sar
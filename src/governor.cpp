@@ -0,0 +1,175 @@
+#include "governor.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+
+namespace sar {
+
+static Gauge& s_level = Metrics::instance().gauge(
+    "sar_governor_level", "Optional-work steps currently shed by the frame-time governor");
+static Gauge& s_load = Metrics::instance().gauge(
+    "sar_governor_load", "Smoothed render frame cost as a fraction of the frame budget");
+static Counter& s_changes = Metrics::instance().counter(
+    "sar_governor_changes_total", "Governor level changes");
+static Gauge* const s_stageLoad[] = {
+    &Metrics::instance().gauge("sar_governor_stage_load", "Smoothed stage cost as a fraction of its budget",
+                               "step=\"hud_rate\""),
+    &Metrics::instance().gauge("sar_governor_stage_load", "Smoothed stage cost as a fraction of its budget",
+                               "step=\"detector\""),
+    &Metrics::instance().gauge("sar_governor_stage_load", "Smoothed stage cost as a fraction of its budget",
+                               "step=\"effects\""),
+    &Metrics::instance().gauge("sar_governor_stage_load", "Smoothed stage cost as a fraction of its budget",
+                               "step=\"resolution\""),
+};
+
+static const std::pair<const char*, GovernorStep> kStepNames[] = {
+    {"hud_rate", GovernorStep::HudRate}, {"detector", GovernorStep::Detector},
+    {"effects", GovernorStep::Effects}, {"resolution", GovernorStep::Resolution}
+};
+
+// Weight of the newest frame in the smoothed load
+static constexpr double kLoadSmoothing = 0.1;
+
+// Longest gap between updates that still counts towards a hold time (e.g. a stall in the source)
+static constexpr double kMaxUpdateGap = 0.25;
+
+bool Governor::init(const GovernorConfig& config, double sourceFps) {
+    m_config = config;
+    m_state = GovernorState();
+    if (!config.enabled) return false;
+    
+    m_order.clear();
+    for (const auto& name : config.shed_order) {
+        auto it = std::find_if(std::begin(kStepNames), std::end(kStepNames),
+                               [&](const auto& entry) { return name == entry.first; });
+        if (it == std::end(kStepNames)) {
+            std::cerr << "Governor: unknown step '" << name << "', skipped" << std::endl;
+        } else if (std::find(m_order.begin(), m_order.end(), it->second) == m_order.end()) {
+            m_order.push_back(it->second);
+        }
+    }
+    if (m_order.empty()) {
+        std::cerr << "Governor: nothing to shed, disabled" << std::endl;
+        return false;
+    }
+    
+    double fps = config.target_fps > 0 ? config.target_fps : sourceFps;
+    if (fps <= 0) fps = 30.0;
+    m_budgetMs = 1000.0 / fps;
+    
+    // Each step's stage gets a share of the frame; a step without one is only shed in order
+    for (const auto& [name, step] : kStepNames) {
+        auto it = config.stage_budgets.find(name);
+        double share = it != config.stage_budgets.end() ? it->second : 0.0;
+        m_stageBudgetMs[static_cast<int>(step)] = share > 0 ? share * m_budgetMs : 0.0;
+        m_stageLoad[static_cast<int>(step)] = 0;
+    }
+    m_config.hud_interval = std::max(1, config.hud_interval);
+    m_config.detector_throttle = std::max(1, config.detector_throttle);
+    m_config.render_scale = std::clamp(config.render_scale, 0.1, 1.0);
+    m_config.restore_load = std::min(config.restore_load, config.degrade_load);
+    
+    m_shed.clear();
+    m_load = 0;
+    m_overSeconds = 0;
+    m_underSeconds = 0;
+    m_lastUpdate = std::chrono::steady_clock::now();
+    m_enabled = true;
+    s_level.set(0);
+    
+    std::cout << "Frame-time governor: " << m_budgetMs << " ms budget, " << m_order.size() << " steps" << std::endl;
+    return true;
+}
+
+void Governor::update(double frameMs, const GovernorCosts& costs) {
+    if (!m_enabled) return;
+    
+    auto now = std::chrono::steady_clock::now();
+    double dt = std::min(std::chrono::duration<double>(now - m_lastUpdate).count(), kMaxUpdateGap);
+    m_lastUpdate = now;
+    
+    m_load += (frameMs / m_budgetMs - m_load) * kLoadSmoothing;
+    s_load.set(m_load);
+    for (int i = 0; i < static_cast<int>(GovernorStep::Count); i++) {
+        if (m_stageBudgetMs[i] <= 0) continue;
+        m_stageLoad[i] += (costs.ms[i] / m_stageBudgetMs[i] - m_stageLoad[i]) * kLoadSmoothing;
+        s_stageLoad[i]->set(m_stageLoad[i]);
+    }
+    
+    // Each direction needs the load held past its threshold; crossing back resets it
+    m_overSeconds = m_load > m_config.degrade_load ? m_overSeconds + dt : 0;
+    m_underSeconds = m_load < m_config.restore_load ? m_underSeconds + dt : 0;
+    
+    const bool over = m_load > m_config.degrade_load && m_overSeconds >= m_config.degrade_seconds;
+    const bool under = m_load < m_config.restore_load && m_underSeconds >= m_config.restore_seconds;
+    if (over && m_shed.size() < m_order.size()) {
+        shed();
+    } else if (under && !m_shed.empty()) {
+        restore();
+    }
+}
+
+void Governor::shed() {
+    auto active = [&](GovernorStep step) { return std::find(m_shed.begin(), m_shed.end(), step) == m_shed.end(); };
+    
+    // The stage over its own budget goes first; otherwise the next in shed_order
+    GovernorStep choice = GovernorStep::Count;
+    for (GovernorStep step : m_order) {
+        int i = static_cast<int>(step);
+        if (active(step) && m_stageBudgetMs[i] > 0 && m_stageLoad[i] > 1.0) {
+            choice = step;
+            break;
+        }
+    }
+    const bool overOwn = choice != GovernorStep::Count;
+    if (!overOwn) {
+        choice = *std::find_if(m_order.begin(), m_order.end(), active);
+    }
+    m_shed.push_back(choice);
+    applyShed();
+    
+    int i = static_cast<int>(choice);
+    std::cout << "Governor: shed " << kStepNames[i].first << " (level " << m_state.level << ", load "
+              << static_cast<int>(m_load * 100) << "% of " << m_budgetMs << " ms";
+    if (overOwn) {
+        std::cout << ", stage " << static_cast<int>(m_stageLoad[i] * 100) << "% of its "
+                  << m_stageBudgetMs[i] << " ms";
+    }
+    std::cout << ")" << std::endl;
+}
+
+void Governor::restore() {
+    GovernorStep step = m_shed.back();
+    m_shed.pop_back();
+    applyShed();
+    
+    std::cout << "Governor: restored " << kStepNames[static_cast<int>(step)].first << " (level "
+              << m_state.level << ", load " << static_cast<int>(m_load * 100) << "% of " << m_budgetMs
+              << " ms)" << std::endl;
+}
+
+void Governor::applyShed() {
+    Trace::instant("governor.level");
+    
+    GovernorState state;
+    state.level = static_cast<int>(m_shed.size());
+    for (GovernorStep step : m_shed) {
+        switch (step) {
+            case GovernorStep::HudRate: state.hudInterval = m_config.hud_interval; break;
+            case GovernorStep::Detector: state.detectorThrottle = m_config.detector_throttle; break;
+            case GovernorStep::Effects: state.reducedEffects = true; break;
+            case GovernorStep::Resolution: state.renderScale = m_config.render_scale; break;
+            case GovernorStep::Count: break;
+        }
+    }
+    m_state = state;
+    
+    // Start both hold times over so the new level is judged on its own cost
+    m_overSeconds = 0;
+    m_underSeconds = 0;
+    s_level.set(m_state.level);
+    s_changes.inc();
+}
+
+} // namespace sar
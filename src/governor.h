@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+// Optional work the governor can shed, in the names used by shed_order
+enum class GovernorStep : uint8_t { HudRate, Detector, Effects, Resolution, Count };
+
+// What the render loop should do at the current level; all steps off at level 0
+struct GovernorState {
+    int level = 0;
+    int hudInterval = 1;            // Refresh HUD values every N frames
+    int detectorThrottle = 1;       // Multiplies the detector's frame interval
+    bool reducedEffects = false;    // Effects drop their per-pixel passes
+    double renderScale = 1.0;       // Display/HUD resolution relative to the source
+};
+
+// Render-thread cost this frame of the stage each step sheds (ms)
+struct GovernorCosts {
+    double ms[static_cast<int>(GovernorStep::Count)] = {};
+    double& operator[](GovernorStep step) { return ms[static_cast<int>(step)]; }
+};
+
+// Adds the lifetime of the scope to one step's cost
+class GovernorTimer {
+public:
+    GovernorTimer(GovernorCosts& costs, GovernorStep step)
+        : m_cost(costs[step]), m_start(std::chrono::steady_clock::now()) {}
+    ~GovernorTimer() {
+        m_cost += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+    
+private:
+    double& m_cost;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Frame-time governor. The render loop reports what each frame cost, in total and
+// per sheddable stage. While the smoothed total stays over the frame budget, one
+// step is shed at a time: the first in the configured order whose stage is over
+// its own share of the budget, or simply the next in order when none is (the time
+// is going somewhere that can't be shed). Steps are restored last-shed first once
+// the total has stayed well under. The gap between the two thresholds and the
+// hold times keep it from oscillating at the edge.
+class Governor {
+public:
+    bool init(const GovernorConfig& config, double sourceFps);
+    
+    // Render thread, once per rendered frame: everything but the event wait
+    void update(double frameMs, const GovernorCosts& costs);
+    
+    const GovernorState& state() const { return m_state; }
+    double budgetMs() const { return m_budgetMs; }
+    
+private:
+    void shed();
+    void restore();
+    void applyShed();
+    
+    GovernorConfig m_config;
+    bool m_enabled = false;
+    std::vector<GovernorStep> m_order;
+    double m_budgetMs = 0;
+    double m_stageBudgetMs[static_cast<int>(GovernorStep::Count)] = {};
+    
+    GovernorState m_state;
+    std::vector<GovernorStep> m_shed;   // In the order they were shed
+    double m_load = 0;                  // Smoothed frame cost / budget
+    double m_stageLoad[static_cast<int>(GovernorStep::Count)] = {};    // Smoothed stage cost / its budget
+    std::chrono::steady_clock::time_point m_lastUpdate;
+    double m_overSeconds = 0;
+    double m_underSeconds = 0;
+};
+
+} // namespace sar
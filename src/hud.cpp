@@ -1,10 +1,81 @@
 #include "hud.h"
-#include <ctime>
-#include <sstream>
-#include <iomanip>
+#include "trace.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 namespace sar {
 
+// Span names indexed by HudOp
+static const char* const kOpTraceNames[] = {
+    "hud.reticle", "hud.text", "hud.value", "hud.joystick_name", "hud.clock",
+    "hud.gauge", "hud.indicator", "hud.stick", "hud.detections", "hud.track",
+    "hud.map"
+};
+
+static const std::pair<const char*, HudOp> kOpNames[] = {
+    {"reticle", HudOp::Reticle}, {"text", HudOp::Text}, {"value", HudOp::Value},
+    {"joystick_name", HudOp::JoystickName}, {"clock", HudOp::Clock}, {"gauge", HudOp::Gauge},
+    {"indicator", HudOp::Indicator}, {"stick", HudOp::Stick}, {"detections", HudOp::Detections},
+    {"track", HudOp::Track}, {"map", HudOp::Map}
+};
+
+static const std::pair<const char*, HudValue> kValueNames[] = {
+    {"joystick.pan", HudValue::JoystickPan}, {"joystick.tilt", HudValue::JoystickTilt},
+    {"joystick.zoom", HudValue::JoystickZoom}, {"gimbal.pan", HudValue::GimbalPan},
+    {"gimbal.tilt", HudValue::GimbalTilt}, {"gimbal.zoom", HudValue::GimbalZoom},
+    {"gimbal.hfov", HudValue::GimbalHfov}, {"detector.fps", HudValue::DetectorFps},
+    {"detector.latency_ms", HudValue::DetectorLatency}, {"detector.objects", HudValue::DetectorObjects},
+    {"track.psr", HudValue::TrackPsr}, {"track.offset_x", HudValue::TrackOffsetX},
+    {"track.offset_y", HudValue::TrackOffsetY}, {"platform.latitude", HudValue::PlatformLatitude},
+    {"platform.longitude", HudValue::PlatformLongitude}, {"platform.altitude_msl", HudValue::PlatformAltitudeMsl},
+    {"platform.altitude_agl", HudValue::PlatformAltitudeAgl}, {"platform.heading", HudValue::PlatformHeading},
+    {"platform.pitch", HudValue::PlatformPitch}, {"platform.roll", HudValue::PlatformRoll},
+    {"platform.ground_speed", HudValue::PlatformGroundSpeed}, {"platform.gimbal_pan", HudValue::PlatformGimbalPan},
+    {"platform.gimbal_tilt", HudValue::PlatformGimbalTilt}, {"platform.age_ms", HudValue::PlatformAge},
+    {"crosshair.latitude", HudValue::CrosshairLatitude}, {"crosshair.longitude", HudValue::CrosshairLongitude},
+    {"crosshair.range", HudValue::CrosshairRange}, {"crosshair.ground_range", HudValue::CrosshairGroundRange},
+    {"crosshair.footprint", HudValue::CrosshairFootprint}, {"playback.position", HudValue::PlaybackPosition},
+    {"playback.speed", HudValue::PlaybackSpeed}, {"governor.level", HudValue::GovernorLevel}
+};
+
+static const std::pair<const char*, HudCondition> kConditionNames[] = {
+    {"always", HudCondition::Always}, {"joystick.connected", HudCondition::JoystickConnected},
+    {"joystick.disconnected", HudCondition::JoystickDisconnected}, {"recording", HudCondition::Recording},
+    {"gimbal", HudCondition::Gimbal}, {"tracking", HudCondition::Tracking},
+    {"detections", HudCondition::Detections}, {"platform", HudCondition::Platform},
+    {"platform.stale", HudCondition::PlatformStale}, {"crosshair", HudCondition::Crosshair},
+    {"playback", HudCondition::Playback}, {"playback.paused", HudCondition::PlaybackPaused},
+    {"degraded", HudCondition::Degraded}
+};
+
+static const std::pair<const char*, HudAnchor> kAnchorNames[] = {
+    {"top_left", HudAnchor::TopLeft}, {"top_center", HudAnchor::TopCenter},
+    {"top_right", HudAnchor::TopRight}, {"center", HudAnchor::Center},
+    {"bottom_left", HudAnchor::BottomLeft}, {"bottom_center", HudAnchor::BottomCenter},
+    {"bottom_right", HudAnchor::BottomRight}
+};
+
+static const std::pair<const char*, HudAlign> kAlignNames[] = {
+    {"left", HudAlign::Left}, {"center", HudAlign::Center}, {"right", HudAlign::Right}
+};
+
+template <typename T, size_t N>
+static bool lookup(const std::pair<const char*, T> (&table)[N], const std::string& name, T& out) {
+    for (const auto& entry : table) {
+        if (name == entry.first) {
+            out = entry.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static cv::Scalar toBgr(const std::array<int, 3>& rgb) {
+    return cv::Scalar(rgb[2], rgb[1], rgb[0]);
+}
+
 Hud::Hud() {}
 
 void Hud::init(const HudConfig& config) {
@@ -22,117 +93,535 @@ void Hud::init(const HudConfig& config) {
         config.text_color[1],
         config.text_color[0]
     );
+    
+    // Resolve every widget once; render() only walks the flat command list
+    const std::vector<HudWidgetConfig> widgets =
+        config.widgets.empty() ? defaultLayout(config) : config.widgets;
+    
+    m_commands.clear();
+    m_commands.reserve(widgets.size());
+    for (const auto& widget : widgets) {
+        HudCommand cmd;
+        if (compile(widget, cmd)) {
+            m_commands.push_back(std::move(cmd));
+        }
+    }
+    m_layoutSize = cv::Size();
 }
 
-void Hud::render(cv::Mat& frame, const JoystickState& joystick, bool recording) {
-    if (!m_config.enabled) return;
+std::vector<HudWidgetConfig> Hud::defaultLayout(const HudConfig& config) {
+    std::vector<HudWidgetConfig> widgets;
+    
+    auto add = [&widgets](const std::string& type, const std::string& anchor, int dx, int dy) -> HudWidgetConfig& {
+        HudWidgetConfig w;
+        w.type = type;
+        w.anchor = anchor;
+        w.offset = {dx, dy};
+        widgets.push_back(w);
+        return widgets.back();
+    };
+    
+    if (config.show_crosshair) {
+        HudWidgetConfig& w = add("reticle", "center", 0, 0);
+        w.size = 30;
+        w.gap = 8;
+        w.thickness = 2;
+    }
     
-    if (m_config.show_crosshair) {
-        drawCrosshair(frame);
+    if (config.show_telemetry) {
+        // Telemetry block origin in the chosen corner
+        std::string anchor = config.telemetry_position;
+        int x = 10;
+        int y = 25;
+        if (anchor == "top_right" || anchor == "bottom_right") x = -200;
+        if (anchor == "bottom_left" || anchor == "bottom_right") y = -125;
+        if (anchor != "top_right" && anchor != "bottom_left" && anchor != "bottom_right") anchor = "top_left";
+        const int lineHeight = 22;
+        
+        HudWidgetConfig* w = &add("text", anchor, x, y);
+        w->label = "Joystick: CONNECTED";
+        w->when = "joystick.connected";
+        
+        w = &add("text", anchor, x, y);
+        w->label = "Joystick: DISCONNECTED";
+        w->when = "joystick.disconnected";
+        w->color = {255, 0, 0};
+        
+        w = &add("joystick_name", anchor, x, y + lineHeight);
+        w->when = "joystick.connected";
+        w->scale = 0.8;
+        
+        w = &add("value", anchor, x, y + lineHeight * 2);
+        w->label = "Pan: ";
+        w->bind = "joystick.pan";
+        w->when = "joystick.connected";
+        
+        w = &add("value", anchor, x + 105, y + lineHeight * 2);
+        w->label = "Tilt: ";
+        w->bind = "joystick.tilt";
+        w->when = "joystick.connected";
+        
+        w = &add("value", anchor, x, y + lineHeight * 3);
+        w->label = "Zoom: ";
+        w->bind = "joystick.zoom";
+        w->when = "joystick.connected";
+        
+        w = &add("value", anchor, x, y + lineHeight * 4);
+        w->label = "Az: ";
+        w->bind = "gimbal.pan";
+        w->when = "gimbal";
+        w->precision = 1;
+        
+        w = &add("value", anchor, x + 85, y + lineHeight * 4);
+        w->label = "El: ";
+        w->bind = "gimbal.tilt";
+        w->when = "gimbal";
+        w->precision = 1;
+        
+        w = &add("value", anchor, x + 165, y + lineHeight * 4);
+        w->bind = "gimbal.zoom";
+        w->suffix = "x";
+        w->when = "gimbal";
+        w->precision = 1;
+        
+        w = &add("indicator", anchor, x, y + lineHeight * 5);
+        w->label = "REC";
+        w->when = "recording";
+        w->thickness = 2;
+        
+        // Platform telemetry block (only drawn once packets arrive)
+        struct PlatformField {
+            const char* label;
+            const char* bind;
+            const char* suffix;
+            int precision;
+        };
+        const PlatformField platformFields[] = {
+            {"LAT ", "platform.latitude", "", 6}, {"LON ", "platform.longitude", "", 6},
+            {"ALT ", "platform.altitude_msl", " m", 0}, {"AGL ", "platform.altitude_agl", " m", 0},
+            {"HDG ", "platform.heading", "", 0}, {"GS ", "platform.ground_speed", " m/s", 1}
+        };
+        for (int i = 0; i < 6; i++) {
+            w = &add("value", "top_center", -150 + (i % 2) * 160, 25 + (i / 2) * lineHeight);
+            w->label = platformFields[i].label;
+            w->bind = platformFields[i].bind;
+            w->suffix = platformFields[i].suffix;
+            w->precision = platformFields[i].precision;
+            w->when = "platform";
+        }
+        
+        w = &add("indicator", "top_center", -60, 25);
+        w->label = "TLM STALE";
+        w->when = "platform.stale";
+        
+        // Where the crosshair meets the ground, just below the reticle
+        w = &add("value", "center", 40, 50);
+        w->label = "TGT ";
+        w->bind = "crosshair.latitude";
+        w->precision = 6;
+        w->when = "crosshair";
+        w->scale = 0.8;
+        
+        w = &add("value", "center", 175, 50);
+        w->bind = "crosshair.longitude";
+        w->precision = 6;
+        w->when = "crosshair";
+        w->scale = 0.8;
+        
+        w = &add("value", "center", 40, 72);
+        w->label = "RNG ";
+        w->bind = "crosshair.range";
+        w->suffix = " m";
+        w->precision = 0;
+        w->when = "crosshair";
+        w->scale = 0.8;
+        
+        // File playback position and speed
+        w = &add("value", "bottom_center", -110, -15);
+        w->label = "T+ ";
+        w->bind = "playback.position";
+        w->suffix = " s";
+        w->precision = 1;
+        w->when = "playback";
+        
+        w = &add("value", "bottom_center", 30, -15);
+        w->bind = "playback.speed";
+        w->suffix = "x";
+        w->when = "playback";
+        
+        w = &add("indicator", "bottom_center", -40, -40);
+        w->label = "PAUSED";
+        w->when = "playback.paused";
     }
     
-    if (m_config.show_telemetry) {
-        drawTelemetry(frame, joystick, recording);
+    if (config.show_joystick_indicator) {
+        add("stick", "bottom_right", -60, -60).size = 80;
     }
     
-    if (m_config.show_joystick_indicator) {
-        drawJoystickIndicator(frame, joystick);
+    if (config.show_timestamp) {
+        add("clock", "top_right", -10, 25).align = "right";
     }
     
-    if (m_config.show_timestamp) {
-        drawTimestamp(frame);
+    // Only drawn once a tile pack is loaded and the platform position is known
+    HudWidgetConfig& map = add("map", "top_right", -10, 45);
+    map.align = "right";
+    map.when = "platform";
+    
+    if (config.show_detections) {
+        HudWidgetConfig& w = add("detections", "bottom_left", 10, -15);
+        w.when = "detections";
+        w.scale = 0.8;
     }
+    
+    // Frame-time governor shedding work
+    HudWidgetConfig& governor = add("value", "bottom_left", 10, -40);
+    governor.label = "DEGRADED L";
+    governor.bind = "governor.level";
+    governor.precision = 0;
+    governor.when = "degraded";
+    governor.color = {255, 160, 0};
+    governor.scale = 0.8;
+    
+    HudWidgetConfig& track = add("track", "center", 0, 0);
+    track.when = "tracking";
+    track.scale = 0.8;
+    
+    return widgets;
 }
 
-void Hud::drawCrosshair(cv::Mat& frame) {
-    int cx = frame.cols / 2;
-    int cy = frame.rows / 2;
-    int size = 30;
-    int gap = 8;
-    int thickness = 2;
+bool Hud::compile(const HudWidgetConfig& widget, HudCommand& cmd) const {
+    if (!lookup(kOpNames, widget.type, cmd.op)) {
+        std::cerr << "HUD: unknown widget type '" << widget.type << "', skipped" << std::endl;
+        return false;
+    }
+    if (!lookup(kConditionNames, widget.when, cmd.when)) {
+        std::cerr << "HUD: unknown condition '" << widget.when << "', widget skipped" << std::endl;
+        return false;
+    }
+    if (!lookup(kAnchorNames, widget.anchor, cmd.anchor)) {
+        std::cerr << "HUD: unknown anchor '" << widget.anchor << "', using top_left" << std::endl;
+    }
+    lookup(kAlignNames, widget.align, cmd.align);
     
-    // Horizontal lines
-    cv::line(frame, cv::Point(cx - size, cy), cv::Point(cx - gap, cy), m_crosshairColor, thickness);
-    cv::line(frame, cv::Point(cx + gap, cy), cv::Point(cx + size, cy), m_crosshairColor, thickness);
+    if (cmd.op == HudOp::Value || cmd.op == HudOp::Gauge) {
+        if (!lookup(kValueNames, widget.bind, cmd.value)) {
+            std::cerr << "HUD: unknown binding '" << widget.bind << "', widget skipped" << std::endl;
+            return false;
+        }
+    }
     
-    // Vertical lines
-    cv::line(frame, cv::Point(cx, cy - size), cv::Point(cx, cy - gap), m_crosshairColor, thickness);
-    cv::line(frame, cv::Point(cx, cy + gap), cv::Point(cx, cy + size), m_crosshairColor, thickness);
+    cmd.offset = cv::Point(widget.offset[0], widget.offset[1]);
+    cmd.fontScale = m_config.font_scale * widget.scale;
+    cmd.thickness = std::max(1, widget.thickness);
+    cmd.gap = widget.gap;
+    cmd.precision = std::clamp(widget.precision, 0, 6);
+    cmd.min = widget.min;
+    cmd.max = widget.max;
+    cmd.prefix = widget.label;
+    cmd.suffix = widget.suffix;
+    cmd.text.reserve(cmd.prefix.size() + cmd.suffix.size() + 64);
     
-    // Center dot
-    cv::circle(frame, cv::Point(cx, cy), 2, m_crosshairColor, -1);
+    cmd.size = widget.size;
+    if (cmd.size <= 0) {
+        switch (cmd.op) {
+            case HudOp::Reticle: cmd.size = 30; break;
+            case HudOp::Stick: cmd.size = 80; break;
+            case HudOp::Gauge: cmd.size = 100; break;
+            default: break;
+        }
+    }
+    
+    if (widget.color[0] >= 0) {
+        cmd.color = toBgr(widget.color);
+    } else {
+        switch (cmd.op) {
+            case HudOp::Reticle:
+            case HudOp::Stick:
+            case HudOp::Gauge:
+            case HudOp::Track:
+                cmd.color = m_crosshairColor;
+                break;
+            case HudOp::Indicator:
+                cmd.color = cv::Scalar(0, 0, 255);
+                break;
+            case HudOp::Detections:
+                cmd.color = cv::Scalar(0, 200, 255);  // Amber (BGR)
+                break;
+            default:
+                cmd.color = m_textColor;
+                break;
+        }
+    }
+    return true;
 }
 
-void Hud::drawTelemetry(cv::Mat& frame, const JoystickState& joystick, bool recording) {
-    int x, y;
+void Hud::layout(cv::Size frameSize) {
+    const int w = frameSize.width;
+    const int h = frameSize.height;
     
-    if (m_config.telemetry_position == "top_left") {
-        x = 10;
-        y = 25;
-    } else if (m_config.telemetry_position == "top_right") {
-        x = frame.cols - 200;
-        y = 25;
-    } else if (m_config.telemetry_position == "bottom_left") {
-        x = 10;
-        y = frame.rows - 100;
-    } else {
-        x = frame.cols - 200;
-        y = frame.rows - 100;
+    for (auto& cmd : m_commands) {
+        cv::Point base;
+        switch (cmd.anchor) {
+            case HudAnchor::TopLeft: base = cv::Point(0, 0); break;
+            case HudAnchor::TopCenter: base = cv::Point(w / 2, 0); break;
+            case HudAnchor::TopRight: base = cv::Point(w, 0); break;
+            case HudAnchor::Center: base = cv::Point(w / 2, h / 2); break;
+            case HudAnchor::BottomLeft: base = cv::Point(0, h); break;
+            case HudAnchor::BottomCenter: base = cv::Point(w / 2, h); break;
+            case HudAnchor::BottomRight: base = cv::Point(w, h); break;
+        }
+        cmd.pos = base + cmd.offset;
     }
+    m_layoutSize = frameSize;
+}
+
+void Hud::render(cv::Mat& frame, const JoystickState& joystick, bool recording) {
+    if (!m_config.enabled) return;
     
-    int lineHeight = 22;
+    if (frame.size() != m_layoutSize) {
+        layout(frame.size());
+    }
     
-    // Connection status
-    std::string status = joystick.connected ? "Joystick: CONNECTED" : "Joystick: DISCONNECTED";
-    cv::Scalar statusColor = joystick.connected ? m_textColor : cv::Scalar(0, 0, 255);
-    cv::putText(frame, status, cv::Point(x, y), cv::FONT_HERSHEY_SIMPLEX, 
-                m_config.font_scale, statusColor, 1);
-    y += lineHeight;
+    // Sample everything a widget may read, once per frame
+    double* v = m_values;
+    v[static_cast<int>(HudValue::JoystickPan)] = joystick.getPan();
+    v[static_cast<int>(HudValue::JoystickTilt)] = joystick.getTilt();
+    v[static_cast<int>(HudValue::JoystickZoom)] = joystick.getZoom();
+    v[static_cast<int>(HudValue::GimbalPan)] = m_gimbal.pan;
+    v[static_cast<int>(HudValue::GimbalTilt)] = m_gimbal.tilt;
+    v[static_cast<int>(HudValue::GimbalZoom)] = m_gimbal.zoom;
+    v[static_cast<int>(HudValue::GimbalHfov)] = m_gimbal.hfov;
+    v[static_cast<int>(HudValue::DetectorFps)] = static_cast<float>(m_detectorStats.fps);
+    v[static_cast<int>(HudValue::DetectorLatency)] = static_cast<float>(m_detectorStats.latencyMs);
+    v[static_cast<int>(HudValue::DetectorObjects)] = static_cast<float>(m_detections.boxes.size());
+    v[static_cast<int>(HudValue::TrackPsr)] = m_track.psr;
+    v[static_cast<int>(HudValue::TrackOffsetX)] = m_track.offset.x;
+    v[static_cast<int>(HudValue::TrackOffsetY)] = m_track.offset.y;
+    v[static_cast<int>(HudValue::PlatformLatitude)] = m_platform.latitude;
+    v[static_cast<int>(HudValue::PlatformLongitude)] = m_platform.longitude;
+    v[static_cast<int>(HudValue::PlatformAltitudeMsl)] = m_platform.altitudeMsl;
+    v[static_cast<int>(HudValue::PlatformAltitudeAgl)] = m_platform.altitudeAgl;
+    v[static_cast<int>(HudValue::PlatformHeading)] = m_platform.heading;
+    v[static_cast<int>(HudValue::PlatformPitch)] = m_platform.pitch;
+    v[static_cast<int>(HudValue::PlatformRoll)] = m_platform.roll;
+    v[static_cast<int>(HudValue::PlatformGroundSpeed)] = m_platform.groundSpeed;
+    v[static_cast<int>(HudValue::PlatformGimbalPan)] = m_platform.gimbalPan;
+    v[static_cast<int>(HudValue::PlatformGimbalTilt)] = m_platform.gimbalTilt;
+    v[static_cast<int>(HudValue::PlatformAge)] = m_platformAgeMs;
+    v[static_cast<int>(HudValue::CrosshairLatitude)] = m_groundPoint.latitude;
+    v[static_cast<int>(HudValue::CrosshairLongitude)] = m_groundPoint.longitude;
+    v[static_cast<int>(HudValue::CrosshairRange)] = m_groundPoint.slantRange;
+    v[static_cast<int>(HudValue::CrosshairGroundRange)] = m_groundPoint.groundRange;
+    v[static_cast<int>(HudValue::CrosshairFootprint)] = m_groundPoint.footprintWidth;
+    v[static_cast<int>(HudValue::PlaybackPosition)] = m_playback.positionSeconds;
+    v[static_cast<int>(HudValue::PlaybackSpeed)] = m_playback.speed;
+    v[static_cast<int>(HudValue::GovernorLevel)] = m_governor.level;
     
-    if (joystick.connected) {
-        // Show joystick name
-        cv::putText(frame, joystick.name.substr(0, 25), cv::Point(x, y), cv::FONT_HERSHEY_SIMPLEX,
-                    m_config.font_scale * 0.8, m_textColor, 1);
-        y += lineHeight;
-        
-        // Axis values
-        std::stringstream ss;
-        ss << std::fixed << std::setprecision(2);
-        ss << "Pan: " << joystick.getPan() << "  Tilt: " << joystick.getTilt();
-        cv::putText(frame, ss.str(), cv::Point(x, y), cv::FONT_HERSHEY_SIMPLEX,
-                    m_config.font_scale, m_textColor, 1);
-        y += lineHeight;
+    bool* c = m_conditions;
+    c[static_cast<int>(HudCondition::Always)] = true;
+    c[static_cast<int>(HudCondition::JoystickConnected)] = joystick.connected;
+    c[static_cast<int>(HudCondition::JoystickDisconnected)] = !joystick.connected;
+    c[static_cast<int>(HudCondition::Recording)] = recording;
+    c[static_cast<int>(HudCondition::Gimbal)] = m_hasGimbal;
+    c[static_cast<int>(HudCondition::Tracking)] = m_track.active;
+    c[static_cast<int>(HudCondition::Detections)] = m_hasDetections;
+    c[static_cast<int>(HudCondition::Platform)] = m_platformAgeMs >= 0 && !m_platformStale;
+    c[static_cast<int>(HudCondition::PlatformStale)] = m_platformAgeMs >= 0 && m_platformStale;
+    c[static_cast<int>(HudCondition::Crosshair)] = c[static_cast<int>(HudCondition::Platform)] && m_groundPoint.valid;
+    c[static_cast<int>(HudCondition::Playback)] = m_hasPlayback;
+    c[static_cast<int>(HudCondition::PlaybackPaused)] = m_hasPlayback && m_playback.paused;
+    c[static_cast<int>(HudCondition::Degraded)] = m_governor.level > 0;
+    
+    const bool refresh = m_governor.hudInterval <= 1 || m_renderCount % m_governor.hudInterval == 0;
+    m_renderCount++;
+    
+    char buf[128];
+    for (auto& cmd : m_commands) {
+        if (!c[static_cast<int>(cmd.when)]) continue;
         
-        ss.str("");
-        ss << "Zoom: " << joystick.getZoom();
-        cv::putText(frame, ss.str(), cv::Point(x, y), cv::FONT_HERSHEY_SIMPLEX,
-                    m_config.font_scale, m_textColor, 1);
-        y += lineHeight;
+        SAR_TRACE_SCOPE(kOpTraceNames[static_cast<int>(cmd.op)]);
+        switch (cmd.op) {
+            case HudOp::Reticle:
+                drawReticle(frame, cmd);
+                break;
+            case HudOp::Text:
+                drawText(frame, cmd, cmd.prefix.c_str(), static_cast<int>(cmd.prefix.size()));
+                break;
+            case HudOp::Value: {
+                if (!refresh && !cmd.text.empty()) {
+                    drawCachedText(frame, cmd);
+                    break;
+                }
+                int n = std::snprintf(buf, sizeof(buf), "%s%.*f%s", cmd.prefix.c_str(), cmd.precision,
+                                      v[static_cast<int>(cmd.value)], cmd.suffix.c_str());
+                drawText(frame, cmd, buf, std::min(n, static_cast<int>(sizeof(buf)) - 1));
+                break;
+            }
+            case HudOp::JoystickName:
+                drawText(frame, cmd, joystick.name.c_str(), std::min(static_cast<int>(joystick.name.size()), 25));
+                break;
+            case HudOp::Clock: {
+                // Reformat only when the second changes
+                std::time_t now = std::time(nullptr);
+                if (now != m_clockTime) {
+                    m_clockTime = now;
+                    std::strftime(m_clockText, sizeof(m_clockText), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+                }
+                drawText(frame, cmd, m_clockText, static_cast<int>(std::strlen(m_clockText)));
+                break;
+            }
+            case HudOp::Gauge:
+                drawGauge(frame, cmd);
+                break;
+            case HudOp::Indicator:
+                drawIndicator(frame, cmd);
+                break;
+            case HudOp::Stick:
+                drawStick(frame, cmd, joystick);
+                break;
+            case HudOp::Detections:
+                drawDetections(frame, cmd);
+                break;
+            case HudOp::Track:
+                drawTrack(frame, cmd);
+                break;
+            case HudOp::Map:
+                drawMap(frame, cmd, refresh);
+                break;
+        }
+    }
+}
+
+void Hud::setDetections(const DetectionResult& result, const DetectorStats& stats, uint64_t frameSequence) {
+    // Called every frame, but the detector publishes far less often; only a new
+    // result is worth copying the boxes for
+    if (result.sequence != m_detections.sequence || !m_hasDetections) {
+        m_detections.sequence = result.sequence;
+        m_detections.boxes = result.boxes;
+        m_detections.motion = result.motion;
+    }
+    m_detectorStats = stats;
+    m_frameSequence = frameSequence;
+    m_hasDetections = true;
+}
+
+void Hud::setTrack(const TrackState& track) {
+    m_track = track;
+}
+
+void Hud::setGimbal(const GimbalState& gimbal) {
+    m_gimbal = gimbal;
+    m_hasGimbal = true;
+}
+
+void Hud::setPlatform(const PlatformTelemetry& platform, double ageMs, bool stale) {
+    m_platform = platform;
+    m_platformAgeMs = ageMs;
+    m_platformStale = stale;
+}
+
+void Hud::setGroundPoint(const GroundPoint& point) {
+    m_groundPoint = point;
+}
+
+void Hud::setPlayback(const PlaybackStatus& playback) {
+    m_playback = playback;
+    m_hasPlayback = true;
+}
+
+void Hud::setMap(TileMap* map) {
+    m_map = map;
+}
+
+void Hud::setGovernor(const GovernorState& state) {
+    m_governor = state;
+}
+
+cv::Rect Hud::toFrame(const cv::Rect& box) const {
+    if (m_governor.renderScale == 1.0) return box;
+    const double s = m_governor.renderScale;
+    return cv::Rect(cvRound(box.x * s), cvRound(box.y * s), cvRound(box.width * s), cvRound(box.height * s));
+}
+
+void Hud::drawText(cv::Mat& frame, HudCommand& cmd, const char* text, int length) {
+    // assign() reuses the reserved capacity, so no per-frame allocation
+    cmd.text.assign(text, static_cast<size_t>(std::max(length, 0)));
+    drawCachedText(frame, cmd);
+}
+
+void Hud::drawCachedText(cv::Mat& frame, const HudCommand& cmd) {
+    cv::Point pos = cmd.pos;
+    if (cmd.align != HudAlign::Left) {
+        int baseline;
+        cv::Size textSize = cv::getTextSize(cmd.text, cv::FONT_HERSHEY_SIMPLEX, cmd.fontScale,
+                                            cmd.thickness, &baseline);
+        pos.x -= (cmd.align == HudAlign::Right) ? textSize.width : textSize.width / 2;
     }
     
-    // Recording indicator
-    if (recording) {
-        cv::circle(frame, cv::Point(x + 8, y + 5), 8, cv::Scalar(0, 0, 255), -1);
-        cv::putText(frame, "REC", cv::Point(x + 22, y + 10), cv::FONT_HERSHEY_SIMPLEX,
-                    m_config.font_scale, cv::Scalar(0, 0, 255), 2);
+    cv::putText(frame, cmd.text, pos, cv::FONT_HERSHEY_SIMPLEX, cmd.fontScale, cmd.color, cmd.thickness);
+}
+
+void Hud::drawReticle(cv::Mat& frame, const HudCommand& cmd) {
+    const int cx = cmd.pos.x;
+    const int cy = cmd.pos.y;
+    const int size = cmd.size;
+    const int gap = cmd.gap;
+    
+    // Horizontal lines
+    cv::line(frame, cv::Point(cx - size, cy), cv::Point(cx - gap, cy), cmd.color, cmd.thickness);
+    cv::line(frame, cv::Point(cx + gap, cy), cv::Point(cx + size, cy), cmd.color, cmd.thickness);
+    
+    // Vertical lines
+    cv::line(frame, cv::Point(cx, cy - size), cv::Point(cx, cy - gap), cmd.color, cmd.thickness);
+    cv::line(frame, cv::Point(cx, cy + gap), cv::Point(cx, cy + size), cmd.color, cmd.thickness);
+    
+    // Center dot
+    cv::circle(frame, cv::Point(cx, cy), 2, cmd.color, -1);
+}
+
+void Hud::drawGauge(cv::Mat& frame, HudCommand& cmd) {
+    const int height = 8;
+    const double value = m_values[static_cast<int>(cmd.value)];
+    const double range = (cmd.max > cmd.min) ? cmd.max - cmd.min : 1.0;
+    
+    // Fill from zero (or the range start) to the value
+    double t = std::clamp((value - cmd.min) / range, 0.0, 1.0);
+    double z = std::clamp(-cmd.min / range, 0.0, 1.0);
+    int x0 = cmd.pos.x + cvRound(std::min(t, z) * cmd.size);
+    int x1 = cmd.pos.x + cvRound(std::max(t, z) * cmd.size);
+    
+    cv::rectangle(frame, cv::Rect(x0, cmd.pos.y - height, std::max(1, x1 - x0), height), cmd.color, -1);
+    cv::rectangle(frame, cv::Rect(cmd.pos.x, cmd.pos.y - height, cmd.size, height), cmd.color, 1);
+    
+    if (!cmd.prefix.empty() || !cmd.suffix.empty()) {
+        char buf[128];
+        int n = std::snprintf(buf, sizeof(buf), "%s%.*f%s", cmd.prefix.c_str(), cmd.precision, value,
+                              cmd.suffix.c_str());
+        cmd.text.assign(buf, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(buf)) - 1)));
+        cv::putText(frame, cmd.text, cv::Point(cmd.pos.x + cmd.size + 6, cmd.pos.y), cv::FONT_HERSHEY_SIMPLEX,
+                    cmd.fontScale, cmd.color, 1);
     }
 }
 
-void Hud::drawJoystickIndicator(cv::Mat& frame, const JoystickState& joystick) {
-    // Draw in bottom-right corner
-    int size = 80;
-    int margin = 20;
-    int cx = frame.cols - margin - size / 2;
-    int cy = frame.rows - margin - size / 2;
+void Hud::drawIndicator(cv::Mat& frame, const HudCommand& cmd) {
+    cv::circle(frame, cmd.pos + cv::Point(8, -5), 8, cmd.color, -1);
+    cv::putText(frame, cmd.prefix, cmd.pos + cv::Point(22, 0), cv::FONT_HERSHEY_SIMPLEX,
+                cmd.fontScale, cmd.color, cmd.thickness);
+}
+
+void Hud::drawStick(cv::Mat& frame, const HudCommand& cmd, const JoystickState& joystick) {
+    const int size = cmd.size;
+    const int cx = cmd.pos.x;
+    const int cy = cmd.pos.y;
     
     // Background circle
     cv::circle(frame, cv::Point(cx, cy), size / 2, cv::Scalar(50, 50, 50), -1);
-    cv::circle(frame, cv::Point(cx, cy), size / 2, m_crosshairColor, 1);
+    cv::circle(frame, cv::Point(cx, cy), size / 2, cmd.color, 1);
     
     // Crosshair
-    cv::line(frame, cv::Point(cx - size/2, cy), cv::Point(cx + size/2, cy), 
+    cv::line(frame, cv::Point(cx - size/2, cy), cv::Point(cx + size/2, cy),
              cv::Scalar(80, 80, 80), 1);
-    cv::line(frame, cv::Point(cx, cy - size/2), cv::Point(cx, cy + size/2), 
+    cv::line(frame, cv::Point(cx, cy - size/2), cv::Point(cx, cy + size/2),
              cv::Scalar(80, 80, 80), 1);
     
     // Joystick position
@@ -140,28 +629,85 @@ void Hud::drawJoystickIndicator(cv::Mat& frame, const JoystickState& joystick) {
         int dx = static_cast<int>(joystick.getPan() * (size / 2 - 5));
         int dy = static_cast<int>(joystick.getTilt() * (size / 2 - 5));
         
-        cv::circle(frame, cv::Point(cx + dx, cy + dy), 6, m_crosshairColor, -1);
+        cv::circle(frame, cv::Point(cx + dx, cy + dy), 6, cmd.color, -1);
     }
 }
 
-void Hud::drawTimestamp(cv::Mat& frame) {
-    // Get current time
-    auto now = std::time(nullptr);
-    auto tm = std::localtime(&now);
+void Hud::drawDetections(cv::Mat& frame, HudCommand& cmd) {
+    const uint64_t maxAge = 60;              // Frames before boxes are considered stale
     
-    std::stringstream ss;
-    ss << std::put_time(tm, "%Y-%m-%d %H:%M:%S");
+    // Carry boxes forward by the global motion since the frame they were detected on
+    if (m_detections.sequence > 0 && m_frameSequence >= m_detections.sequence &&
+        m_frameSequence - m_detections.sequence <= maxAge) {
+        float age = static_cast<float>(m_frameSequence - m_detections.sequence);
+        cv::Point offset(cvRound(m_detections.motion.x * age), cvRound(m_detections.motion.y * age));
+        
+        for (const auto& box : m_detections.boxes) {
+            cv::Rect scaled = toFrame(cv::Rect(box.x + offset.x, box.y + offset.y, box.width, box.height));
+            cv::Rect shifted(scaled.x - 4, scaled.y - 4, scaled.width + 8, scaled.height + 8);
+            cv::rectangle(frame, shifted, cmd.color, 1);
+        }
+    }
+    
+    // Detector throughput and latency
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "DET %.1f fps  %.1f ms  %zu obj", m_detectorStats.fps,
+                  m_detectorStats.latencyMs, m_detections.boxes.size());
+    drawText(frame, cmd, buf, static_cast<int>(std::strlen(buf)));
+}
+
+void Hud::drawTrack(cv::Mat& frame, HudCommand& cmd) {
+    cv::Scalar color = m_track.lost ? cv::Scalar(0, 0, 255) : cmd.color;
+    cv::Rect box = toFrame(cv::Rect(m_track.box));
+    
+    // Corner brackets around the target
+    int len = std::max(6, box.width / 4);
+    cv::Point corners[4] = {box.tl(), cv::Point(box.x + box.width, box.y),
+                            box.br(), cv::Point(box.x, box.y + box.height)};
+    int sx[4] = {1, -1, -1, 1};
+    int sy[4] = {1, 1, -1, -1};
+    for (int i = 0; i < 4; i++) {
+        cv::line(frame, corners[i], corners[i] + cv::Point(sx[i] * len, 0), color, 2);
+        cv::line(frame, corners[i], corners[i] + cv::Point(0, sy[i] * len), color, 2);
+    }
     
-    // Draw in top-right corner
-    int baseline;
-    cv::Size textSize = cv::getTextSize(ss.str(), cv::FONT_HERSHEY_SIMPLEX, 
-                                         m_config.font_scale, 1, &baseline);
+    // Offset from the crosshair
+    cv::Point center(frame.cols / 2, frame.rows / 2);
+    cv::Point target(cvRound(box.x + box.width / 2.0), cvRound(box.y + box.height / 2.0));
+    cv::line(frame, center, target, color, 1);
     
-    int x = frame.cols - textSize.width - 10;
-    int y = 25;
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), "%s%+.0f,%+.0f px  PSR %.1f", m_track.lost ? "TRK LOST " : "TRK ",
+                  m_track.offset.x, m_track.offset.y, m_track.psr);
+    cmd.text.assign(buf);
+    cv::putText(frame, cmd.text, cv::Point(box.x, box.y + box.height + 18), cv::FONT_HERSHEY_SIMPLEX,
+                cmd.fontScale, color, 1);
+}
+
+void Hud::drawMap(cv::Mat& frame, const HudCommand& cmd, bool refresh) {
+    if (!m_map || !m_map->isOpen()) return;
     
-    cv::putText(frame, ss.str(), cv::Point(x, y), cv::FONT_HERSHEY_SIMPLEX,
-                m_config.font_scale, m_textColor, 1);
+    // Widget size overrides the map's configured inset size; pos is the aligned corner
+    int size = cmd.size > 0 ? cmd.size : m_map->insetSize();
+    cv::Point origin = cmd.pos;
+    if (cmd.align == HudAlign::Right) origin.x -= size;
+    if (cmd.align == HudAlign::Center) origin.x -= size / 2;
+    
+    cv::Rect rect(origin, cv::Size(size, size));
+    cv::Rect visible = rect & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (!refresh && visible == m_mapRect && !m_mapCache.empty()) {
+        cv::Mat target = frame(visible);
+        m_mapCache.copyTo(target);
+        return;
+    }
+    
+    m_map->render(frame, rect, m_platform, m_groundPoint);
+    if (m_governor.hudInterval > 1 && !visible.empty()) {
+        frame(visible).copyTo(m_mapCache);
+        m_mapRect = visible;
+    } else {
+        m_mapCache.release();
+    }
 }
 
 } // namespace sar
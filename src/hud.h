@@ -1,11 +1,74 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <ctime>
+#include <vector>
 #include "config.h"
 #include "joystick.h"
+#include "detector.h"
+#include "tracker.h"
+#include "gimbal.h"
+#include "telemetry.h"
+#include "geo.h"
+#include "tilemap.h"
+#include "playback.h"
+#include "governor.h"
 
 namespace sar {
 
+enum class HudOp : uint8_t {
+    Reticle, Text, Value, JoystickName, Clock, Gauge, Indicator, Stick, Detections, Track, Map
+};
+
+// Telemetry values a widget can bind to; sampled once per frame into a flat array
+enum class HudValue : uint8_t {
+    JoystickPan, JoystickTilt, JoystickZoom,
+    GimbalPan, GimbalTilt, GimbalZoom, GimbalHfov,
+    DetectorFps, DetectorLatency, DetectorObjects,
+    TrackPsr, TrackOffsetX, TrackOffsetY,
+    PlatformLatitude, PlatformLongitude, PlatformAltitudeMsl, PlatformAltitudeAgl,
+    PlatformHeading, PlatformPitch, PlatformRoll, PlatformGroundSpeed,
+    PlatformGimbalPan, PlatformGimbalTilt, PlatformAge,
+    CrosshairLatitude, CrosshairLongitude, CrosshairRange, CrosshairGroundRange, CrosshairFootprint,
+    PlaybackPosition, PlaybackSpeed,
+    GovernorLevel,
+    Count
+};
+
+enum class HudCondition : uint8_t {
+    Always, JoystickConnected, JoystickDisconnected, Recording, Gimbal, Tracking, Detections,
+    Platform, PlatformStale, Crosshair, Playback, PlaybackPaused, Degraded, Count
+};
+
+enum class HudAnchor : uint8_t {
+    TopLeft, TopCenter, TopRight, Center, BottomLeft, BottomCenter, BottomRight
+};
+
+enum class HudAlign : uint8_t { Left, Center, Right };
+
+// A widget with every name, colour and string resolved. Only pos depends on the
+// frame size and is recomputed when that changes.
+struct HudCommand {
+    HudOp op = HudOp::Text;
+    HudCondition when = HudCondition::Always;
+    HudValue value = HudValue::JoystickPan;
+    HudAnchor anchor = HudAnchor::TopLeft;
+    HudAlign align = HudAlign::Left;
+    cv::Point offset;
+    cv::Point pos;
+    cv::Scalar color;
+    double fontScale = 0.6;
+    int thickness = 1;
+    int size = 0;
+    int gap = 0;
+    int precision = 2;
+    double min = -1.0;
+    double max = 1.0;
+    std::string prefix;
+    std::string suffix;
+    std::string text;               // Per-frame scratch; capacity reserved at compile time
+};
+
 class Hud {
 public:
     Hud();
@@ -14,15 +77,72 @@ public:
     
     void render(cv::Mat& frame, const JoystickState& joystick, bool recording);
     
+    // Latest detector output and the sequence number of the frame about to be rendered
+    void setDetections(const DetectionResult& result, const DetectorStats& stats, uint64_t frameSequence);
+    void setTrack(const TrackState& track);
+    void setGimbal(const GimbalState& gimbal);
+    void setPlatform(const PlatformTelemetry& platform, double ageMs, bool stale);
+    void setGroundPoint(const GroundPoint& point);
+    void setPlayback(const PlaybackStatus& playback);
+    
+    // Shown as governor.level / degraded; also sets the value refresh interval and
+    // the scale detection and track boxes are drawn at
+    void setGovernor(const GovernorState& state);
+    
+    // Moving map drawn by "map" widgets; nullptr (the default) hides them
+    void setMap(TileMap* map);
+    
 private:
-    void drawCrosshair(cv::Mat& frame);
-    void drawTelemetry(cv::Mat& frame, const JoystickState& joystick, bool recording);
-    void drawJoystickIndicator(cv::Mat& frame, const JoystickState& joystick);
-    void drawTimestamp(cv::Mat& frame);
+    static std::vector<HudWidgetConfig> defaultLayout(const HudConfig& config);
+    bool compile(const HudWidgetConfig& widget, HudCommand& cmd) const;
+    void layout(cv::Size frameSize);
+    
+    void drawText(cv::Mat& frame, HudCommand& cmd, const char* text, int length);
+    void drawCachedText(cv::Mat& frame, const HudCommand& cmd);
+    void drawReticle(cv::Mat& frame, const HudCommand& cmd);
+    void drawGauge(cv::Mat& frame, HudCommand& cmd);
+    void drawIndicator(cv::Mat& frame, const HudCommand& cmd);
+    void drawStick(cv::Mat& frame, const HudCommand& cmd, const JoystickState& joystick);
+    void drawDetections(cv::Mat& frame, HudCommand& cmd);
+    void drawTrack(cv::Mat& frame, HudCommand& cmd);
+    void drawMap(cv::Mat& frame, const HudCommand& cmd, bool refresh);
+    cv::Rect toFrame(const cv::Rect& box) const;
     
     HudConfig m_config;
     cv::Scalar m_crosshairColor;
     cv::Scalar m_textColor;
+    
+    std::vector<HudCommand> m_commands;
+    cv::Size m_layoutSize;
+    double m_values[static_cast<int>(HudValue::Count)] = {};
+    bool m_conditions[static_cast<int>(HudCondition::Count)] = {};
+    std::time_t m_clockTime = 0;
+    char m_clockText[32] = {};
+    
+    DetectionResult m_detections;
+    DetectorStats m_detectorStats;
+    uint64_t m_frameSequence = 0;
+    bool m_hasDetections = false;
+    
+    TrackState m_track;
+    GimbalState m_gimbal;
+    bool m_hasGimbal = false;
+    
+    PlatformTelemetry m_platform;
+    double m_platformAgeMs = -1.0;
+    bool m_platformStale = true;
+    GroundPoint m_groundPoint;
+    
+    PlaybackStatus m_playback;
+    bool m_hasPlayback = false;
+    
+    TileMap* m_map = nullptr;
+    
+    // Between refreshes, values keep their last text and the map inset is copied
+    GovernorState m_governor;
+    uint64_t m_renderCount = 0;
+    cv::Mat m_mapCache;
+    cv::Rect m_mapRect;
 };
 
 } // namespace sar
@@ -1,9 +1,14 @@
 #include "joystick.h"
+#include "metrics.h"
+#include "trace.h"
 #include <iostream>
 #include <cmath>
 
 namespace sar {
 
+static Counter& s_events = Metrics::instance().counter(
+    "sar_joystick_events_total", "Joystick events handled from the active device");
+
 Joystick::Joystick() {}
 
 Joystick::~Joystick() {
@@ -65,6 +70,8 @@ void Joystick::shutdown() {
 }
 
 void Joystick::update() {
+    SAR_TRACE_SCOPE("joystick.update");
+    
     // Process SDL events for joystick
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
@@ -84,6 +91,7 @@ void Joystick::update() {
             case SDL_JOYBUTTONDOWN:
             case SDL_JOYBUTTONUP:
                 if (event.jbutton.which == m_instanceId) {
+                    s_events.inc();
                     int button = event.jbutton.button;
                     bool pressed = (event.type == SDL_JOYBUTTONDOWN);
                     
@@ -99,6 +107,7 @@ void Joystick::update() {
                 
             case SDL_JOYAXISMOTION:
                 if (event.jaxis.which == m_instanceId) {
+                    s_events.inc();
                     int axis = event.jaxis.axis;
                     if (axis < static_cast<int>(m_state.axes.size())) {
                         // Normalize from -32768..32767 to -1.0..1.0
@@ -111,6 +120,7 @@ void Joystick::update() {
                 
             case SDL_JOYHATMOTION:
                 if (event.jhat.which == m_instanceId) {
+                    s_events.inc();
                     int hat = event.jhat.hat;
                     if (hat < static_cast<int>(m_state.hats.size())) {
                         m_state.hats[hat] = event.jhat.value;
@@ -0,0 +1,273 @@
+#include "lens.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace sar {
+
+static constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+
+// Rows per remap band; each band is an independent slice of the output
+static constexpr int kBandRows = 64;
+
+static Counter& s_builds = Metrics::instance().counter(
+    "sar_lens_table_builds_total", "Undistortion remap tables built");
+static Counter& s_fallbacks = Metrics::instance().counter(
+    "sar_lens_fallback_frames_total", "Frames undistorted with a neighbouring zoom step, or not at all, while a table was built");
+static Gauge& s_cached = Metrics::instance().gauge(
+    "sar_lens_cached_tables", "Undistortion remap tables held in memory");
+static Histogram& s_remapTime = Metrics::instance().stage("lens");
+
+Lens::Lens() {}
+
+Lens::~Lens() {
+    shutdown();
+}
+
+bool Lens::init(const VideoConfig& video, const GimbalConfig& gimbal) {
+    m_config = video.lens;
+    m_gimbal = gimbal;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    if (m_config.calibration.empty()) {
+        std::cerr << "Lens: no calibration entries, undistortion disabled" << std::endl;
+        return false;
+    }
+    
+    std::sort(m_config.calibration.begin(), m_config.calibration.end(),
+              [](const LensCalibration& a, const LensCalibration& b) { return a.zoom < b.zoom; });
+    if (m_config.steps_per_doubling < 1) m_config.steps_per_doubling = 1;
+    if (m_config.cache_tables < 1) m_config.cache_tables = 1;
+    m_config.alpha = std::clamp(m_config.alpha, 0.0, 1.0);
+    
+    m_calibrationSize = cv::Size(m_config.width > 0 ? m_config.width : video.width,
+                                 m_config.height > 0 ? m_config.height : video.height);
+    
+    // The FOV of each step only depends on the model, so the HUD never waits for a table
+    m_maxStep = stepFor(m_gimbal.max_zoom);
+    m_stepFov.clear();
+    for (int step = 0; step <= m_maxStep; step++) {
+        Intrinsics in = model(zoomFor(step), m_calibrationSize);
+        cv::Matx33d camera = undistortedCamera(in, m_calibrationSize);
+        m_stepFov.push_back(static_cast<float>(
+            2.0 * std::atan(m_calibrationSize.width * 0.5 / std::max(camera(0, 0), 1e-6)) / kDegToRad));
+    }
+    
+    m_running = true;
+    m_thread = std::thread(&Lens::builderThread, this);
+    
+    std::cout << "Lens model: " << m_config.calibration.size() << " calibration point(s) at "
+              << m_calibrationSize.width << "x" << m_calibrationSize.height << ", "
+              << (m_maxStep + 1) << " zoom steps, wide HFOV " << m_stepFov.front() << " deg" << std::endl;
+    return true;
+}
+
+void Lens::shutdown() {
+    if (!m_running) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_requestCv.notify_all();
+    
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    m_tables.clear();
+    m_requests.clear();
+    s_cached.set(0);
+}
+
+int Lens::stepFor(float zoom) const {
+    double ratio = std::max(1.0, static_cast<double>(zoom) / std::max(m_gimbal.min_zoom, 0.01f));
+    int step = static_cast<int>(std::lround(std::log2(ratio) * m_config.steps_per_doubling));
+    return std::clamp(step, 0, std::max(m_maxStep, 0));
+}
+
+float Lens::zoomFor(int step) const {
+    return std::max(m_gimbal.min_zoom, 0.01f) *
+           static_cast<float>(std::exp2(static_cast<double>(step) / m_config.steps_per_doubling));
+}
+
+Lens::Intrinsics Lens::model(float zoom, cv::Size size) const {
+    const auto& points = m_config.calibration;
+    
+    // Bracketing calibration points; clamped outside the calibrated range
+    size_t hi = 0;
+    while (hi < points.size() && points[hi].zoom < zoom) hi++;
+    size_t lo = hi == 0 ? 0 : hi - 1;
+    hi = std::min(hi, points.size() - 1);
+    double t = 0.0;
+    if (hi != lo && points[hi].zoom > points[lo].zoom) {
+        t = std::clamp(static_cast<double>(zoom - points[lo].zoom) / (points[hi].zoom - points[lo].zoom), 0.0, 1.0);
+    }
+    
+    const double w = m_calibrationSize.width;
+    const double h = m_calibrationSize.height;
+    
+    // Unset focal lengths follow the simulated gimbal's zoom curve
+    auto focal = [&](const LensCalibration& c) {
+        if (c.fx > 0.0) return c.fx;
+        double wideHalf = m_gimbal.hfov_wide * 0.5 * kDegToRad;
+        double zoomRatio = c.zoom / std::max(m_gimbal.min_zoom, 0.01f);
+        return w * 0.5 * zoomRatio / std::tan(wideHalf);
+    };
+    auto lerp = [t](double a, double b) { return a + (b - a) * t; };
+    
+    const LensCalibration& a = points[lo];
+    const LensCalibration& b = points[hi];
+    double fxA = focal(a), fxB = focal(b);
+    double fx = lerp(fxA, fxB);
+    double fy = lerp(a.fy > 0.0 ? a.fy : fxA, b.fy > 0.0 ? b.fy : fxB);
+    double cx = lerp(a.cx > 0.0 ? a.cx : w * 0.5, b.cx > 0.0 ? b.cx : w * 0.5);
+    double cy = lerp(a.cy > 0.0 ? a.cy : h * 0.5, b.cy > 0.0 ? b.cy : h * 0.5);
+    
+    // Calibrated in pixels at one resolution; scale to the frame's
+    const double sx = size.width / w;
+    const double sy = size.height / h;
+    
+    Intrinsics in;
+    in.camera = cv::Matx33d(fx * sx, 0.0, cx * sx,
+                            0.0, fy * sy, cy * sy,
+                            0.0, 0.0, 1.0);
+    in.distortion.assign(5, 0.0);
+    for (size_t i = 0; i < in.distortion.size(); i++) {
+        double da = i < a.distortion.size() ? a.distortion[i] : 0.0;
+        double db = i < b.distortion.size() ? b.distortion[i] : 0.0;
+        in.distortion[i] = lerp(da, db);
+    }
+    return in;
+}
+
+cv::Matx33d Lens::undistortedCamera(const Intrinsics& in, cv::Size size) const {
+    cv::Mat camera = cv::getOptimalNewCameraMatrix(in.camera, in.distortion, size, m_config.alpha, size);
+    return cv::Matx33d(camera);
+}
+
+float Lens::horizontalFov(float zoom) const {
+    if (m_stepFov.empty()) return m_gimbal.hfov_wide;
+    
+    // Steps are uniform in log zoom, so interpolate between them there
+    double ratio = std::max(1.0, static_cast<double>(zoom) / std::max(m_gimbal.min_zoom, 0.01f));
+    double position = std::clamp(std::log2(ratio) * m_config.steps_per_doubling, 0.0, static_cast<double>(m_maxStep));
+    int lo = static_cast<int>(position);
+    int hi = std::min(lo + 1, m_maxStep);
+    float t = static_cast<float>(position - lo);
+    return m_stepFov[lo] + (m_stepFov[hi] - m_stepFov[lo]) * t;
+}
+
+std::shared_ptr<const Lens::Table> Lens::lookup(int step, cv::Size size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    
+    const TableKey key(size.width, size.height, step);
+    auto it = m_tables.find(key);
+    if (it != m_tables.end()) {
+        it->second->lastUsed = ++m_useClock;
+        return it->second;
+    }
+    
+    if (std::find(m_requests.begin(), m_requests.end(), key) == m_requests.end()) {
+        m_requests.push_back(key);
+        m_requestCv.notify_one();
+    }
+    
+    // Nearest step we already have at this size, until this one is built
+    s_fallbacks.inc();
+    std::shared_ptr<const Table> nearest;
+    for (const auto& entry : m_tables) {
+        if (entry.second->size != size) continue;
+        if (!nearest || std::abs(entry.second->step - step) < std::abs(nearest->step - step)) {
+            nearest = entry.second;
+        }
+    }
+    return nearest;
+}
+
+std::shared_ptr<Lens::Table> Lens::build(int step, cv::Size size) const {
+    SAR_TRACE_SCOPE("lens.build");
+    auto table = std::make_shared<Table>();
+    table->step = step;
+    table->size = size;
+    
+    Intrinsics in = model(zoomFor(step), size);
+    cv::Matx33d camera = undistortedCamera(in, size);
+    cv::initUndistortRectifyMap(in.camera, in.distortion, cv::noArray(), camera, size, CV_16SC2,
+                                table->map1, table->map2);
+    return table;
+}
+
+void Lens::builderThread() {
+    applyThreadTopology("lens");
+    
+    while (true) {
+        TableKey key;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_requestCv.wait(lock, [this] { return !m_running || !m_requests.empty(); });
+            if (!m_running) break;
+            key = m_requests.front();
+        }
+        const cv::Size size(std::get<0>(key), std::get<1>(key));
+        const int step = std::get<2>(key);
+        
+        auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<Table> table = build(step, size);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        s_builds.inc();
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_requests.empty() && m_requests.front() == key) {
+            m_requests.pop_front();
+        }
+        
+        // One LRU budget across sizes, so switching streams back and forth stays warm
+        table->lastUsed = ++m_useClock;
+        m_tables[key] = table;
+        while (static_cast<int>(m_tables.size()) > m_config.cache_tables) {
+            auto oldest = std::min_element(m_tables.begin(), m_tables.end(), [](const auto& a, const auto& b) {
+                return a.second->lastUsed < b.second->lastUsed;
+            });
+            m_tables.erase(oldest);
+        }
+        s_cached.set(static_cast<double>(m_tables.size()));
+        
+        std::cout << "Lens: remap table for zoom " << zoomFor(step) << "x (" << size.width << "x"
+                  << size.height << ") built in " << ms << " ms" << std::endl;
+    }
+}
+
+void Lens::undistort(cv::Mat& frame, float zoom) {
+    if (!m_running || frame.empty()) return;
+    
+    SAR_TRACE_SCOPE("lens");
+    ScopedTimer timer(s_remapTime);
+    
+    std::shared_ptr<const Table> table = lookup(stepFor(zoom), frame.size());
+    if (!table) return;
+    
+    // The previous output may still be queued for the recorder; never write into it
+    if (m_output.u && m_output.u->refcount > 1) {
+        m_output.release();
+    }
+    m_output.create(frame.size(), frame.type());
+    
+    // Fixed-point bilinear remap, one band of output rows per task
+    const cv::Mat source = frame;
+    cv::Mat output = m_output;
+    cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+        cv::Rect band(0, rows.start, source.cols, rows.end - rows.start);
+        cv::Mat out = output(band);
+        cv::remap(source, out, table->map1(band), table->map2(band), cv::INTER_LINEAR, cv::BORDER_CONSTANT);
+    }, std::max(1, frame.rows / kBandRows));
+    std::swap(frame, m_output);
+}
+
+} // namespace sar
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+// Calibrated lens model and undistortion. Intrinsics and distortion are
+// interpolated between the calibrated zoom positions; zoom is quantised into
+// steps, and each step's fixed-point remap table is built on a background thread
+// the first time a frame needs it. Until then the nearest cached step is used,
+// or the frame passes through untouched if there is none yet.
+class Lens {
+public:
+    Lens();
+    ~Lens();
+    
+    bool init(const VideoConfig& video, const GimbalConfig& gimbal);
+    void shutdown();
+    
+    // One caller at a time (the render loop or the effects stage); remaps in place
+    void undistort(cv::Mat& frame, float zoom);
+    
+    // Any thread: horizontal FOV of the undistorted image at this zoom (degrees)
+    float horizontalFov(float zoom) const;
+    
+    bool isRunning() const { return m_running.load(); }
+    
+private:
+    struct Intrinsics {
+        cv::Matx33d camera;
+        std::vector<double> distortion;    // Always 5 coefficients
+    };
+    
+    // Frame width, height and zoom step; the substream and main stream each keep tables
+    using TableKey = std::tuple<int, int, int>;
+    
+    struct Table {
+        int step = 0;
+        cv::Size size;
+        cv::Mat map1;                      // CV_16SC2 integer source coordinates
+        cv::Mat map2;                      // CV_16UC1 interpolation weights
+        uint64_t lastUsed = 0;
+    };
+    
+    Intrinsics model(float zoom, cv::Size size) const;
+    cv::Matx33d undistortedCamera(const Intrinsics& in, cv::Size size) const;
+    int stepFor(float zoom) const;
+    float zoomFor(int step) const;
+    std::shared_ptr<const Table> lookup(int step, cv::Size size);
+    std::shared_ptr<Table> build(int step, cv::Size size) const;
+    void builderThread();
+    
+    LensConfig m_config;
+    GimbalConfig m_gimbal;
+    cv::Size m_calibrationSize;
+    int m_maxStep = 0;
+    std::vector<float> m_stepFov;          // Undistorted HFOV per zoom step, fixed after init
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    // Cached tables for every frame size seen; the builder fills them on request
+    std::mutex m_mutex;
+    std::condition_variable m_requestCv;
+    std::map<TableKey, std::shared_ptr<Table>> m_tables;
+    std::deque<TableKey> m_requests;
+    uint64_t m_useClock = 0;
+    
+    // Caller-owned output buffer
+    cv::Mat m_output;
+};
+
+} // namespace sar
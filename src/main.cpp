@@ -4,6 +4,11 @@
 #include <iomanip>
 #include <ctime>
 #include <csignal>
+#include <chrono>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <SDL.h>
 #include <opencv2/opencv.hpp>
 
@@ -12,23 +17,79 @@
 #include "video.h"
 #include "hud.h"
 #include "recorder.h"
+#include "detector.h"
+#include "tracker.h"
+#include "gimbal.h"
+#include "gimbal_link.h"
+#include "telemetry.h"
+#include "geo.h"
+#include "tilemap.h"
+#include "lens.h"
+#include "scenario.h"
+#include "effects.h"
+#include "enhance.h"
+#include "replay.h"
+#include "governor.h"
+#include "frame_graph.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
 
 using namespace sar;
 
 // Global flag for clean shutdown
 static volatile bool g_running = true;
 
+static Counter& s_renderedFrames = Metrics::instance().counter(
+    "sar_render_frames_total", "Frames rendered to the display");
+static Counter& s_duplicateFrames = Metrics::instance().counter(
+    "sar_render_duplicate_frames_total", "Renders that repeated the previous source frame");
+static Counter& s_skippedFrames = Metrics::instance().counter(
+    "sar_render_skipped_frames_total", "Source frames never rendered");
+static Gauge& s_renderFps = Metrics::instance().gauge(
+    "sar_render_fps", "Display loop render rate");
+static Histogram& s_inputTime = Metrics::instance().stage("input");
+static Histogram& s_fetchTime = Metrics::instance().stage("fetch");
+static Histogram& s_trackerTime = Metrics::instance().stage("tracker");
+static Histogram& s_hudTime = Metrics::instance().stage("hud");
+static Histogram& s_displayTime = Metrics::instance().stage("display");
+
+// Per-frame state for the pipelined loop: what the main thread saw when the frame
+// entered the graph, plus what earlier stages hand to later ones
+struct LiveFrame : FrameSlot {
+    GimbalState gimbal;
+    JoystickState joystick;
+    bool recording = false;
+    bool hudEnabled = true;
+    bool hasPlatform = false;
+    PlatformTelemetry platform;
+    double platformAgeMs = -1.0;
+    bool platformStale = true;
+    GroundPoint groundPoint;
+    bool hasPlayback = false;
+    PlaybackStatus playback;
+    DetectionResult detections;
+    TrackState track;
+};
+
 void signalHandler(int signum) {
     (void)signum;
     g_running = false;
 }
 
+#ifdef SIGUSR1
+void traceSignalHandler(int signum) {
+    (void)signum;
+    Trace::requestFlush();
+}
+#endif
+
 void printUsage(const char* programName) {
     std::cout << "SAR Simulator - Search and Rescue Training Simulator\n\n";
     std::cout << "Usage: " << programName << " [options]\n\n";
     std::cout << "Options:\n";
     std::cout << "  -c, --config <path>   Path to config file (default: config/default.json)\n";
-    std::cout << "  -v, --video <source>  Video source (camera index or RTSP URL)\n";
+    std::cout << "  -v, --video <source>  Video source (camera index, RTSP URL, file or shm:<name>)\n";
     std::cout << "  -j, --joystick <idx>  Joystick device index (default: 0)\n";
     std::cout << "  -l, --list-joysticks  List available joysticks and exit\n";
     std::cout << "  -h, --help            Show this help message\n\n";
@@ -37,6 +98,16 @@ void printUsage(const char* programName) {
     std::cout << "  F         Toggle fullscreen\n";
     std::cout << "  H         Toggle HUD\n";
     std::cout << "  S         Take screenshot\n";
+    std::cout << "  T         Lock/release tracker on crosshair\n";
+    std::cout << "  E         Toggle sensor effects\n";
+    std::cout << "  G         Restart the training scenario clock\n";
+    std::cout << "  I         Cycle thermal palette\n";
+    std::cout << "  P         Write performance trace (when tracing is enabled)\n";
+    std::cout << "  B / N     Instant replay: step back/forward one frame\n";
+    std::cout << "  L         Return from replay to live\n";
+    std::cout << "  SPACE     Pause/resume file playback\n";
+    std::cout << "  , / .     Seek file playback back/forward\n";
+    std::cout << "  [ / ]     Halve/double playback speed\n";
     std::cout << "  Q / ESC   Quit\n";
 }
 
@@ -111,6 +182,13 @@ int main(int argc, char* argv[]) {
         config.joystick.device_index = joystickOverride;
     }
     
+    // Thread topology must be known before any pipeline thread starts
+    configureThreads(config.threads);
+    Trace::init(config.trace);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, traceSignalHandler);
+#endif
+    
     // Initialize SDL (for joystick and window events)
     if (SDL_Init(SDL_INIT_JOYSTICK | SDL_INIT_EVENTS) < 0) {
         std::cerr << "Failed to initialize SDL: " << SDL_GetError() << std::endl;
@@ -124,7 +202,7 @@ int main(int argc, char* argv[]) {
     }
     
     Video video;
-    if (!video.init(config.video)) {
+    if (!video.init(config.video, config.playback, config.frame_bus)) {
         std::cerr << "Warning: Video initialization failed. Will retry in background." << std::endl;
     }
     
@@ -134,6 +212,51 @@ int main(int argc, char* argv[]) {
     Recorder recorder;
     recorder.init(config.recording);
     
+    Detector detector;
+    detector.init(config.detector);
+    
+    Gimbal gimbal;
+    gimbal.init(config.gimbal);
+    
+    // Calibrated lens: frames are undistorted first and the HUD FOV follows the model
+    Lens lens;
+    if (lens.init(config.video, config.gimbal)) {
+        gimbal.setFovModel([&lens](float zoom) { return lens.horizontalFov(zoom); });
+    }
+    
+    GimbalLink gimbalLink;
+    gimbalLink.init(config.gimbal_link, config.gimbal);
+    
+    TelemetryReceiver telemetry;
+    telemetry.init(config.telemetry);
+    
+    Scenario scenario;
+    scenario.init(config.scenario);
+    
+    Effects effects;
+    effects.init(config.effects, config.gimbal);
+    
+    Enhancer enhancer;
+    enhancer.init(config.enhance);
+    
+    TileMap tileMap;
+    if (tileMap.init(config.map)) {
+        hud.setMap(&tileMap);
+    }
+    
+    Tracker tracker;
+    tracker.init(config.tracker);
+    std::mutex trackerMutex;            // The graph's analysis stage runs on a worker
+    std::atomic<bool> trackToggleRequested{false};
+    
+    Replay replay;
+    replay.init(config.replay);
+    
+    Governor governor;
+    governor.init(config.governor, video.getFps());
+    
+    Metrics::instance().startServer(config.metrics);
+    
     // Set up joystick button callback for recording toggle
     joystick.setButtonCallback([&](int button, bool pressed) {
         if (!pressed) return;  // Only handle press, not release
@@ -141,10 +264,12 @@ int main(int argc, char* argv[]) {
         // Check button mapping
         auto it = config.joystick.button_mapping.find("record_toggle");
         if (it != config.joystick.button_mapping.end() && button == it->second) {
+            // One snapshot, so a stream switch can't mix two geometries
+            VideoFormat format = video.getFormat();
             if (recorder.isRecording()) {
                 recorder.stop();
-            } else if (video.getWidth() > 0 && video.getHeight() > 0) {
-                recorder.start(video.getWidth(), video.getHeight(), video.getFps());
+            } else if (format.width > 0 && format.height > 0) {
+                recorder.start(format.width, format.height, format.fps);
             } else {
                 std::cout << "Cannot start recording: no video source connected" << std::endl;
             }
@@ -157,6 +282,62 @@ int main(int argc, char* argv[]) {
                 takeScreenshot(frame);
             }
         }
+        
+        it = config.joystick.button_mapping.find("reset_view");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            gimbal.reset();
+        }
+        
+        // Handled in the main loop, which owns the current frame
+        it = config.joystick.button_mapping.find("track_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            trackToggleRequested = true;
+        }
+        
+        it = config.joystick.button_mapping.find("scenario_restart");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            scenario.restart();
+        }
+        
+        it = config.joystick.button_mapping.find("effects_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            effects.toggle();
+        }
+        
+        it = config.joystick.button_mapping.find("palette_cycle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            effects.cyclePalette();
+        }
+        
+        it = config.joystick.button_mapping.find("clahe_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            enhancer.toggle(EnhanceStage::Clahe);
+        }
+        
+        it = config.joystick.button_mapping.find("dehaze_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            enhancer.toggle(EnhanceStage::Dehaze);
+        }
+        
+        it = config.joystick.button_mapping.find("sharpen_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            enhancer.toggle(EnhanceStage::Sharpen);
+        }
+        
+        it = config.joystick.button_mapping.find("enhance_weaker");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            enhancer.adjustStrength(-1);
+        }
+        
+        it = config.joystick.button_mapping.find("enhance_stronger");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            enhancer.adjustStrength(1);
+        }
+        
+        it = config.joystick.button_mapping.find("replay_live");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            replay.goLive();
+        }
     });
     
     // Create display window
@@ -165,51 +346,379 @@ int main(int argc, char* argv[]) {
         cv::setWindowProperty(config.window.title, cv::WND_PROP_FULLSCREEN, cv::WINDOW_FULLSCREEN);
     }
     
+    applyThreadTopology("render");
+    
     std::cout << "\nSAR Simulator running. Press Q or ESC to quit.\n" << std::endl;
     
     cv::Mat frame;
     cv::Mat displayFrame;
+    cv::Mat replayFrame;
+    uint64_t frameSequence = 0;
+    uint64_t lastSequence = 0;
+    DetectionResult detections;
     bool fullscreen = config.window.fullscreen;
     bool hudEnabled = config.hud.enabled;
+    auto lastTick = std::chrono::steady_clock::now();
+    auto fpsStart = lastTick;
+    int fpsCount = 0;
+    
+    auto samplePlatform = [&](PlatformTelemetry& platform, double& ageMs, bool& stale, GroundPoint& groundPoint) {
+        if (!telemetry.isRunning()) return;
+        platform = telemetry.latest();
+        ageMs = telemetry.ageMs(platform);
+        stale = telemetry.isStale(platform);
+        
+        // Reported gimbal angles win over the simulated ones; FOV always follows zoom
+        if (!stale) {
+            const GimbalState& gimbalState = gimbal.getState();
+            float pan = platform.hasGimbal ? platform.gimbalPan : gimbalState.pan;
+            float tilt = platform.hasGimbal ? platform.gimbalTilt : gimbalState.tilt;
+            groundPoint = computeGroundPoint(platform, pan, tilt, gimbalState.hfov);
+        }
+    };
+    
+    // Pipelined mode: effects, analysis and HUD run as frame-graph stages on a
+    // worker pool, each on a different frame; the main thread keeps input, the
+    // recorder hand-off and display, which must stay on it
+    const bool pipelined = config.pipeline.mode == "graph";
+    FramePool framePool(pipelined ? config.pipeline.depth : 1, [] { return std::make_unique<LiveFrame>(); });
+    FrameGraph graph;
+    int graphRoot = -1;
+    if (pipelined) {
+        graphRoot = graph.addNode("lens", [&](FrameHandle& handle) {
+            LiveFrame& f = handle.as<LiveFrame>();
+            lens.undistort(f.image, f.gimbal.zoom);
+        });
+        
+        int scenarioNode = graph.addNode("scenario", [&](FrameHandle& handle) {
+            LiveFrame& f = handle.as<LiveFrame>();
+            scenario.apply(f.image, f.gimbal, f.hasPlatform && !f.platformStale ? &f.platform : nullptr,
+                           f.hasPlayback ? &f.playback : nullptr, f.sequence);
+        });
+        
+        int effectsNode = graph.addNode("effects", [&](FrameHandle& handle) {
+            LiveFrame& f = handle.as<LiveFrame>();
+            effects.apply(f.image, f.gimbal, f.groundPoint, f.sequence);
+        });
+        
+        int enhanceNode = graph.addNode("enhance", [&](FrameHandle& handle) {
+            enhancer.apply(handle->image);
+        });
+        
+        int analysis = graph.addNode("analysis", [&, latest = DetectionResult()](FrameHandle& handle) mutable {
+            LiveFrame& f = handle.as<LiveFrame>();
+            detector.submit(f.image, f.sequence);
+            detector.getResult(latest);
+            // Pooled slots keep their last result; most frames reuse the same one
+            if (f.detections.sequence != latest.sequence) {
+                f.detections = latest;
+            }
+            
+            std::lock_guard<std::mutex> lock(trackerMutex);
+            if (trackToggleRequested.exchange(false)) {
+                if (tracker.isActive()) {
+                    tracker.stop();
+                } else {
+                    tracker.start(f.image);
+                }
+            } else {
+                tracker.update(f.image);
+            }
+            f.track = tracker.getState();
+        }, &s_trackerTime);
+        
+        int hudStage = graph.addNode("hud", [&](FrameHandle& handle) {
+            LiveFrame& f = handle.as<LiveFrame>();
+            
+            // The recorder may still hold this slot's last display frame; never draw into it
+            if (f.display.u && f.display.u->refcount > 1) {
+                f.display.release();
+            }
+            f.image.copyTo(f.display);
+            
+            if (f.hudEnabled) {
+                if (detector.isRunning()) {
+                    hud.setDetections(f.detections, detector.getStats(), f.sequence);
+                }
+                hud.setTrack(f.track);
+                hud.setGimbal(f.gimbal);
+                if (f.hasPlayback) {
+                    hud.setPlayback(f.playback);
+                }
+                if (f.hasPlatform) {
+                    hud.setPlatform(f.platform, f.platformAgeMs, f.platformStale);
+                    hud.setGroundPoint(f.groundPoint);
+                }
+                hud.render(f.display, f.joystick, f.recording);
+            }
+        }, &s_hudTime);
+        
+        int output = graph.addNode("output", [&](FrameHandle& handle) {
+            LiveFrame& f = handle.as<LiveFrame>();
+            replay.push(f.image, f.sequence);
+            if (recorder.isRecording()) {
+                recorder.writeFrame(f.image, f.display);
+            }
+            
+            displayFrame = f.display;
+            if (replay.render(replayFrame, displayFrame.size())) {
+                cv::imshow(config.window.title, replayFrame);
+            } else {
+                cv::imshow(config.window.title, displayFrame);
+            }
+            s_renderedFrames.inc();
+            fpsCount++;
+        }, &s_displayTime, true);
+        
+        graph.connect(graphRoot, scenarioNode);
+        graph.connect(scenarioNode, effectsNode);
+        graph.connect(effectsNode, enhanceNode);
+        graph.connect(enhanceNode, analysis);
+        graph.connect(analysis, hudStage);
+        graph.connect(hudStage, output);
+        
+        // Default: a thread per stage, so every stage can be busy on a different frame,
+        // but no more threads than cores
+        int workers = config.pipeline.workers > 0 ? config.pipeline.workers
+                                                  : std::min(graph.workerStages(), static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+        graph.start(workers, framePool.size());
+    }
     
     // Main loop
     while (g_running) {
-        // Update joystick
-        joystick.update();
+        SAR_TRACE_SCOPE("frame");
+        auto now = std::chrono::steady_clock::now();
+        {
+            SAR_TRACE_SCOPE("input");
+            ScopedTimer timer(s_inputTime);
+            
+            // Update joystick
+            joystick.update();
+            
+            // Advance the simulated gimbal; the tracker steers it while the stick is centred
+            double dt = std::chrono::duration<double>(now - lastTick).count();
+            lastTick = now;
+            
+            const JoystickState& stick = joystick.getState();
+            float panRate = stick.getPan();
+            float tiltRate = stick.getTilt();
+            bool steering;
+            {
+                std::lock_guard<std::mutex> lock(trackerMutex);
+                steering = config.tracker.drive_gimbal && tracker.isActive() &&
+                           std::abs(panRate) < 0.05f && std::abs(tiltRate) < 0.05f;
+                if (steering) {
+                    tracker.getSteering(panRate, tiltRate);
+                }
+            }
+            gimbal.update(panRate, tiltRate, stick.connected ? stick.getZoom() : -1.0f, dt);
+            video.setZoom(gimbal.getState().zoom);
+            gimbalLink.update(gimbal.getState(), stick.connected, steering);
+            replay.update(stick.hats, dt);
+        }
+        
+        // Pipelined: start a new frame through the graph if a slot is free, then
+        // show whatever has come out of it
+        if (pipelined) {
+            FrameHandle handle = framePool.acquire();
+            if (handle) {
+                LiveFrame& f = handle.as<LiveFrame>();
+                bool fetched;
+                {
+                    SAR_TRACE_SCOPE("fetch");
+                    ScopedTimer timer(s_fetchTime);
+                    fetched = video.getFrame(f.image, frameSequence);
+                }
+                
+                // Only new source frames enter the graph
+                if (fetched && frameSequence != lastSequence) {
+                    if (lastSequence != 0 && frameSequence > lastSequence + 1) {
+                        s_skippedFrames.inc(frameSequence - lastSequence - 1);
+                    }
+                    lastSequence = frameSequence;
+                    
+                    f.sequence = frameSequence;
+                    f.captured = now;
+                    f.gimbal = gimbal.getState();
+                    f.joystick = joystick.getState();
+                    f.recording = recorder.isRecording();
+                    f.hudEnabled = hudEnabled;
+                    f.hasPlatform = telemetry.isRunning();
+                    f.platform = PlatformTelemetry();
+                    f.platformAgeMs = -1.0;
+                    f.platformStale = true;
+                    f.groundPoint = GroundPoint();
+                    samplePlatform(f.platform, f.platformAgeMs, f.platformStale, f.groundPoint);
+                    Playback* playback = video.getPlayback();
+                    f.hasPlayback = playback != nullptr;
+                    if (playback) {
+                        f.playback = playback->getStatus();
+                    }
+                    graph.submit(graphRoot, handle);
+                }
+            }
+            graph.runMainThread();
+        }
         
         // Get video frame
-        if (video.getFrame(frame)) {
-            // Clone for display (HUD overlay)
-            displayFrame = frame.clone();
+        bool haveFrame = false;
+        if (!pipelined) {
+            SAR_TRACE_SCOPE("fetch");
+            ScopedTimer timer(s_fetchTime);
+            haveFrame = video.getFrame(frame, frameSequence);
+        }
+        
+        if (haveFrame) {
+            bool newFrame = frameSequence != lastSequence;
+            if (!newFrame) {
+                s_duplicateFrames.inc();
+            } else if (lastSequence != 0 && frameSequence > lastSequence + 1) {
+                s_skippedFrames.inc(frameSequence - lastSequence - 1);
+            }
+            lastSequence = frameSequence;
+            
+            // Platform pose and where the crosshair meets the ground, for effects and HUD
+            PlatformTelemetry platform;
+            double platformAgeMs = -1.0;
+            bool platformStale = true;
+            GroundPoint groundPoint;
+            samplePlatform(platform, platformAgeMs, platformStale, groundPoint);
+            
+            // What the stages behind each sheddable step cost this frame
+            GovernorCosts governorCosts;
             
-            // Render HUD if enabled
-            if (hudEnabled) {
-                hud.render(displayFrame, joystick.getState(), recorder.isRecording());
+            // Undistort, plant the scenario's targets, then the simulated sensor:
+            // everything downstream sees the degraded image
+            lens.undistort(frame, gimbal.getState().zoom);
+            if (scenario.isActive()) {
+                Playback* playback = video.getPlayback();
+                PlaybackStatus playbackStatus = playback ? playback->getStatus() : PlaybackStatus();
+                scenario.apply(frame, gimbal.getState(), telemetry.isRunning() && !platformStale ? &platform : nullptr,
+                               playback ? &playbackStatus : nullptr, frameSequence);
+            }
+            {
+                GovernorTimer cost(governorCosts, GovernorStep::Effects);
+                effects.apply(frame, gimbal.getState(), groundPoint, frameSequence);
+            }
+            enhancer.apply(frame);
+            if (newFrame) {
+                replay.push(frame, frameSequence);
+            }
+            
+            // Hand the frame to the detector (non-blocking, decimated internally)
+            {
+                SAR_TRACE_SCOPE("detector.submit");
+                GovernorTimer cost(governorCosts, GovernorStep::Detector);
+                detector.submit(frame, frameSequence);
+                detector.getResult(detections);
             }
             
-            // Record frame (with or without HUD based on config)
+            {
+                SAR_TRACE_SCOPE("tracker");
+                ScopedTimer timer(s_trackerTime);
+                if (trackToggleRequested) {
+                    trackToggleRequested = false;
+                    if (tracker.isActive()) {
+                        tracker.stop();
+                    } else {
+                        tracker.start(frame);
+                    }
+                } else if (newFrame) {
+                    tracker.update(frame);
+                }
+            }
+            
+            {
+                SAR_TRACE_SCOPE("hud");
+                ScopedTimer timer(s_hudTime);
+                
+                // Clone for display (HUD overlay); when shedding resolution the
+                // downscale is the copy, and the window scales it back up
+                const double renderScale = governor.state().renderScale;
+                {
+                    GovernorTimer cost(governorCosts, GovernorStep::Resolution);
+                    if (renderScale < 1.0) {
+                        cv::resize(frame, displayFrame, cv::Size(), renderScale, renderScale, cv::INTER_AREA);
+                    } else {
+                        displayFrame = frame.clone();
+                    }
+                }
+                
+                // Render HUD if enabled
+                if (hudEnabled) {
+                    GovernorTimer cost(governorCosts, GovernorStep::HudRate);
+                    if (detector.isRunning()) {
+                        hud.setDetections(detections, detector.getStats(), frameSequence);
+                    }
+                    hud.setTrack(tracker.getState());
+                    hud.setGimbal(gimbal.getState());
+                    if (Playback* playback = video.getPlayback()) {
+                        hud.setPlayback(playback->getStatus());
+                    }
+                    if (telemetry.isRunning()) {
+                        hud.setPlatform(platform, platformAgeMs, platformStale);
+                        hud.setGroundPoint(groundPoint);
+                    }
+                    hud.render(displayFrame, joystick.getState(), recorder.isRecording());
+                }
+            }
+            
+            // Queue the clean and HUD frames; the recorder's streams pick theirs
             if (recorder.isRecording()) {
-                if (config.recording.include_hud) {
-                    recorder.writeFrame(displayFrame);
+                recorder.writeFrame(frame, displayFrame);
+            }
+            
+            // Display
+            {
+                SAR_TRACE_SCOPE("display");
+                ScopedTimer timer(s_displayTime);
+                GovernorTimer cost(governorCosts, GovernorStep::Resolution);
+                
+                // Replay replaces only what is shown; recording above stays live
+                if (replay.render(replayFrame, displayFrame.size())) {
+                    cv::imshow(config.window.title, replayFrame);
                 } else {
-                    recorder.writeFrame(frame);
+                    cv::imshow(config.window.title, displayFrame);
                 }
             }
+            s_renderedFrames.inc();
+            fpsCount++;
             
-            // Display
-            cv::imshow(config.window.title, displayFrame);
+            // Everything this frame cost before the event wait, against the frame budget
+            double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+            governor.update(frameMs, governorCosts);
+            const GovernorState& shed = governor.state();
+            detector.setThrottle(shed.detectorThrottle);
+            effects.setReduced(shed.reducedEffects);
+            hud.setGovernor(shed);
         }
         
-        // Handle keyboard
-        int key = cv::waitKey(1) & 0xFF;
+        double fpsElapsed = std::chrono::duration<double>(now - fpsStart).count();
+        if (fpsElapsed >= 1.0) {
+            s_renderFps.set(fpsCount / fpsElapsed);
+            fpsCount = 0;
+            fpsStart = now;
+        }
+        
+        // Handle keyboard (waitKey also pumps the HighGUI event loop)
+        int key;
+        {
+            SAR_TRACE_SCOPE("events");
+            key = cv::waitKey(1) & 0xFF;
+        }
+        
+        if (Trace::takeFlushRequest()) {
+            Trace::flush();
+        }
         
         if (key == 'q' || key == 'Q' || key == 27) {  // Q or ESC
             g_running = false;
         } else if (key == 'r' || key == 'R') {
+            VideoFormat format = video.getFormat();
             if (recorder.isRecording()) {
                 recorder.stop();
-            } else if (video.getWidth() > 0 && video.getHeight() > 0) {
-                recorder.start(video.getWidth(), video.getHeight(), video.getFps());
+            } else if (format.width > 0 && format.height > 0) {
+                recorder.start(format.width, format.height, format.fps);
             } else {
                 std::cout << "Cannot start recording: no video source connected" << std::endl;
             }
@@ -224,6 +733,41 @@ int main(int argc, char* argv[]) {
             if (!displayFrame.empty()) {
                 takeScreenshot(displayFrame);
             }
+        } else if (key == 't' || key == 'T') {
+            trackToggleRequested = true;
+        } else if (key == 'e' || key == 'E') {
+            effects.toggle();
+        } else if (key == 'g' || key == 'G') {
+            scenario.restart();
+        } else if (key == 'i' || key == 'I') {
+            effects.cyclePalette();
+        } else if (key == 'c' || key == 'C') {
+            enhancer.toggle(EnhanceStage::Clahe);
+        } else if (key == 'd' || key == 'D') {
+            enhancer.toggle(EnhanceStage::Dehaze);
+        } else if (key == 'u' || key == 'U') {
+            enhancer.toggle(EnhanceStage::Sharpen);
+        } else if (key == '-' || key == '=' || key == '+') {
+            enhancer.adjustStrength(key == '-' ? -1 : 1);
+        } else if (key == 'b' || key == 'B' || key == 'n' || key == 'N') {
+            replay.step(key == 'b' || key == 'B' ? -1 : 1);
+        } else if (key == 'l' || key == 'L') {
+            replay.goLive();
+        } else if (key == 'p' || key == 'P') {
+            if (Trace::enabled()) {
+                Trace::flush();
+            } else {
+                std::cout << "Tracing is disabled (set trace.enabled in config)" << std::endl;
+            }
+        } else if (Playback* playback = video.getPlayback()) {
+            if (key == ' ') {
+                playback->togglePause();
+            } else if (key == ',' || key == '.') {
+                playback->seekRelative(key == ',' ? -config.playback.seek_step : config.playback.seek_step);
+            } else if (key == '[' || key == ']') {
+                playback->setSpeed(playback->getStatus().speed * (key == '[' ? 0.5 : 2.0));
+                std::cout << "Playback speed " << playback->getStatus().speed << "x" << std::endl;
+            }
         }
         
         // Check if window was closed
@@ -235,9 +779,19 @@ int main(int argc, char* argv[]) {
     // Cleanup
     std::cout << "\nShutting down..." << std::endl;
     
+    Metrics::instance().stopServer();
+    graph.stop();
     recorder.stop();
+    detector.shutdown();
+    lens.shutdown();
+    scenario.shutdown();
+    gimbalLink.shutdown();
+    telemetry.shutdown();
+    tileMap.shutdown();
+    replay.shutdown();
     video.shutdown();
     joystick.shutdown();
+    Trace::flush();
     
     cv::destroyAllWindows();
     SDL_Quit();
@@ -0,0 +1,261 @@
+#include "metrics.h"
+#include "net.h"
+#include "threads.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+namespace sar {
+
+#ifdef MSG_NOSIGNAL
+static constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int kSendFlags = 0;
+#endif
+
+Histogram::Histogram(std::vector<double> bounds)
+    : m_bounds(std::move(bounds)),
+      m_buckets(new std::atomic<uint64_t>[m_bounds.size() + 1]) {
+    std::sort(m_bounds.begin(), m_bounds.end());
+    for (size_t i = 0; i <= m_bounds.size(); i++) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::observe(double v) {
+    size_t i = std::lower_bound(m_bounds.begin(), m_bounds.end(), v) - m_bounds.begin();
+    m_buckets[i].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    
+    double sum = m_sum.load(std::memory_order_relaxed);
+    while (!m_sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {
+    }
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::~Metrics() {
+    stopServer();
+}
+
+std::vector<double> Metrics::defaultTimingBounds() {
+    return {0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.033, 0.066, 0.1, 0.25, 1.0};
+}
+
+Metrics::Entry& Metrics::add(Type type, const std::string& name, const std::string& help,
+                             const std::string& labels) {
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    m_entries.emplace_back();
+    Entry& entry = m_entries.back();
+    entry.type = type;
+    entry.name = name;
+    entry.help = help;
+    entry.labels = labels;
+    return entry;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    auto metric = std::make_unique<Counter>();
+    Counter& ref = *metric;
+    add(Type::Counter, name, help, labels).counter = std::move(metric);
+    return ref;
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    auto metric = std::make_unique<Gauge>();
+    Gauge& ref = *metric;
+    add(Type::Gauge, name, help, labels).gauge = std::move(metric);
+    return ref;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                              std::vector<double> bounds) {
+    auto metric = std::make_unique<Histogram>(std::move(bounds));
+    Histogram& ref = *metric;
+    add(Type::Histogram, name, help, labels).histogram = std::move(metric);
+    return ref;
+}
+
+Histogram& Metrics::stage(const std::string& stage) {
+    return histogram("sar_stage_duration_seconds", "Per-frame time spent in each pipeline stage",
+                     "stage=\"" + stage + "\"");
+}
+
+static std::string labelSet(const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return "";
+    if (labels.empty()) return "{" + extra + "}";
+    if (extra.empty()) return "{" + labels + "}";
+    return "{" + labels + "," + extra + "}";
+}
+
+std::string Metrics::render() const {
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    
+    // Group series of the same family under one HELP/TYPE header
+    std::vector<const Entry*> sorted;
+    sorted.reserve(m_entries.size());
+    for (const auto& entry : m_entries) {
+        sorted.push_back(&entry);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Entry* a, const Entry* b) { return a->name < b->name; });
+    
+    std::ostringstream out;
+    std::string family;
+    for (const Entry* e : sorted) {
+        if (e->name != family) {
+            family = e->name;
+            const char* type = e->type == Type::Counter ? "counter"
+                             : e->type == Type::Gauge ? "gauge" : "histogram";
+            out << "# HELP " << e->name << " " << e->help << "\n";
+            out << "# TYPE " << e->name << " " << type << "\n";
+        }
+        
+        switch (e->type) {
+            case Type::Counter:
+                out << e->name << labelSet(e->labels) << " " << e->counter->value() << "\n";
+                break;
+                
+            case Type::Gauge:
+                out << e->name << labelSet(e->labels) << " " << e->gauge->value() << "\n";
+                break;
+                
+            case Type::Histogram: {
+                const Histogram& h = *e->histogram;
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i < h.bounds().size(); i++) {
+                    cumulative += h.bucketCount(i);
+                    std::ostringstream le;
+                    le << "le=\"" << h.bounds()[i] << "\"";
+                    out << e->name << "_bucket" << labelSet(e->labels, le.str()) << " " << cumulative << "\n";
+                }
+                cumulative += h.bucketCount(h.bounds().size());
+                out << e->name << "_bucket" << labelSet(e->labels, "le=\"+Inf\"") << " " << cumulative << "\n";
+                out << e->name << "_sum" << labelSet(e->labels) << " " << h.sum() << "\n";
+                out << e->name << "_count" << labelSet(e->labels) << " " << h.count() << "\n";
+                break;
+            }
+        }
+    }
+    
+    return out.str();
+}
+
+bool Metrics::startServer(const MetricsConfig& config) {
+    m_config = config;
+    if (!m_config.enabled || m_serverRunning) return false;
+    
+    if (!netInit()) {
+        std::cerr << "Metrics: socket initialisation failed" << std::endl;
+        return false;
+    }
+    
+    sockaddr_in addr;
+    if (!makeAddress(m_config.bind, m_config.port, addr)) {
+        std::cerr << "Metrics: invalid bind address " << m_config.bind << std::endl;
+        return false;
+    }
+    
+    // Unauthenticated; exposing it beyond this machine has to be asked for
+    const bool loopback = (ntohl(addr.sin_addr.s_addr) >> 24) == 127;
+    if (!loopback && !m_config.allow_remote) {
+        std::cerr << "Metrics: refusing to bind " << m_config.bind
+                  << " without \"allow_remote\": true; use 127.0.0.1 for local scrapes" << std::endl;
+        return false;
+    }
+    
+    SocketHandle sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == kInvalidSocket) {
+        std::cerr << "Metrics: could not create socket" << std::endl;
+        return false;
+    }
+    
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    
+    if (bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(sock, 4) != 0) {
+        std::cerr << "Metrics: could not listen on " << m_config.bind << ":" << m_config.port << std::endl;
+        closeSocket(sock);
+        return false;
+    }
+    
+    m_listenSocket = static_cast<intptr_t>(sock);
+    m_serverRunning = true;
+    m_serverThread = std::thread(&Metrics::serverThread, this);
+    
+    std::cout << "Metrics: serving http://" << m_config.bind << ":" << m_config.port << "/metrics" << std::endl;
+    return true;
+}
+
+void Metrics::stopServer() {
+    m_serverRunning = false;
+    
+    if (m_serverThread.joinable()) {
+        m_serverThread.join();
+    }
+    
+    if (m_listenSocket != -1) {
+        closeSocket(static_cast<SocketHandle>(m_listenSocket));
+        m_listenSocket = -1;
+    }
+}
+
+void Metrics::serverThread() {
+    applyThreadTopology("metrics");
+    
+    SocketHandle listenSock = static_cast<SocketHandle>(m_listenSocket);
+    char request[2048];
+    
+    while (m_serverRunning) {
+        // Poll so shutdown is noticed without closing the socket under accept()
+        if (!waitReadable(listenSock, 200)) continue;
+        
+        SocketHandle client = accept(listenSock, nullptr, nullptr);
+        if (client == kInvalidSocket) continue;
+        
+        // Read the request line; headers and body are ignored
+        int received = 0;
+        if (waitReadable(client, 500)) {
+            received = static_cast<int>(recv(client, request, sizeof(request) - 1, 0));
+        }
+        
+        std::string status = "200 OK";
+        std::string body;
+        if (received > 0) {
+            request[received] = '\0';
+            bool metricsPath = std::strncmp(request, "GET /metrics", 12) == 0 ||
+                               std::strncmp(request, "GET / ", 6) == 0;
+            if (metricsPath) {
+                body = render();
+            } else {
+                status = "404 Not Found";
+                body = "Not found\n";
+            }
+        } else {
+            status = "400 Bad Request";
+        }
+        
+        std::ostringstream response;
+        response << "HTTP/1.1 " << status << "\r\n"
+                 << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n"
+                 << body;
+        
+        const std::string data = response.str();
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int n = static_cast<int>(send(client, data.data() + sent, static_cast<int>(data.size() - sent), kSendFlags));
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        
+        closeSocket(client);
+    }
+}
+
+} // namespace sar
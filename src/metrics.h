@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+// Metric primitives are plain atomics: hot paths update them with relaxed stores and
+// never touch the registry. The registry lock is only taken to register (at startup)
+// and by the scrape thread, so a scrape can never stall capture or render.
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+    
+private:
+    std::atomic<uint64_t> m_value{0};
+};
+
+class Gauge {
+public:
+    void set(double v) { m_value.store(v, std::memory_order_relaxed); }
+    double value() const { return m_value.load(std::memory_order_relaxed); }
+    
+private:
+    std::atomic<double> m_value{0.0};
+};
+
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+    
+    void observe(double v);
+    
+    const std::vector<double>& bounds() const { return m_bounds; }
+    uint64_t bucketCount(size_t i) const { return m_buckets[i].load(std::memory_order_relaxed); }
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    double sum() const { return m_sum.load(std::memory_order_relaxed); }
+    
+private:
+    std::vector<double> m_bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> m_buckets;  // Non-cumulative, +Inf last
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<double> m_sum{0.0};
+};
+
+// Records the lifetime of the scope into a histogram, in seconds
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram)
+        : m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        m_histogram.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count());
+    }
+    
+private:
+    Histogram& m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+class Metrics {
+public:
+    static Metrics& instance();
+    
+    // Registration returns a reference that stays valid for the process lifetime.
+    // labels is an optional Prometheus label set without braces, e.g. stage="hud".
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "",
+                         std::vector<double> bounds = defaultTimingBounds());
+    
+    // Per-stage frame timing histogram: sar_stage_duration_seconds{stage="<stage>"}
+    Histogram& stage(const std::string& stage);
+    
+    // Prometheus text exposition format (version 0.0.4)
+    std::string render() const;
+    
+    bool startServer(const MetricsConfig& config);
+    void stopServer();
+    
+    static std::vector<double> defaultTimingBounds();
+    
+private:
+    Metrics() = default;
+    ~Metrics();
+    
+    void serverThread();
+    
+    enum class Type { Counter, Gauge, Histogram };
+    
+    struct Entry {
+        Type type;
+        std::string name;
+        std::string help;
+        std::string labels;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+    
+    Entry& add(Type type, const std::string& name, const std::string& help, const std::string& labels);
+    
+    mutable std::mutex m_registryMutex;
+    std::deque<Entry> m_entries;
+    
+    MetricsConfig m_config;
+    std::thread m_serverThread;
+    std::atomic<bool> m_serverRunning{false};
+    intptr_t m_listenSocket = -1;
+};
+
+} // namespace sar
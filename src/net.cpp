@@ -0,0 +1,60 @@
+#include "net.h"
+#include <cstring>
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+namespace sar {
+
+bool netInit() {
+#ifdef _WIN32
+    static bool initialized = false;
+    if (!initialized) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            return false;
+        }
+        initialized = true;
+    }
+#endif
+    return true;
+}
+
+void closeSocket(SocketHandle socket) {
+    if (socket == kInvalidSocket) return;
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool makeAddress(const std::string& host, int port, sockaddr_in& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    return inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1;
+}
+
+bool waitReadable(SocketHandle socket, int timeoutMs) {
+#ifdef _WIN32
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(socket, &set);
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    return select(0, &set, nullptr, nullptr, &tv) > 0;
+#else
+    pollfd pfd{};
+    pfd.fd = socket;
+    pfd.events = POLLIN;
+    return poll(&pfd, 1, timeoutMs) > 0;
+#endif
+}
+
+} // namespace sar
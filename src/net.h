@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+namespace sar {
+
+// Minimal cross-platform socket helpers shared by the network modules
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+static constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+static constexpr SocketHandle kInvalidSocket = -1;
+#endif
+
+bool netInit();
+void closeSocket(SocketHandle socket);
+
+// Fills addr from a dotted IPv4 address and port; returns false if the address is invalid
+bool makeAddress(const std::string& host, int port, sockaddr_in& addr);
+
+// Waits up to timeoutMs for the socket to become readable
+bool waitReadable(SocketHandle socket, int timeoutMs);
+
+} // namespace sar
@@ -0,0 +1,413 @@
+#include "parallel_encoder.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#ifdef SAR_HAVE_FFMPEG
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/dict.h>
+}
+#endif
+
+namespace sar {
+
+ParallelEncoder::ParallelEncoder() {}
+
+ParallelEncoder::~ParallelEncoder() {
+    release();
+}
+
+#ifdef SAR_HAVE_FFMPEG
+
+static Counter& s_encoded = Metrics::instance().counter(
+    "sar_recorder_encoded_frames_total", "Frames encoded by the GOP-parallel recording encoder");
+static Gauge& s_encodeFps = Metrics::instance().gauge(
+    "sar_recorder_encode_fps", "Frames per second encoded by the GOP-parallel encoder, all streams");
+static Gauge& s_buffered = Metrics::instance().gauge(
+    "sar_recorder_encoder_buffered_frames", "Frames queued on GOPs and not yet encoded");
+static Histogram& s_encodeTime = Metrics::instance().stage("encode");
+
+// The encode-rate gauge sums every open encoder; whichever muxer gets there first
+// each second samples the shared counter
+static void sampleEncodeRate() {
+    static std::mutex mutex;
+    static auto last = std::chrono::steady_clock::now();
+    static uint64_t lastCount = 0;
+    
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - last).count();
+    if (elapsed < 1.0) return;
+    uint64_t count = s_encoded.value();
+    s_encodeFps.set((count - lastCount) / elapsed);
+    lastCount = count;
+    last = now;
+}
+
+ParallelEncoder::Gop::~Gop() {
+    for (AVPacket* packet : packets) {
+        av_packet_free(&packet);
+    }
+    avcodec_parameters_free(&params);
+}
+
+bool ParallelEncoder::available() {
+    return true;
+}
+
+bool ParallelEncoder::open(const std::string& filename, double fps, cv::Size size, const RecordingConfig& config) {
+    release();
+    m_config = config;
+    m_filename = filename;
+    
+    // 4:2:0 needs even dimensions; an odd frame loses its last row or column
+    m_size = cv::Size(size.width & ~1, size.height & ~1);
+    if (m_size.width <= 0 || m_size.height <= 0 || fps <= 0) return false;
+    
+    if (!avcodec_find_encoder_by_name(m_config.encoder_codec.c_str())) {
+        std::cerr << "Parallel encoder: codec '" << m_config.encoder_codec << "' not available in this FFmpeg build" << std::endl;
+        return false;
+    }
+    
+    AVRational rate = av_d2q(fps, 100000);
+    m_rateNum = rate.num;
+    m_rateDen = rate.den;
+    m_gopFrames = std::max<int64_t>(1, std::llround(std::max(0.1, m_config.encoder_gop_seconds) * fps));
+    
+    if (avformat_alloc_output_context2(&m_format, nullptr, nullptr, m_filename.c_str()) < 0 || !m_format) {
+        std::cerr << "Parallel encoder: no muxer for " << m_filename << std::endl;
+        m_format = nullptr;
+        return false;
+    }
+    m_globalHeader = (m_format->oformat->flags & AVFMT_GLOBALHEADER) != 0;
+    m_headerWritten = false;
+    m_writeFailed = false;
+    
+    m_gops.clear();
+    m_current.reset();
+    m_nextFrame = 0;
+    m_buffered = 0;
+    m_stopping = false;
+    m_encodedFrames = 0;
+    m_busyMicros = 0;
+    m_startTime = std::chrono::steady_clock::now();
+    
+    int workers = m_config.encoder_workers > 0
+        ? m_config.encoder_workers
+        : std::max(2, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back(&ParallelEncoder::workerThread, this);
+    }
+    m_muxer = std::thread(&ParallelEncoder::muxerThread, this);
+    m_opened = true;
+    
+    std::cout << "Parallel encoder: " << m_config.encoder_codec << " " << m_config.encoder_preset
+              << " crf " << m_config.encoder_crf << ", " << workers << " GOP workers x "
+              << m_config.encoder_threads << " threads, " << m_gopFrames << "-frame GOPs" << std::endl;
+    return true;
+}
+
+bool ParallelEncoder::write(const cv::Mat& frame) {
+    if (!m_opened || frame.empty()) return false;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_buffered >= std::max(1, m_config.encoder_buffer_frames)) {
+            return false;
+        }
+    }
+    
+    // Convert outside the lock; encoders only ever see I420
+    cv::Mat yuv;
+    {
+        SAR_TRACE_SCOPE("encoder.convert");
+        const cv::Mat source = frame.size() == m_size ? frame : frame(cv::Rect(0, 0, m_size.width, m_size.height));
+        cv::cvtColor(source, yuv, cv::COLOR_BGR2YUV_I420);
+    }
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_current) {
+        m_current = std::make_shared<Gop>();
+        m_current->firstFrame = m_nextFrame;
+        m_gops.push_back(m_current);
+    }
+    m_current->frames.push_back(std::move(yuv));
+    m_nextFrame++;
+    m_buffered++;
+    if (++m_current->frameCount >= m_gopFrames) {
+        m_current->closed = true;
+        m_current.reset();
+    }
+    s_buffered.set(m_buffered);
+    m_workReady.notify_all();
+    return true;
+}
+
+void ParallelEncoder::release() {
+    if (!m_opened) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_current) {
+            m_current->closed = true;
+            m_current.reset();
+        }
+        m_stopping = true;
+    }
+    m_workReady.notify_all();
+    m_gopEncoded.notify_all();
+    
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_gopEncoded.notify_all();
+    if (m_muxer.joinable()) {
+        m_muxer.join();
+    }
+    
+    if (m_headerWritten) {
+        av_write_trailer(m_format);
+    }
+    if (!(m_format->oformat->flags & AVFMT_NOFILE)) {
+        avio_closep(&m_format->pb);
+    }
+    avformat_free_context(m_format);
+    m_format = nullptr;
+    m_opened = false;
+    s_buffered.set(0);
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+    double busy = m_busyMicros.load() / 1e6;
+    uint64_t frames = m_encodedFrames.load();
+    std::cout << "Parallel encoder: " << m_filename << " " << frames << " frames in " << seconds << " s ("
+              << (seconds > 0 ? frames / seconds : 0.0) << " fps); encoders busy " << busy << " s ("
+              << (busy > 0 ? frames / busy : 0.0) << " fps per GOP worker)" << std::endl;
+}
+
+void ParallelEncoder::workerThread() {
+    applyThreadTopology("encoder");
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        // Oldest GOP nobody owns yet; the open one is claimed as soon as it exists
+        std::shared_ptr<Gop> gop;
+        m_workReady.wait(lock, [&] {
+            for (const auto& candidate : m_gops) {
+                if (!candidate->claimed) {
+                    gop = candidate;
+                    return true;
+                }
+            }
+            return m_stopping;
+        });
+        if (!gop) break;    // Stopping and every GOP is owned
+        
+        gop->claimed = true;
+        encodeGop(*gop, lock);
+        gop->encoded = true;
+        m_gopEncoded.notify_all();
+    }
+}
+
+void ParallelEncoder::encodeGop(Gop& gop, std::unique_lock<std::mutex>& lock) {
+    lock.unlock();
+    
+    // A fresh encoder per GOP: every GOP opens with an IDR and references nothing
+    // outside itself, so GOPs can be encoded in any order and concatenated
+    const AVCodec* codec = avcodec_find_encoder_by_name(m_config.encoder_codec.c_str());
+    AVCodecContext* context = codec ? avcodec_alloc_context3(codec) : nullptr;
+    bool ok = context != nullptr;
+    if (ok) {
+        context->width = m_size.width;
+        context->height = m_size.height;
+        context->pix_fmt = AV_PIX_FMT_YUV420P;
+        context->time_base = AVRational{m_rateDen, m_rateNum};
+        context->framerate = AVRational{m_rateNum, m_rateDen};
+        context->gop_size = static_cast<int>(m_gopFrames);
+        context->thread_count = std::max(1, m_config.encoder_threads);
+        context->flags |= AV_CODEC_FLAG_CLOSED_GOP;
+        if (m_globalHeader) context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        
+        AVDictionary* options = nullptr;
+        av_dict_set(&options, "preset", m_config.encoder_preset.c_str(), 0);
+        av_dict_set(&options, "crf", std::to_string(m_config.encoder_crf).c_str(), 0);
+        ok = avcodec_open2(context, codec, &options) >= 0;
+        av_dict_free(&options);
+        
+        if (ok) {
+            gop.params = avcodec_parameters_alloc();
+            ok = gop.params && avcodec_parameters_from_context(gop.params, context) >= 0;
+        }
+    }
+    if (!ok) {
+        std::cerr << "Parallel encoder: could not open " << m_config.encoder_codec << " for GOP at frame "
+                  << gop.firstFrame << std::endl;
+    }
+    
+    AVFrame* picture = av_frame_alloc();
+    AVPacket* packet = av_packet_alloc();
+    auto drain = [&] {
+        while (avcodec_receive_packet(context, packet) == 0) {
+            gop.packets.push_back(packet);
+            packet = av_packet_alloc();
+        }
+    };
+    
+    int64_t index = 0;
+    lock.lock();
+    while (true) {
+        m_workReady.wait(lock, [&] { return !gop.frames.empty() || gop.closed; });
+        if (gop.frames.empty()) break;      // Closed and drained
+        cv::Mat yuv = std::move(gop.frames.front());
+        gop.frames.pop_front();
+        m_buffered--;
+        s_buffered.set(m_buffered);
+        lock.unlock();
+        
+        if (ok) {
+            SAR_TRACE_SCOPE("encoder.frame");
+            ScopedTimer timer(s_encodeTime);
+            auto start = std::chrono::steady_clock::now();
+            
+            // Planes point into the Mat; the encoder copies unreferenced frames it keeps
+            const int area = m_size.width * m_size.height;
+            picture->format = AV_PIX_FMT_YUV420P;
+            picture->width = m_size.width;
+            picture->height = m_size.height;
+            picture->data[0] = yuv.data;
+            picture->data[1] = yuv.data + area;
+            picture->data[2] = yuv.data + area + area / 4;
+            picture->linesize[0] = m_size.width;
+            picture->linesize[1] = m_size.width / 2;
+            picture->linesize[2] = m_size.width / 2;
+            picture->pts = index++;
+            ok = avcodec_send_frame(context, picture) >= 0;
+            drain();
+            
+            m_busyMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            m_encodedFrames++;
+            s_encoded.inc();
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    
+    if (ok) {
+        SAR_TRACE_SCOPE("encoder.flush");
+        avcodec_send_frame(context, nullptr);
+        drain();
+    }
+    gop.failed = !ok;
+    av_packet_free(&packet);
+    av_frame_free(&picture);
+    avcodec_free_context(&context);
+    
+    lock.lock();
+}
+
+void ParallelEncoder::muxerThread() {
+    applyThreadTopology("recorder_io");
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_gopEncoded.wait_for(lock, std::chrono::seconds(1), [&] {
+            return (!m_gops.empty() && m_gops.front()->encoded) || (m_stopping && m_gops.empty());
+        });
+        sampleEncodeRate();
+        
+        if (m_gops.empty()) {
+            if (m_stopping) break;
+            continue;
+        }
+        if (!m_gops.front()->encoded) continue;
+        
+        // Strictly in order: a later GOP finishing first waits here
+        std::shared_ptr<Gop> gop = std::move(m_gops.front());
+        m_gops.pop_front();
+        lock.unlock();
+        writeGop(*gop);
+        gop.reset();
+        lock.lock();
+    }
+}
+
+bool ParallelEncoder::writeGop(Gop& gop) {
+    if (gop.failed || m_writeFailed || gop.packets.empty()) return false;
+    
+    SAR_TRACE_SCOPE("encoder.mux");
+    const AVRational timeBase{m_rateDen, m_rateNum};
+    
+    // Every GOP's encoder has identical settings, so the first one's headers serve the file
+    if (!m_headerWritten) {
+        AVStream* stream = avformat_new_stream(m_format, nullptr);
+        bool ok = stream && avcodec_parameters_copy(stream->codecpar, gop.params) >= 0;
+        if (ok) {
+            stream->time_base = timeBase;
+            if (!(m_format->oformat->flags & AVFMT_NOFILE)) {
+                ok = avio_open(&m_format->pb, m_filename.c_str(), AVIO_FLAG_WRITE) >= 0;
+            }
+        }
+        ok = ok && avformat_write_header(m_format, nullptr) >= 0;
+        if (!ok) {
+            std::cerr << "Parallel encoder: could not start " << m_filename << std::endl;
+            m_writeFailed = true;
+            return false;
+        }
+        m_headerWritten = true;
+    }
+    
+    // Shift GOP-local timestamps to the GOP's place in the file; with the same
+    // reorder delay in every GOP, DTS stays monotonic across the joins
+    AVStream* stream = m_format->streams[0];
+    for (AVPacket* packet : gop.packets) {
+        if (packet->pts != AV_NOPTS_VALUE) packet->pts += gop.firstFrame;
+        if (packet->dts != AV_NOPTS_VALUE) packet->dts += gop.firstFrame;
+        av_packet_rescale_ts(packet, timeBase, stream->time_base);
+        packet->stream_index = stream->index;
+        if (av_write_frame(m_format, packet) < 0) {
+            std::cerr << "Parallel encoder: write failed for " << m_filename << std::endl;
+            m_writeFailed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+#else
+
+ParallelEncoder::Gop::~Gop() {}
+
+bool ParallelEncoder::available() {
+    return false;
+}
+
+bool ParallelEncoder::open(const std::string&, double, cv::Size, const RecordingConfig&) {
+    return false;
+}
+
+bool ParallelEncoder::write(const cv::Mat&) {
+    return false;
+}
+
+void ParallelEncoder::release() {}
+
+void ParallelEncoder::workerThread() {}
+
+void ParallelEncoder::encodeGop(Gop&, std::unique_lock<std::mutex>&) {}
+
+void ParallelEncoder::muxerThread() {}
+
+bool ParallelEncoder::writeGop(Gop&) {
+    return false;
+}
+
+#endif
+
+} // namespace sar
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+// libav types stay opaque here so only parallel_encoder.cpp needs FFmpeg headers
+struct AVFormatContext;
+struct AVCodecParameters;
+struct AVPacket;
+
+namespace sar {
+
+// GOP-parallel H.264/H.265 encoder for one output file. Frames are cut into closed
+// GOPs of encoder_gop_seconds; each GOP gets a fresh libav encoder on one of the
+// encoder_workers threads, so consecutive GOPs encode concurrently, and a muxer
+// thread appends finished GOPs to the file strictly in order with continuous
+// timestamps. Built only with FFmpeg (SAR_HAVE_FFMPEG); otherwise open() fails and
+// the recorder keeps cv::VideoWriter.
+class ParallelEncoder {
+public:
+    ParallelEncoder();
+    ~ParallelEncoder();
+    ParallelEncoder(const ParallelEncoder&) = delete;
+    ParallelEncoder& operator=(const ParallelEncoder&) = delete;
+    
+    static bool available();
+    
+    bool open(const std::string& filename, double fps, cv::Size size, const RecordingConfig& config);
+    
+    // Single producer. Converts to I420 and queues the frame on the open GOP; false
+    // (frame dropped) while encoder_buffer_frames are already waiting for encoders
+    bool write(const cv::Mat& frame);
+    
+    // Finishes every GOP, then writes the trailer and closes the file
+    void release();
+    
+    bool isOpened() const { return m_opened; }
+    
+private:
+    struct Gop {
+        ~Gop();
+        
+        int64_t firstFrame = 0;             // Position of the GOP's first frame in the file
+        int64_t frameCount = 0;             // Frames queued so far
+        std::deque<cv::Mat> frames;         // I420, waiting for the encoder
+        bool closed = false;                // Complete; no more frames will be added
+        bool claimed = false;               // A worker owns it
+        bool encoded = false;               // Packets final; ready for the muxer
+        bool failed = false;
+        std::vector<AVPacket*> packets;     // Timestamps relative to firstFrame
+        AVCodecParameters* params = nullptr;
+    };
+    
+    void workerThread();
+    void encodeGop(Gop& gop, std::unique_lock<std::mutex>& lock);
+    void muxerThread();
+    bool writeGop(Gop& gop);
+    
+    RecordingConfig m_config;
+    std::string m_filename;
+    cv::Size m_size;
+    int m_rateNum = 30;                     // Frame rate as a fraction; the time base is its inverse
+    int m_rateDen = 1;
+    int64_t m_gopFrames = 30;
+    bool m_opened = false;
+    
+    std::vector<std::thread> m_workers;
+    std::thread m_muxer;
+    
+    std::mutex m_mutex;
+    std::condition_variable m_workReady;    // Workers: a GOP to claim or frames to encode
+    std::condition_variable m_gopEncoded;   // Muxer: the oldest GOP may be done
+    std::deque<std::shared_ptr<Gop>> m_gops;    // File order; the muxer pops the front
+    std::shared_ptr<Gop> m_current;         // GOP receiving frames
+    int64_t m_nextFrame = 0;
+    int m_buffered = 0;                     // Queued frames not yet encoded
+    bool m_stopping = false;
+    
+    // Muxer-owned output
+    AVFormatContext* m_format = nullptr;
+    bool m_headerWritten = false;
+    bool m_globalHeader = false;
+    bool m_writeFailed = false;
+    
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<uint64_t> m_encodedFrames{0};
+    std::atomic<int64_t> m_busyMicros{0};   // Summed worker time spent inside the encoder
+};
+
+} // namespace sar
@@ -0,0 +1,440 @@
+#include "playback.h"
+#include "mapped_file.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace sar {
+
+static constexpr double kMinSpeed = 0.25;
+static constexpr double kMaxSpeed = 8.0;
+
+// Poll interval for noticing a seek or shutdown while stopped at the end of a file
+static constexpr int kEndOfFileWaitMs = 100;
+
+static Counter& s_lateFrames = Metrics::instance().counter(
+    "sar_playback_late_frames_total", "Decoded playback frames skipped to keep to the timeline");
+static Counter& s_loops = Metrics::instance().counter(
+    "sar_playback_loops_total", "Times file playback wrapped to the start");
+static Gauge& s_buffered = Metrics::instance().gauge(
+    "sar_playback_buffered_frames", "Decoded frames waiting in the playback ring");
+static Histogram& s_decodeTime = Metrics::instance().stage("decode");
+
+// ---------------------------------------------------------------------------
+// MP4/MOV sync-sample table
+
+static uint32_t readBe32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static uint64_t readBe64(const uint8_t* p) {
+    return (static_cast<uint64_t>(readBe32(p)) << 32) | readBe32(p + 4);
+}
+
+struct Box {
+    const uint8_t* payload = nullptr;
+    size_t size = 0;
+};
+
+// Reads the box at p and advances p past it; false at the end or on a malformed box
+static bool nextBox(const uint8_t*& p, const uint8_t* end, char type[4], Box& box) {
+    if (end - p < 8) return false;
+    uint64_t size = readBe32(p);
+    std::memcpy(type, p + 4, 4);
+    size_t header = 8;
+    if (size == 1) {
+        if (end - p < 16) return false;
+        size = readBe64(p + 8);
+        header = 16;
+    } else if (size == 0) {
+        size = static_cast<uint64_t>(end - p);
+    }
+    if (size < header || size > static_cast<uint64_t>(end - p)) return false;
+    
+    box.payload = p + header;
+    box.size = static_cast<size_t>(size - header);
+    p += size;
+    return true;
+}
+
+static bool findBox(const Box& parent, const char* type, Box& out) {
+    const uint8_t* p = parent.payload;
+    const uint8_t* end = parent.payload + parent.size;
+    char t[4];
+    while (nextBox(p, end, t, out)) {
+        if (std::memcmp(t, type, 4) == 0) return true;
+    }
+    return false;
+}
+
+bool KeyframeIndex::load(const std::string& path) {
+    keyframes.clear();
+    frameCount = 0;
+    fps = 0;
+    
+    MappedFile file;
+    if (!file.open(path)) return false;
+    
+    Box root{file.data(), file.size()};
+    Box moov;
+    if (!findBox(root, "moov", moov)) return false;
+    
+    const uint8_t* p = moov.payload;
+    const uint8_t* end = moov.payload + moov.size;
+    char type[4];
+    Box trak;
+    while (nextBox(p, end, type, trak)) {
+        if (std::memcmp(type, "trak", 4) != 0) continue;
+        
+        Box mdia, hdlr, mdhd, minf, stbl, stts, stss;
+        if (!findBox(trak, "mdia", mdia) || !findBox(mdia, "hdlr", hdlr) || hdlr.size < 12 ||
+            std::memcmp(hdlr.payload + 8, "vide", 4) != 0) {
+            continue;
+        }
+        if (!findBox(mdia, "mdhd", mdhd) || !findBox(mdia, "minf", minf) ||
+            !findBox(minf, "stbl", stbl) || !findBox(stbl, "stts", stts) || stts.size < 8) {
+            return false;
+        }
+        
+        // mdhd version 1 widens the creation/modification times to 64 bits
+        size_t timescaleOffset = (mdhd.size > 0 && mdhd.payload[0] == 1) ? 20 : 12;
+        if (mdhd.size < timescaleOffset + 4) return false;
+        uint32_t timescale = readBe32(mdhd.payload + timescaleOffset);
+        
+        // Sample durations give the frame count and the mean rate
+        uint32_t entries = readBe32(stts.payload + 4);
+        if (stts.size < 8 + static_cast<size_t>(entries) * 8) return false;
+        uint64_t ticks = 0;
+        for (uint32_t i = 0; i < entries; i++) {
+            uint32_t count = readBe32(stts.payload + 8 + i * 8);
+            frameCount += count;
+            ticks += static_cast<uint64_t>(count) * readBe32(stts.payload + 12 + i * 8);
+        }
+        if (frameCount <= 0 || ticks == 0 || timescale == 0) return false;
+        fps = frameCount / (static_cast<double>(ticks) / timescale);
+        
+        // No stss box means every sample is a sync sample
+        if (findBox(stbl, "stss", stss) && stss.size >= 8) {
+            uint32_t count = readBe32(stss.payload + 4);
+            if (stss.size < 8 + static_cast<size_t>(count) * 4) return false;
+            keyframes.reserve(count);
+            for (uint32_t i = 0; i < count; i++) {
+                keyframes.push_back(static_cast<int64_t>(readBe32(stss.payload + 8 + i * 4)) - 1);
+            }
+            std::sort(keyframes.begin(), keyframes.end());
+        } else {
+            keyframes.resize(static_cast<size_t>(frameCount));
+            for (int64_t i = 0; i < frameCount; i++) keyframes[static_cast<size_t>(i)] = i;
+        }
+        return !keyframes.empty();
+    }
+    return false;
+}
+
+int64_t KeyframeIndex::keyframeAtOrBefore(int64_t frame) const {
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+    return it == keyframes.begin() ? 0 : *(it - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Playback
+
+Playback::Playback() {}
+
+Playback::~Playback() {
+    close();
+}
+
+bool Playback::open(const std::string& path, const PlaybackConfig& config) {
+    close();
+    m_config = config;
+    m_config.decode_ahead = std::max(2, m_config.decode_ahead);
+    
+    if (!m_capture.open(path)) {
+        return false;
+    }
+    
+    m_width = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_WIDTH));
+    m_height = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+    m_fps = m_capture.get(cv::CAP_PROP_FPS);
+    m_frameCount = static_cast<int64_t>(m_capture.get(cv::CAP_PROP_FRAME_COUNT));
+    
+    if (m_index.load(path)) {
+        if (m_fps <= 0) m_fps = m_index.fps;
+        m_frameCount = m_index.frameCount;
+        std::cout << "Playback: " << m_index.keyframes.size() << " keyframes indexed" << std::endl;
+    } else {
+        std::cout << "Playback: no MP4 keyframe index, seeking through the decoder" << std::endl;
+    }
+    if (m_fps <= 0) m_fps = 30.0;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_ring.clear();
+        m_seekRequest = -1;
+        m_presentEpoch = UINT32_MAX;
+        m_speed = std::clamp(m_config.speed, kMinSpeed, kMaxSpeed);
+        m_paused = false;
+        m_positionMs = 0;
+    }
+    
+    m_running = true;
+    m_thread = std::thread(&Playback::decodeThread, this);
+    return true;
+}
+
+void Playback::close() {
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_running = false;
+    }
+    m_ringNotFull.notify_all();
+    m_ringNotEmpty.notify_all();
+    
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    if (m_capture.isOpened()) {
+        m_capture.release();
+    }
+    
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    m_ring.clear();
+}
+
+double Playback::frameTimeMs(int64_t frame) const {
+    return frame * 1000.0 / m_fps;
+}
+
+void Playback::seekTo(int64_t target, int64_t& next) {
+    SAR_TRACE_SCOPE("playback.seek");
+    if (m_frameCount > 0) target = std::min(target, m_frameCount - 1);
+    target = std::max<int64_t>(target, 0);
+    
+    // Without an index the backend finds the keyframe itself. With one, a target
+    // later in the GOP being decoded needs no seek at all, only more decoding.
+    int64_t keyframe = m_index.empty() ? target : m_index.keyframeAtOrBefore(target);
+    if (next < keyframe || next > target) {
+        m_capture.set(cv::CAP_PROP_POS_FRAMES, static_cast<double>(keyframe));
+        next = keyframe;
+    }
+    
+    // grab() decodes without the colour conversion and copy of retrieve()
+    while (next < target && m_capture.grab()) {
+        next++;
+    }
+}
+
+void Playback::decodeThread() {
+    applyThreadTopology("playback");
+    
+    int64_t next = 0;               // Frame number the next grab() returns
+    uint32_t epoch = 0;
+    double loopOffsetMs = 0;        // Added to pts so the timeline continues across a loop
+    double lastPositionMs = -1.0;
+    
+    while (m_running) {
+        int64_t seek;
+        double speed;
+        {
+            std::unique_lock<std::mutex> lock(m_ringMutex);
+            m_ringNotFull.wait(lock, [this] {
+                return !m_running || m_seekRequest >= 0 ||
+                       static_cast<int>(m_ring.size()) < m_config.decode_ahead;
+            });
+            if (!m_running) break;
+            
+            seek = m_seekRequest;
+            m_seekRequest = -1;
+            if (seek >= 0) {
+                m_ring.clear();
+                epoch = ++m_epoch;
+            }
+            speed = m_speed;
+        }
+        
+        if (seek >= 0) {
+            seekTo(seek, next);
+            loopOffsetMs = 0;
+            lastPositionMs = -1.0;
+        }
+        
+        bool grabbed;
+        {
+            SAR_TRACE_SCOPE("playback.decode");
+            ScopedTimer timer(s_decodeTime);
+            grabbed = m_capture.grab();
+        }
+        
+        if (!grabbed) {
+            if (m_config.loop && next > 0) {
+                // Rewind while the ring still holds the tail of the file, so the
+                // presenter never sees the wrap
+                Trace::instant("playback.loop");
+                loopOffsetMs += lastPositionMs + 1000.0 / m_fps;
+                m_capture.set(cv::CAP_PROP_POS_FRAMES, 0.0);
+                next = 0;
+                lastPositionMs = -1.0;
+                s_loops.inc();
+            } else {
+                std::unique_lock<std::mutex> lock(m_ringMutex);
+                m_ringNotFull.wait_for(lock, std::chrono::milliseconds(kEndOfFileWaitMs),
+                                       [this] { return !m_running || m_seekRequest >= 0; });
+            }
+            continue;
+        }
+        
+        // Container timestamps pace the presenter; fall back to the frame rate when
+        // the backend does not report them
+        double positionMs = m_capture.get(cv::CAP_PROP_POS_MSEC);
+        if (!(positionMs > lastPositionMs)) {
+            positionMs = std::max(frameTimeMs(next), lastPositionMs + 1000.0 / m_fps);
+        }
+        lastPositionMs = positionMs;
+        int64_t frameNumber = next++;
+        
+        // Above 2x the display cannot show every frame, so only convert the ones it will
+        int stride = speed >= 2.0 ? static_cast<int>(speed) : 1;
+        if (seek < 0 && stride > 1 && frameNumber % stride != 0) continue;
+        
+        Frame frame;
+        {
+            SAR_TRACE_SCOPE("playback.retrieve");
+            if (!m_capture.retrieve(frame.image) || frame.image.empty()) continue;
+        }
+        frame.ptsMs = loopOffsetMs + positionMs;
+        frame.positionMs = positionMs;
+        frame.epoch = epoch;
+        
+        size_t buffered;
+        {
+            std::lock_guard<std::mutex> lock(m_ringMutex);
+            m_ring.push_back(std::move(frame));
+            buffered = m_ring.size();
+        }
+        m_ringNotEmpty.notify_one();
+        s_buffered.set(static_cast<double>(buffered));
+    }
+}
+
+bool Playback::present(cv::Mat& frame, int timeoutMs) {
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    auto dueTime = [this](const Frame& f) {
+        return m_anchorWall + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>((f.ptsMs - m_anchorPts) / m_speed));
+    };
+    
+    std::unique_lock<std::mutex> lock(m_ringMutex);
+    while (m_running) {
+        if (m_ring.empty() || (m_paused && m_ring.front().epoch == m_presentEpoch)) {
+            if (m_ringNotEmpty.wait_until(lock, deadline) == std::cv_status::timeout) return false;
+            continue;
+        }
+        
+        auto now = Clock::now();
+        const Frame& front = m_ring.front();
+        bool jumped = front.epoch != m_presentEpoch;
+        
+        // Restart the timeline from here after a seek, a resume or a speed change
+        if (jumped) {
+            m_presentEpoch = front.epoch;
+            m_anchorWall = now;
+            m_anchorPts = front.ptsMs;
+            m_reanchor = false;
+        } else if (m_reanchor) {
+            m_anchorWall = now;
+            m_anchorPts = m_lastPts;
+            m_reanchor = false;
+        }
+        
+        if (!jumped) {
+            auto due = dueTime(front);
+            if (now < due) {
+                if (due > deadline) {
+                    m_ringNotEmpty.wait_until(lock, deadline);
+                    if (Clock::now() >= deadline) return false;
+                } else {
+                    m_ringNotEmpty.wait_until(lock, due);
+                }
+                continue;
+            }
+            
+            // Behind schedule: skip frames whose successor is already due
+            uint64_t late = 0;
+            while (m_ring.size() > 1 && m_ring[1].epoch == m_presentEpoch && dueTime(m_ring[1]) <= now) {
+                m_ring.pop_front();
+                late++;
+            }
+            if (late > 0) s_lateFrames.inc(late);
+        }
+        
+        Frame next = std::move(m_ring.front());
+        m_ring.pop_front();
+        m_lastPts = next.ptsMs;
+        m_positionMs = next.positionMs;
+        size_t buffered = m_ring.size();
+        lock.unlock();
+        
+        s_buffered.set(static_cast<double>(buffered));
+        
+        m_ringNotFull.notify_one();
+        frame = std::move(next.image);
+        return true;
+    }
+    return false;
+}
+
+void Playback::seek(double seconds) {
+    int64_t target = std::max<int64_t>(0, std::llround(seconds * m_fps));
+    if (m_frameCount > 0) target = std::min(target, m_frameCount - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_seekRequest = target;
+    }
+    m_ringNotFull.notify_one();
+}
+
+void Playback::seekRelative(double seconds) {
+    double position;
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        position = m_positionMs / 1000.0;
+    }
+    seek(position + seconds);
+}
+
+void Playback::setSpeed(double speed) {
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_speed = std::clamp(speed, kMinSpeed, kMaxSpeed);
+        m_reanchor = true;
+    }
+    m_ringNotEmpty.notify_all();
+}
+
+void Playback::togglePause() {
+    {
+        std::lock_guard<std::mutex> lock(m_ringMutex);
+        m_paused = !m_paused;
+        m_reanchor = !m_paused;
+    }
+    m_ringNotEmpty.notify_all();
+}
+
+PlaybackStatus Playback::getStatus() const {
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    PlaybackStatus status;
+    status.positionSeconds = m_positionMs / 1000.0;
+    status.durationSeconds = m_frameCount > 0 ? m_frameCount / m_fps : 0.0;
+    status.speed = m_speed;
+    status.paused = m_paused;
+    return status;
+}
+
+} // namespace sar
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+// Sync-sample (keyframe) table of the first video track of an MP4/MOV file, read
+// from the container without decoding anything
+struct KeyframeIndex {
+    std::vector<int64_t> keyframes;     // Frame numbers, ascending
+    int64_t frameCount = 0;
+    double fps = 0;
+    
+    bool load(const std::string& path);
+    bool empty() const { return keyframes.empty(); }
+    
+    // Last keyframe at or before frame
+    int64_t keyframeAtOrBefore(int64_t frame) const;
+};
+
+struct PlaybackStatus {
+    double positionSeconds = 0;
+    double durationSeconds = 0;
+    double speed = 1.0;
+    bool paused = false;
+};
+
+// Plays a video file with a decode-ahead thread feeding a bounded ring of decoded
+// frames. The capture thread calls present(), which hands out each frame when its
+// presentation timestamp is due at the current speed.
+class Playback {
+public:
+    Playback();
+    ~Playback();
+    
+    bool open(const std::string& path, const PlaybackConfig& config);
+    void close();
+    
+    // Waits up to timeoutMs for the next due frame; false if none was due
+    bool present(cv::Mat& frame, int timeoutMs);
+    
+    // Controls, callable from any thread
+    void seek(double seconds);
+    void seekRelative(double seconds);
+    void setSpeed(double speed);
+    void togglePause();
+    
+    PlaybackStatus getStatus() const;
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    double getFps() const { return m_fps; }
+    
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    struct Frame {
+        cv::Mat image;
+        double ptsMs = 0;               // Continuous across loops
+        double positionMs = 0;          // Position within the file
+        uint32_t epoch = 0;             // Bumped by every seek
+    };
+    
+    void decodeThread();
+    void seekTo(int64_t target, int64_t& next);
+    double frameTimeMs(int64_t frame) const;
+    
+    PlaybackConfig m_config;
+    cv::VideoCapture m_capture;         // Decode thread only once started
+    KeyframeIndex m_index;
+    int m_width = 0;
+    int m_height = 0;
+    double m_fps = 30.0;
+    int64_t m_frameCount = 0;
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    // Decode-ahead ring
+    mutable std::mutex m_ringMutex;
+    std::condition_variable m_ringNotFull;
+    std::condition_variable m_ringNotEmpty;
+    std::deque<Frame> m_ring;
+    uint32_t m_epoch = 0;
+    int64_t m_seekRequest = -1;         // Frame number, -1 if none
+    
+    // Presentation clock (capture thread, plus the flags below under m_ringMutex)
+    uint32_t m_presentEpoch = UINT32_MAX;
+    Clock::time_point m_anchorWall;
+    double m_anchorPts = 0;
+    double m_lastPts = 0;
+    bool m_reanchor = false;
+    double m_speed = 1.0;
+    bool m_paused = false;
+    double m_positionMs = 0;
+};
+
+} // namespace sar
@@ -0,0 +1,660 @@
+#include "raw_recorder.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+#ifdef SAR_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef SAR_HAVE_URING
+#include <liburing.h>
+#endif
+#endif
+
+namespace sar {
+
+static Counter& s_rawFrames = Metrics::instance().counter(
+    "sar_raw_frames_total", "Frames written to raw recordings");
+static Counter& s_rawDropped = Metrics::instance().counter(
+    "sar_raw_dropped_frames_total", "Frames the raw recorder could not accept in time");
+static Gauge& s_rawWriteRate = Metrics::instance().gauge(
+    "sar_raw_write_mbps", "Raw recording disk throughput in MB/s");
+static Gauge& s_rawRatio = Metrics::instance().gauge(
+    "sar_raw_compression_ratio", "Uncompressed over stored bytes for the current raw recording");
+static Histogram& s_compressTime = Metrics::instance().stage("raw_compress");
+
+// Writes kept in flight by the io_uring path
+static constexpr int kRingDepth = 8;
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Chunk file output: positional writes with the buffer owned until completion
+
+class ChunkWriter {
+public:
+    using Recycle = std::function<void(std::vector<uint8_t>&&)>;
+    
+    explicit ChunkWriter(Recycle recycle) : m_recycle(std::move(recycle)) {}
+    ~ChunkWriter() { finish(0); }
+    
+    bool open(const std::string& path, uint64_t preallocate) {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) {
+            m_file = nullptr;
+            return false;
+        }
+        // Reserve the extent up front so appends don't grow the file piecemeal
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(preallocate);
+        if (SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN)) {
+            SetEndOfFile(m_file);
+        }
+#else
+        m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) return false;
+        // Reserve the extent up front so appends don't allocate blocks piecemeal
+        if (preallocate > 0) {
+            posix_fallocate(m_fd, 0, static_cast<off_t>(preallocate));
+        }
+#ifdef SAR_HAVE_URING
+        m_ringReady = io_uring_queue_init(kRingDepth, &m_ring, 0) == 0;
+#endif
+#endif
+        return true;
+    }
+    
+    bool write(std::vector<uint8_t>&& data, uint64_t offset) {
+#ifdef SAR_HAVE_URING
+        if (m_ringReady) {
+            return submit(std::move(data), offset);
+        }
+#endif
+        bool ok = writeAt(data.data(), data.size(), offset);
+        m_recycle(std::move(data));
+        return ok;
+    }
+    
+    // Waits for outstanding writes, trims the preallocation to size, syncs and closes
+    bool finish(uint64_t size) {
+        bool ok = true;
+#ifdef SAR_HAVE_URING
+        if (m_ringReady) {
+            while (m_pending > 0 && reap(true)) {}
+            io_uring_queue_exit(&m_ring);
+            m_ringReady = false;
+            ok = !m_failed;
+        }
+#endif
+#ifdef _WIN32
+        if (!m_file) return ok;
+        if (size > 0) {
+            LARGE_INTEGER end;
+            end.QuadPart = static_cast<LONGLONG>(size);
+            ok = SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) && SetEndOfFile(m_file) && ok;
+            ok = FlushFileBuffers(m_file) && ok;
+        }
+        CloseHandle(m_file);
+        m_file = nullptr;
+#else
+        if (m_fd < 0) return ok;
+        if (size > 0) {
+            ok = ftruncate(m_fd, static_cast<off_t>(size)) == 0 && ok;
+            ok = fsync(m_fd) == 0 && ok;
+        }
+        ::close(m_fd);
+        m_fd = -1;
+#endif
+        return ok;
+    }
+    
+private:
+    bool writeAt(const uint8_t* data, size_t size, uint64_t offset) {
+        while (size > 0) {
+#ifdef _WIN32
+            OVERLAPPED position{};
+            position.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFu);
+            position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD written = 0;
+            DWORD request = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+            if (!WriteFile(m_file, data, request, &written, &position) || written == 0) return false;
+#else
+            ssize_t written = pwrite(m_fd, data, size, static_cast<off_t>(offset));
+            if (written <= 0) return false;
+#endif
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+    
+#ifdef SAR_HAVE_URING
+    bool submit(std::vector<uint8_t>&& data, uint64_t offset) {
+        // Release whatever has finished; block only when every slot is busy
+        while (m_pending > 0 && reap(false)) {}
+        if (m_pending == kRingDepth) {
+            reap(true);
+        }
+        
+        int slot = 0;
+        while (m_slots[slot].busy) slot++;
+        Slot& s = m_slots[slot];
+        s.data = std::move(data);
+        s.offset = offset;
+        s.busy = true;
+        
+        io_uring_sqe* sqe = io_uring_get_sqe(&m_ring);
+        io_uring_prep_write(sqe, m_fd, s.data.data(), static_cast<unsigned>(s.data.size()), offset);
+        io_uring_sqe_set_data64(sqe, static_cast<uint64_t>(slot));
+        io_uring_submit(&m_ring);
+        m_pending++;
+        return !m_failed;
+    }
+    
+    // Retires one completed write, or waits for one; false if none completed. A short
+    // or failed write is finished synchronously.
+    bool reap(bool wait) {
+        io_uring_cqe* cqe = nullptr;
+        int rc = wait ? io_uring_wait_cqe(&m_ring, &cqe) : io_uring_peek_cqe(&m_ring, &cqe);
+        if (rc != 0 || !cqe) return false;
+        
+        Slot& s = m_slots[io_uring_cqe_get_data64(cqe)];
+        size_t done = cqe->res > 0 ? static_cast<size_t>(cqe->res) : 0;
+        io_uring_cqe_seen(&m_ring, cqe);
+        
+        if (done != s.data.size() && !writeAt(s.data.data() + done, s.data.size() - done, s.offset + done)) {
+            m_failed = true;
+        }
+        s.busy = false;
+        m_pending--;
+        m_recycle(std::move(s.data));
+        return true;
+    }
+    
+    struct Slot {
+        std::vector<uint8_t> data;
+        uint64_t offset = 0;
+        bool busy = false;
+    };
+    io_uring m_ring{};
+    bool m_ringReady = false;
+    Slot m_slots[kRingDepth];
+    int m_pending = 0;
+    bool m_failed = false;
+#endif
+    
+    Recycle m_recycle;
+#ifdef _WIN32
+    HANDLE m_file = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// ---------------------------------------------------------------------------
+// Recorder
+
+RawRecorder::RawRecorder() {}
+
+RawRecorder::~RawRecorder() {
+    stop();
+}
+
+bool RawRecorder::start(const std::string& baseName, double fps, const RecordingConfig& config) {
+    if (m_recording) return false;
+    
+    m_config = config;
+    m_baseName = baseName;
+    m_fps = fps;
+    m_type = -1;                        // Geometry comes from the first frame
+    m_nextFrame = 0;
+    m_inFlight = 0;
+    m_stopping = false;
+    m_chunkNumber = 0;
+    m_bytesWritten = 0;
+    m_rawBytes = 0;
+    m_framesWritten = 0;
+    
+    int workers = config.raw_workers;
+    if (workers <= 0) {
+        workers = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, 8);
+    }
+    m_workerCount = workers;
+    m_workersLeft = workers;
+    for (int i = 0; i < workers; i++) {
+        m_workers.emplace_back(&RawRecorder::compressThread, this);
+    }
+    m_writer = std::thread(&RawRecorder::writeThread, this);
+    
+#ifndef SAR_HAVE_LZ4
+    std::cout << "Raw recording: built without LZ4, frames are stored uncompressed" << std::endl;
+#endif
+    m_recording = true;
+    return true;
+}
+
+void RawRecorder::stop() {
+    if (!m_recording) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    if (m_writer.joinable()) {
+        m_writer.join();
+    }
+    m_recording = false;
+}
+
+bool RawRecorder::submit(const cv::Mat& frame) {
+    if (!m_recording || frame.empty()) return false;
+    
+    // A session keeps the first frame's geometry; the reader relies on it. Frames of
+    // another size (a source switching streams) are scaled back to it by the workers.
+    if (m_type < 0) {
+        m_width = frame.cols;
+        m_height = frame.rows;
+        m_type = frame.type();
+    } else if (frame.type() != m_type) {
+        s_rawDropped.inc();
+        return false;
+    }
+    
+    if (m_inFlight.load() >= m_config.raw_queue_frames) {
+        Trace::instant("raw.drop");
+        s_rawDropped.inc();
+        return false;
+    }
+    m_inFlight++;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobs.push_back(Job{frame, m_nextFrame++, steadyNowNs()});
+    }
+    m_jobReady.notify_one();
+    return true;
+}
+
+void RawRecorder::compressThread() {
+    applyThreadTopology("recorder");
+    
+    cv::Mat scaled;
+    
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_jobReady.wait(lock, [&] { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) break;      // Stopping and drained
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        
+        std::vector<uint8_t> record;
+        {
+            std::lock_guard<std::mutex> lock(m_doneMutex);
+            if (!m_freeBuffers.empty()) {
+                record = std::move(m_freeBuffers.back());
+                m_freeBuffers.pop_back();
+            }
+        }
+        
+        {
+            SAR_TRACE_SCOPE("raw.compress");
+            ScopedTimer timer(s_compressTime);
+            
+            // Geometry is set by the first submit, before that job was queued
+            const cv::Size sessionSize(m_width, m_height);
+            cv::Mat source;
+            if (job.frame.size() != sessionSize) {
+                cv::resize(job.frame, scaled, sessionSize, 0, 0, cv::INTER_AREA);
+                source = scaled;
+            } else {
+                source = job.frame.isContinuous() ? job.frame : job.frame.clone();
+            }
+            job.frame.release();
+            const size_t rawBytes = source.total() * source.elemSize();
+            
+            RawFrameHeader header{};
+            header.magic = kRawFrameMagic;
+            header.frameNumber = job.frameNumber;
+            header.timestampNs = job.timestampNs;
+            header.rawBytes = static_cast<uint32_t>(rawBytes);
+            
+            size_t stored = 0;
+#ifdef SAR_HAVE_LZ4
+            const int bound = LZ4_compressBound(static_cast<int>(rawBytes));
+            record.resize(sizeof(RawFrameHeader) + static_cast<size_t>(bound));
+            int compressed = LZ4_compress_default(reinterpret_cast<const char*>(source.data),
+                                                  reinterpret_cast<char*>(record.data() + sizeof(RawFrameHeader)),
+                                                  static_cast<int>(rawBytes), bound);
+            if (compressed > 0 && static_cast<size_t>(compressed) < rawBytes) {
+                header.codec = static_cast<uint32_t>(RawCodec::Lz4);
+                stored = static_cast<size_t>(compressed);
+            }
+#endif
+            if (stored == 0) {
+                // Incompressible (or no LZ4): keep the rows as they are
+                header.codec = static_cast<uint32_t>(RawCodec::Stored);
+                record.resize(sizeof(RawFrameHeader) + rawBytes);
+                std::memcpy(record.data() + sizeof(RawFrameHeader), source.data, rawBytes);
+                stored = rawBytes;
+            }
+            header.storedBytes = static_cast<uint32_t>(stored);
+            record.resize(sizeof(RawFrameHeader) + stored);
+            std::memcpy(record.data(), &header, sizeof(header));
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_doneMutex);
+            m_done.emplace(job.frameNumber, std::move(record));
+        }
+        m_doneReady.notify_one();
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        m_workersLeft--;
+    }
+    m_doneReady.notify_one();
+}
+
+void RawRecorder::writeThread() {
+    applyThreadTopology("recorder_io");
+    
+    uint64_t nextWrite = 0;
+    const uint64_t chunkBytes = static_cast<uint64_t>(std::max(16, m_config.raw_chunk_mb)) << 20;
+    auto start = std::chrono::steady_clock::now();
+    auto rateStart = start;
+    uint64_t rateBytes = 0;
+    bool failed = false;
+    
+    while (true) {
+        std::vector<uint8_t> record;
+        {
+            // Workers finish out of order; records are appended strictly by frame number
+            std::unique_lock<std::mutex> lock(m_doneMutex);
+            m_doneReady.wait(lock, [&] {
+                return m_done.count(nextWrite) || (m_workersLeft == 0 && m_done.empty());
+            });
+            auto it = m_done.find(nextWrite);
+            if (it == m_done.end()) break;  // Workers gone and everything written
+            record = std::move(it->second);
+            m_done.erase(it);
+        }
+        
+        const RawFrameHeader* header = reinterpret_cast<const RawFrameHeader*>(record.data());
+        const uint64_t size = record.size();
+        const int64_t timestampNs = header->timestampNs;
+        m_rawBytes += header->rawBytes;
+        
+        if (!failed) {
+            SAR_TRACE_SCOPE("raw.write");
+            
+            // Roll over before the chunk outgrows its preallocation
+            if (m_chunk && !m_index.empty() && m_chunkOffset + size > chunkBytes) {
+                closeChunk();
+            }
+            if (!m_chunk && !openChunk()) {
+                std::cerr << "Raw recording: cannot create chunk in " << m_config.output_dir << std::endl;
+                failed = true;
+            }
+            if (!failed) {
+                m_index.push_back(RawIndexEntry{m_chunkOffset, nextWrite, timestampNs});
+                if (!m_chunk->write(std::move(record), m_chunkOffset)) {
+                    std::cerr << "Raw recording: write failed, stopping" << std::endl;
+                    failed = true;
+                }
+                m_chunkOffset += size;
+                m_bytesWritten += size;
+                rateBytes += size;
+                m_framesWritten++;
+                s_rawFrames.inc();
+            }
+        }
+        nextWrite++;
+        m_inFlight--;
+        
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - rateStart).count();
+        if (elapsed >= 1.0) {
+            s_rawWriteRate.set(rateBytes / elapsed / 1e6);
+            if (m_bytesWritten > 0) s_rawRatio.set(static_cast<double>(m_rawBytes) / m_bytesWritten);
+            rateBytes = 0;
+            rateStart = now;
+        }
+    }
+    
+    if (m_chunk) {
+        closeChunk();
+    }
+    s_rawWriteRate.set(0.0);
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Raw recording: " << m_framesWritten << " frames, " << (m_bytesWritten >> 20) << " MB in "
+              << m_chunkNumber << " chunk(s), " << std::fixed << std::setprecision(1)
+              << (seconds > 0 ? m_bytesWritten / seconds / 1e6 : 0.0) << " MB/s, ratio "
+              << (m_bytesWritten > 0 ? static_cast<double>(m_rawBytes) / m_bytesWritten : 0.0)
+              << std::defaultfloat << std::endl;
+}
+
+bool RawRecorder::openChunk() {
+    std::stringstream ss;
+    ss << m_baseName << "_raw_" << std::setw(4) << std::setfill('0') << m_chunkNumber << ".sarraw";
+    m_chunkPath = ss.str();
+    if (m_chunkListener) m_chunkListener(m_chunkPath, true);
+    
+    m_chunk = std::make_unique<ChunkWriter>([this](std::vector<uint8_t>&& buffer) {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        if (m_freeBuffers.size() < static_cast<size_t>(m_workerCount) + kRingDepth) {
+            m_freeBuffers.push_back(std::move(buffer));
+        }
+    });
+    if (!m_chunk->open(ss.str(), static_cast<uint64_t>(std::max(16, m_config.raw_chunk_mb)) << 20)) {
+        m_chunk.reset();
+        if (m_chunkListener) m_chunkListener(m_chunkPath, false);
+        return false;
+    }
+    
+    RawChunkHeader header{};
+    std::memcpy(header.magic, kRawChunkMagic, sizeof(header.magic));
+    header.version = kRawVersion;
+    header.chunk = m_chunkNumber;
+    header.width = static_cast<uint32_t>(m_width);
+    header.height = static_cast<uint32_t>(m_height);
+    header.type = m_type;
+    header.fps = m_fps;
+    header.firstFrame = m_index.empty() ? 0 : m_index.back().frameNumber + 1;
+    
+    std::vector<uint8_t> bytes(sizeof(header));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    m_chunk->write(std::move(bytes), 0);
+    m_chunkOffset = sizeof(header);
+    m_index.clear();
+    
+    std::cout << "Raw recording chunk: " << ss.str() << std::endl;
+    return true;
+}
+
+void RawRecorder::closeChunk() {
+    // Index and footer go after the last record, then the preallocation is trimmed
+    RawChunkFooter footer{};
+    footer.indexOffset = m_chunkOffset;
+    footer.count = m_index.size();
+    std::memcpy(footer.magic, kRawIndexMagic, sizeof(footer.magic));
+    
+    std::vector<uint8_t> tail(m_index.size() * sizeof(RawIndexEntry) + sizeof(footer));
+    std::memcpy(tail.data(), m_index.data(), m_index.size() * sizeof(RawIndexEntry));
+    std::memcpy(tail.data() + m_index.size() * sizeof(RawIndexEntry), &footer, sizeof(footer));
+    const uint64_t end = m_chunkOffset + tail.size();
+    
+    m_chunk->write(std::move(tail), m_chunkOffset);
+    if (!m_chunk->finish(end)) {
+        std::cerr << "Raw recording: could not finalise chunk " << m_chunkNumber << std::endl;
+    }
+    m_chunk.reset();
+    if (m_chunkListener) m_chunkListener(m_chunkPath, false);
+    m_chunkNumber++;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+
+static std::string chunkPath(const std::string& base, uint32_t chunk) {
+    std::stringstream ss;
+    ss << base << "_raw_" << std::setw(4) << std::setfill('0') << chunk << ".sarraw";
+    return ss.str();
+}
+
+bool RawReader::open(const std::string& path) {
+    close();
+    
+    // <base>_raw_NNNN.sarraw
+    const std::string suffix = ".sarraw";
+    const size_t marker = path.rfind("_raw_");
+    if (marker == std::string::npos || path.size() < suffix.size() ||
+        path.compare(path.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return addChunk(path);
+    }
+    
+    const std::string base = path.substr(0, marker);
+    for (uint32_t chunk = 0; std::filesystem::exists(chunkPath(base, chunk)); chunk++) {
+        if (!addChunk(chunkPath(base, chunk))) break;
+    }
+    return !m_frames.empty();
+}
+
+void RawReader::close() {
+    m_frames.clear();
+    m_chunks.clear();
+    m_width = m_height = m_type = 0;
+    m_fps = 0;
+}
+
+// A whole frame record (header and payload) lies inside the chunk at offset. Written
+// so that no offset or length read from the file can wrap the arithmetic.
+static bool recordFits(const uint8_t* data, size_t size, uint64_t offset, RawFrameHeader& record) {
+    if (offset > size || sizeof(RawFrameHeader) > size - offset) return false;
+    std::memcpy(&record, data + offset, sizeof(record));
+    return record.magic == kRawFrameMagic && record.storedBytes <= size - offset - sizeof(RawFrameHeader);
+}
+
+bool RawReader::addChunk(const std::string& path) {
+    auto chunk = std::make_unique<MappedFile>();
+    if (!chunk->open(path) || chunk->size() < sizeof(RawChunkHeader)) return false;
+    
+    const uint8_t* data = chunk->data();
+    const size_t size = chunk->size();
+    RawChunkHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kRawChunkMagic, sizeof(header.magic)) != 0 || header.version != kRawVersion) {
+        return false;
+    }
+    if (m_chunks.empty()) {
+        m_width = static_cast<int>(header.width);
+        m_height = static_cast<int>(header.height);
+        m_type = header.type;
+        m_fps = header.fps;
+    } else if (static_cast<int>(header.width) != m_width || static_cast<int>(header.height) != m_height ||
+               header.type != m_type) {
+        return false;
+    }
+    
+    const MappedFile* file = chunk.get();
+    RawChunkFooter footer{};
+    if (size >= sizeof(RawChunkHeader) + sizeof(footer)) {
+        std::memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+    }
+    
+    // The index must sit between the header and the footer and end exactly at the
+    // footer; each entry must then point at a whole record
+    const size_t before = m_frames.size();
+    bool indexed = std::memcmp(footer.magic, kRawIndexMagic, sizeof(footer.magic)) == 0 &&
+                   footer.indexOffset >= sizeof(RawChunkHeader) && footer.indexOffset <= size - sizeof(footer) &&
+                   footer.count == (size - sizeof(footer) - footer.indexOffset) / sizeof(RawIndexEntry) &&
+                   footer.indexOffset + footer.count * sizeof(RawIndexEntry) + sizeof(footer) == size;
+    for (uint64_t i = 0; indexed && i < footer.count; i++) {
+        RawIndexEntry entry;
+        RawFrameHeader record;
+        std::memcpy(&entry, data + footer.indexOffset + i * sizeof(entry), sizeof(entry));
+        if (entry.offset < sizeof(RawChunkHeader) || entry.offset > footer.indexOffset ||
+            !recordFits(data, static_cast<size_t>(footer.indexOffset), entry.offset, record)) {
+            std::cerr << "Raw chunk " << path << ": index entry " << i << " is out of bounds" << std::endl;
+            m_frames.resize(before);
+            indexed = false;
+            break;
+        }
+        m_frames.push_back(FrameRef{file, entry.offset, entry.timestampNs});
+    }
+    
+    if (!indexed) {
+        // No usable footer (recording cut short, or damaged): walk the record headers instead
+        uint64_t offset = sizeof(RawChunkHeader);
+        RawFrameHeader record;
+        while (recordFits(data, size, offset, record)) {
+            m_frames.push_back(FrameRef{file, offset, record.timestampNs});
+            offset += sizeof(record) + record.storedBytes;
+        }
+        std::cout << "Raw chunk " << path << " has no index; recovered " << (m_frames.size() - before) << " frames" << std::endl;
+    }
+    
+    m_chunks.push_back(std::move(chunk));
+    return true;
+}
+
+bool RawReader::read(uint64_t n, cv::Mat& frame, int64_t* timestampNs) const {
+    if (n >= m_frames.size()) return false;
+    
+    const FrameRef& ref = m_frames[n];
+    RawFrameHeader header;
+    if (!recordFits(ref.chunk->data(), ref.chunk->size(), ref.offset, header)) return false;
+    const uint8_t* payload = ref.chunk->data() + ref.offset + sizeof(header);
+    
+    frame.create(m_height, m_width, m_type);
+    if (header.rawBytes != frame.total() * frame.elemSize()) return false;
+    
+    if (header.codec == static_cast<uint32_t>(RawCodec::Stored)) {
+        if (header.storedBytes < header.rawBytes) return false;
+        std::memcpy(frame.data, payload, header.rawBytes);
+    } else if (header.codec == static_cast<uint32_t>(RawCodec::Lz4)) {
+#ifdef SAR_HAVE_LZ4
+        int decoded = LZ4_decompress_safe(reinterpret_cast<const char*>(payload), reinterpret_cast<char*>(frame.data),
+                                          static_cast<int>(header.storedBytes), static_cast<int>(header.rawBytes));
+        if (decoded != static_cast<int>(header.rawBytes)) return false;
+#else
+        return false;
+#endif
+    } else {
+        return false;
+    }
+    
+    if (timestampNs) *timestampNs = ref.timestampNs;
+    return true;
+}
+
+} // namespace sar
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config.h"
+#include "mapped_file.h"
+
+namespace sar {
+
+// Lossless raw recording. A session is a run of chunk files
+// <base>_raw_0000.sarraw, _0001, ... each laid out as:
+//
+//   RawChunkHeader | record | record | ... | RawIndexEntry[count] | RawChunkFooter
+//
+// and every record is a RawFrameHeader followed by the frame's rows, LZ4-compressed
+// or stored. The footer makes frames randomly addressable; a chunk cut short by a
+// crash has none, and the reader rebuilds its index from the record headers.
+static constexpr char kRawChunkMagic[8] = {'S', 'A', 'R', 'R', 'A', 'W', '0', '1'};
+static constexpr char kRawIndexMagic[8] = {'S', 'A', 'R', 'I', 'D', 'X', '0', '1'};
+static constexpr uint32_t kRawFrameMagic = 0x314D5246;     // "FRM1"
+static constexpr uint32_t kRawVersion = 1;
+
+enum class RawCodec : uint32_t { Stored = 0, Lz4 = 1 };
+
+struct RawChunkHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t chunk;                     // Position in the session
+    uint32_t width;
+    uint32_t height;
+    int32_t type;                       // OpenCV type, e.g. CV_8UC3
+    uint32_t reserved;
+    double fps;
+    uint64_t firstFrame;
+    uint8_t padding[16];
+};
+
+struct RawFrameHeader {
+    uint32_t magic;
+    uint32_t codec;                     // RawCodec
+    uint64_t frameNumber;               // From the start of the session
+    int64_t timestampNs;                // Steady clock when the frame was queued
+    uint32_t storedBytes;               // Payload after this header
+    uint32_t rawBytes;                  // height * width * elemSize
+};
+
+struct RawIndexEntry {
+    uint64_t offset;                    // Of the RawFrameHeader
+    uint64_t frameNumber;
+    int64_t timestampNs;
+};
+
+struct RawChunkFooter {
+    uint64_t indexOffset;
+    uint64_t count;
+    char magic[8];
+};
+
+static_assert(sizeof(RawChunkHeader) == 64, "raw chunk header layout");
+static_assert(sizeof(RawFrameHeader) == 32, "raw frame header layout");
+static_assert(sizeof(RawIndexEntry) == 24, "raw index entry layout");
+static_assert(sizeof(RawChunkFooter) == 24, "raw chunk footer layout");
+
+class ChunkWriter;
+
+// Compresses frames on a worker pool and appends them, in order, to preallocated
+// chunk files from a single I/O thread (io_uring when built with liburing)
+class RawRecorder {
+public:
+    RawRecorder();
+    ~RawRecorder();
+    
+    // Files are named <baseName>_raw_NNNN.sarraw; geometry is taken from the first frame,
+    // and frames of another size are scaled to it
+    bool start(const std::string& baseName, double fps, const RecordingConfig& config);
+    void stop();
+    bool isRecording() const { return m_recording; }
+    
+    // Queues a reference to the frame (no copy); false if the pipeline is full
+    bool submit(const cv::Mat& frame);
+    
+    // Called from the writer thread with each chunk's path just before it is created
+    // (open true) and once it is finalised (false), so retention can leave it alone.
+    // Set before start().
+    using ChunkListener = std::function<void(const std::string& path, bool open)>;
+    void setChunkListener(ChunkListener listener) { m_chunkListener = std::move(listener); }
+    
+private:
+    struct Job {
+        cv::Mat frame;
+        uint64_t frameNumber;
+        int64_t timestampNs;
+    };
+    
+    void compressThread();
+    void writeThread();
+    bool openChunk();
+    void closeChunk();
+    
+    RecordingConfig m_config;
+    std::string m_baseName;
+    ChunkListener m_chunkListener;
+    int m_width = 0;
+    int m_height = 0;
+    int m_type = 0;
+    double m_fps = 0;
+    bool m_recording = false;
+    
+    // Frames waiting for a compression worker
+    std::vector<std::thread> m_workers;
+    int m_workerCount = 0;              // Fixed at start(); read by the writer, unlike m_workers
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobReady;
+    std::deque<Job> m_jobs;
+    bool m_stopping = false;
+    
+    // Compressed records, reordered by frame number for the writer
+    std::thread m_writer;
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneReady;
+    std::map<uint64_t, std::vector<uint8_t>> m_done;
+    std::vector<std::vector<uint8_t>> m_freeBuffers;   // Written records, reused by workers
+    int m_workersLeft = 0;
+    
+    uint64_t m_nextFrame = 0;           // Render thread only
+    std::atomic<int> m_inFlight{0};
+    
+    // Writer thread only
+    std::unique_ptr<ChunkWriter> m_chunk;
+    std::string m_chunkPath;
+    uint32_t m_chunkNumber = 0;
+    uint64_t m_chunkOffset = 0;
+    std::vector<RawIndexEntry> m_index;
+    uint64_t m_bytesWritten = 0;
+    uint64_t m_rawBytes = 0;
+    uint64_t m_framesWritten = 0;
+};
+
+// Random access to a raw session by frame number. Chunks are memory-mapped, so
+// opening is cheap and only the frames actually read are paged in.
+class RawReader {
+public:
+    // Accepts any chunk of a session and maps all of them
+    bool open(const std::string& path);
+    void close();
+    
+    uint64_t frameCount() const { return m_frames.size(); }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    double getFps() const { return m_fps; }
+    
+    // Decodes frame n (0-based, in recording order) into frame
+    bool read(uint64_t n, cv::Mat& frame, int64_t* timestampNs = nullptr) const;
+    
+private:
+    bool addChunk(const std::string& path);
+    
+    struct FrameRef {
+        const MappedFile* chunk;
+        uint64_t offset;
+        int64_t timestampNs;
+    };
+    
+    std::vector<std::unique_ptr<MappedFile>> m_chunks;
+    std::vector<FrameRef> m_frames;
+    int m_width = 0;
+    int m_height = 0;
+    int m_type = 0;
+    double m_fps = 0;
+};
+
+} // namespace sar
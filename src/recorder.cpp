@@ -1,11 +1,62 @@
 #include "recorder.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
 #include <iostream>
 #include <ctime>
+#include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace sar {
 
+static Counter& s_framesWritten = Metrics::instance().counter(
+    "sar_recorder_frames_total", "Frames handed to the video writer");
+static Counter& s_framesDropped = Metrics::instance().counter(
+    "sar_recorder_dropped_frames_total", "Frames skipped because an encoder queue was full");
+static Gauge& s_bytesWritten = Metrics::instance().gauge(
+    "sar_recorder_bytes_written", "Size of the current recording file");
+static Gauge& s_queueDepth = Metrics::instance().gauge(
+    "sar_recorder_queue_depth", "Frames waiting to be encoded");
+static Counter& s_segments = Metrics::instance().counter(
+    "sar_recorder_segments_total", "Recording segments closed and synced to disk");
+static Counter& s_retentionDeleted = Metrics::instance().counter(
+    "sar_recorder_retention_deleted_total", "Old recording files removed by the retention quotas");
+static Counter& s_failures = Metrics::instance().counter(
+    "sar_recorder_failures_total", "Recordings stopped because a segment could not be opened");
+static Histogram& s_writeTime = Metrics::instance().stage("record");
+static Histogram& s_syncTime = Metrics::instance().stage("record_sync");
+
+// How often (in frames) the output file size is sampled for the bytes metric
+static constexpr uint64_t kSizeSampleInterval = 30;
+
+// Flushes a finished file to stable storage; the I/O thread calls this once per segment
+static bool syncFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
 Recorder::Recorder() {}
 
 Recorder::~Recorder() {
@@ -15,13 +66,56 @@ Recorder::~Recorder() {
 void Recorder::init(const RecordingConfig& config) {
     m_config = config;
     
+    // Raw chunks are written in the same directory; retention must skip the open one
+    m_raw.setChunkListener([this](const std::string& path, bool open) {
+        const std::string name = std::filesystem::path(path).filename().string();
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        if (open) {
+            m_openFiles.insert(name);
+        } else {
+            m_openFiles.erase(name);
+        }
+    });
+    
     // Ensure output directory exists
     if (!m_config.output_dir.empty()) {
         std::filesystem::create_directories(m_config.output_dir);
     }
+    
+    m_parallel = m_config.encoder == "parallel";
+    if (m_parallel && !ParallelEncoder::available()) {
+        std::cout << "Recorder: built without FFmpeg, using the OpenCV writer instead of the parallel encoder" << std::endl;
+        m_parallel = false;
+    }
+}
+
+int Recorder::fourcc() const {
+    if (m_config.codec == "mp4v") {
+        return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+    } else if (m_config.codec == "avc1" || m_config.codec == "h264") {
+        return cv::VideoWriter::fourcc('a', 'v', 'c', '1');
+    } else if (m_config.codec == "xvid") {
+        return cv::VideoWriter::fourcc('X', 'V', 'I', 'D');
+    } else if (m_config.codec == "mjpg") {
+        return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    }
+    return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+}
+
+void Recorder::addStream(const std::string& label, bool fromHud, double scale) {
+    auto stream = std::make_unique<Stream>();
+    stream->label = label;
+    stream->fromHud = fromHud;
+    stream->scale = scale;
+    stream->primary = m_streams.empty();
+    m_streams.push_back(std::move(stream));
 }
 
 bool Recorder::start(int width, int height, double fps) {
+    // A recording whose rotation failed already reports stopped; tear it down first
+    if (m_recording && m_failed) {
+        stop();
+    }
     if (m_recording) {
         std::cout << "Already recording." << std::endl;
         return false;
@@ -37,31 +131,62 @@ bool Recorder::start(int width, int height, double fps) {
         return false;
     }
     
-    m_currentFilename = generateFilename();
-    
-    // Get codec fourcc
-    int fourcc;
-    if (m_config.codec == "mp4v") {
-        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
-    } else if (m_config.codec == "avc1" || m_config.codec == "h264") {
-        fourcc = cv::VideoWriter::fourcc('a', 'v', 'c', '1');
-    } else if (m_config.codec == "xvid") {
-        fourcc = cv::VideoWriter::fourcc('X', 'V', 'I', 'D');
-    } else if (m_config.codec == "mjpg") {
-        fourcc = cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+    // The first stream is the primary one; a single-stream recording keeps the plain name
+    m_streams.clear();
+    if (m_config.dual_stream) {
+        addStream("hud", true, 1.0);
+        addStream("clean", false, 1.0);
     } else {
-        fourcc = cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+        addStream("", m_config.include_hud, 1.0);
+    }
+    if (m_config.proxy_scale > 0.0 && m_config.proxy_scale < 1.0) {
+        addStream("proxy", true, m_config.proxy_scale);
     }
     
-    m_writer.open(m_currentFilename, fourcc, fps, cv::Size(width, height));
+    m_baseName = generateBaseName();
+    m_fps = fps;
+    m_framesPerSegment = m_config.segment_seconds > 0
+        ? static_cast<uint64_t>(std::max(1.0, std::round(m_config.segment_seconds * fps))) : 0;
     
-    if (!m_writer.isOpened()) {
-        std::cerr << "Failed to open video writer: " << m_currentFilename << std::endl;
-        return false;
+    for (auto& stream : m_streams) {
+        stream->size = cv::Size(width, height);
+        if (stream->scale != 1.0) {
+            // Even dimensions keep 4:2:0 encoders happy
+            stream->size = cv::Size(std::max(2, static_cast<int>(std::lround(width * stream->scale))) & ~1,
+                                    std::max(2, static_cast<int>(std::lround(height * stream->scale))) & ~1);
+        }
+        
+        if (!openSegment(*stream)) {
+            for (auto& opened : m_streams) {
+                closeSegment(*opened);
+            }
+            m_streams.clear();
+            return false;
+        }
     }
     
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_ioStopping = false;
+    }
+    m_ioThread = std::thread(&Recorder::ioThread, this);
+    
+    if (m_config.raw) {
+        m_raw.start(m_baseName, fps, m_config);
+    }
+    
+    // Encoders start only once every writer is open, so all streams begin on the same frame
+    for (auto& stream : m_streams) {
+        Stream* s = stream.get();
+        s->thread = std::thread([this, s] { encodeThread(*s); });
+    }
+    
+    m_failed = false;
     m_recording = true;
-    std::cout << "Recording started: " << m_currentFilename << std::endl;
+    m_currentFilename = m_streams.front()->filename;
+    for (const auto& stream : m_streams) {
+        std::cout << "Recording started: " << stream->filename << std::endl;
+    }
     
     return true;
 }
@@ -69,27 +194,262 @@ bool Recorder::start(int width, int height, double fps) {
 void Recorder::stop() {
     if (!m_recording) return;
     
-    m_writer.release();
+    for (auto& stream : m_streams) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->stopping = true;
+        stream->ready.notify_one();
+    }
+    for (auto& stream : m_streams) {
+        if (stream->thread.joinable()) {
+            stream->thread.join();
+        }
+        std::cout << "Recording stopped: " << stream->filename << std::endl;
+        closeSegment(*stream);
+    }
+    m_streams.clear();
+    m_raw.stop();
+    
+    // The I/O thread syncs the final segments before it exits
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_ioStopping = true;
+        m_ioReady.notify_one();
+    }
+    if (m_ioThread.joinable()) {
+        m_ioThread.join();
+    }
     m_recording = false;
+    s_queueDepth.set(0.0);
     
-    std::cout << "Recording stopped: " << m_currentFilename << std::endl;
     m_currentFilename.clear();
 }
 
-void Recorder::writeFrame(const cv::Mat& frame) {
-    if (!m_recording || !m_writer.isOpened()) return;
+void Recorder::writeFrame(const cv::Mat& clean, const cv::Mat& hud) {
+    if (!m_recording || m_failed) return;
+    
+    // The lossless stream has its own pipeline and drops independently
+    if (m_raw.isRecording()) {
+        m_raw.submit(clean);
+    }
+    
+    // Drop the frame from every stream or none, so the outputs stay frame-aligned
+    for (auto& stream : m_streams) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        if (static_cast<int>(stream->queue.size()) >= m_config.queue_frames) {
+            Trace::instant("recorder.drop");
+            s_framesDropped.inc();
+            return;
+        }
+    }
+    
+    for (auto& stream : m_streams) {
+        std::lock_guard<std::mutex> lock(stream->mutex);
+        stream->queue.push_back(stream->fromHud ? hud : clean);
+        stream->ready.notify_one();
+        m_queued++;
+    }
+    s_queueDepth.set(m_queued.load());
+}
+
+void Recorder::encodeThread(Stream& stream) {
+    applyThreadTopology("recorder");
+    
+    cv::Mat frame;
+    cv::Mat scaled;
+    uint64_t framesWritten = 0;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stream.mutex);
+            stream.ready.wait(lock, [&] { return stream.stopping || !stream.queue.empty(); });
+            if (stream.queue.empty()) break;    // Stopping and drained
+            frame = std::move(stream.queue.front());
+            stream.queue.pop_front();
+        }
+        m_queued--;
+        
+        bool accepted = true;
+        {
+            SAR_TRACE_SCOPE("recorder.write");
+            ScopedTimer timer(s_writeTime);
+            // Also catches a HUD frame the governor rendered at reduced resolution
+            if (frame.size() != stream.size) {
+                cv::resize(frame, scaled, stream.size, 0, 0, cv::INTER_AREA);
+                frame = scaled;
+            }
+            if (stream.encoder) {
+                accepted = stream.encoder->write(frame);
+            } else {
+                stream.writer.write(frame);
+            }
+        }
+        frame.release();
+        
+        if (accepted) {
+            s_framesWritten.inc();
+        } else {
+            // Every GOP encoder is behind; the frame is lost from this stream only, and
+            // still counts toward the segment so file splits stay aligned
+            Trace::instant("recorder.encoder_drop");
+            s_framesDropped.inc();
+        }
+        if (stream.primary && ++framesWritten % kSizeSampleInterval == 0) {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(stream.filename, ec);
+            if (!ec) s_bytesWritten.set(static_cast<double>(size));
+        }
+        
+        // Every stream splits at the same frame count, and a fresh writer always
+        // starts on a keyframe, so segments line up across streams
+        if (m_framesPerSegment > 0 && ++stream.segmentFrames >= m_framesPerSegment) {
+            SAR_TRACE_SCOPE("recorder.rotate");
+            closeSegment(stream);
+            stream.segment++;
+            if (!openSegment(stream)) {
+                // Streams must stay segment-aligned, so the whole recording ends here;
+                // isRecording() turns false and the next stop()/start() cleans up
+                std::cerr << "Recording failed: could not start segment " << stream.segment << std::endl;
+                Trace::instant("recorder.failed");
+                s_failures.inc();
+                m_failed = true;
+                break;
+            }
+        }
+    }
+}
+
+bool Recorder::openSegment(Stream& stream) {
+    std::stringstream ss;
+    ss << m_baseName;
+    if (!stream.label.empty()) ss << "_" << stream.label;
+    if (m_framesPerSegment > 0) ss << "_" << std::setw(4) << std::setfill('0') << stream.segment;
+    ss << "." << m_config.format;
+    stream.filename = ss.str();
+    stream.segmentFrames = 0;
+    
+    const std::string name = std::filesystem::path(stream.filename).filename().string();
+    {
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_openFiles.insert(name);
+    }
     
-    m_writer.write(frame);
+    bool opened = false;
+    if (m_parallel) {
+        stream.encoder = std::make_unique<ParallelEncoder>();
+        opened = stream.encoder->open(stream.filename, m_fps, stream.size, m_config);
+        if (!opened) stream.encoder.reset();
+    } else {
+        stream.writer.open(stream.filename, fourcc(), m_fps, stream.size);
+        opened = stream.writer.isOpened();
+    }
+    if (!opened) {
+        std::cerr << "Failed to open video writer: " << stream.filename << std::endl;
+        std::lock_guard<std::mutex> lock(m_ioMutex);
+        m_openFiles.erase(name);
+        return false;
+    }
+    return true;
 }
 
-std::string Recorder::generateFilename() {
+void Recorder::closeSegment(Stream& stream) {
+    if (stream.encoder) {
+        // Waits for the GOPs still encoding, then writes the index
+        stream.encoder->release();
+        stream.encoder.reset();
+    } else if (stream.writer.isOpened()) {
+        // release() writes the container index; syncing is left to the I/O thread
+        stream.writer.release();
+    } else {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_ioMutex);
+    m_openFiles.erase(std::filesystem::path(stream.filename).filename().string());
+    m_closedSegments.push_back(stream.filename);
+    m_ioReady.notify_one();
+}
+
+void Recorder::ioThread() {
+    applyThreadTopology("recorder_io");
+    
+    applyRetention();
+    
+    while (true) {
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(m_ioMutex);
+            m_ioReady.wait(lock, [&] { return m_ioStopping || !m_closedSegments.empty(); });
+            if (m_closedSegments.empty()) break;    // Stopping and drained
+            path = std::move(m_closedSegments.front());
+            m_closedSegments.pop_front();
+        }
+        
+        {
+            SAR_TRACE_SCOPE("recorder.sync");
+            ScopedTimer timer(s_syncTime);
+            if (!syncFile(path)) {
+                std::cerr << "Recorder: could not sync " << path << std::endl;
+            }
+        }
+        s_segments.inc();
+        applyRetention();
+    }
+}
+
+void Recorder::applyRetention() {
+    if (m_config.max_size_gb <= 0 && m_config.max_age_hours <= 0) return;
+    
+    struct Entry {
+        std::filesystem::path path;
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+    };
+    std::vector<Entry> entries;
+    uintmax_t total = 0;
+    
+    std::error_code ec;
+    for (const auto& item : std::filesystem::directory_iterator(m_config.output_dir, ec)) {
+        if (!item.is_regular_file(ec)) continue;
+        const std::string name = item.path().filename().string();
+        if (name.rfind("sar_", 0) != 0) continue;   // Only files this recorder made
+        
+        Entry entry{item.path(), item.last_write_time(ec), item.file_size(ec)};
+        if (ec) continue;
+        total += entry.size;
+        entries.push_back(entry);
+    }
+    
+    // Oldest first
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    
+    const uintmax_t maxBytes = static_cast<uintmax_t>(m_config.max_size_gb * 1024.0 * 1024.0 * 1024.0);
+    const auto now = std::filesystem::file_time_type::clock::now();
+    const auto maxAge = std::chrono::duration_cast<std::filesystem::file_time_type::duration>(
+        std::chrono::duration<double, std::ratio<3600>>(m_config.max_age_hours));
+    
+    for (const auto& entry : entries) {
+        bool overSize = maxBytes > 0 && total > maxBytes;
+        bool tooOld = m_config.max_age_hours > 0 && now - entry.time > maxAge;
+        if (!overSize && !tooOld) break;
+        
+        {
+            std::lock_guard<std::mutex> lock(m_ioMutex);
+            if (m_openFiles.count(entry.path.filename().string())) continue;
+        }
+        if (std::filesystem::remove(entry.path, ec)) {
+            total -= entry.size;
+            s_retentionDeleted.inc();
+            std::cout << "Recorder: retention removed " << entry.path.string() << std::endl;
+        }
+    }
+}
+
+std::string Recorder::generateBaseName() {
     auto now = std::time(nullptr);
     auto tm = std::localtime(&now);
     
     std::stringstream ss;
     ss << m_config.output_dir << "/sar_";
     ss << std::put_time(tm, "%Y%m%d_%H%M%S");
-    ss << "." << m_config.format;
     
     return ss.str();
 }
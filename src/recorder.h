@@ -1,12 +1,27 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <set>
+#include <thread>
+#include <vector>
 #include <filesystem>
 #include "config.h"
+#include "raw_recorder.h"
+#include "parallel_encoder.h"
 
 namespace sar {
 
+// Session recorder. Each output stream (HUD, clean, proxy) has its own encoder
+// thread and queue; the render loop only queues references to its frames. With
+// segmenting, a separate I/O thread fsyncs each finished segment and enforces the
+// output directory quotas.
 class Recorder {
 public:
     Recorder();
@@ -14,21 +29,68 @@ public:
     
     void init(const RecordingConfig& config);
     
+    // Opens every configured stream before any starts encoding, so they share a start frame
     bool start(int width, int height, double fps);
+    
+    // Drains the queues, then closes all streams together
     void stop();
     
-    void writeFrame(const cv::Mat& frame);
+    // Queues the frame pair for the enabled streams. The Mats are shared, not copied,
+    // so the caller must not draw into them afterwards (reassigning is fine).
+    void writeFrame(const cv::Mat& clean, const cv::Mat& hud);
     
-    bool isRecording() const { return m_recording; }
+    // False once a segment rotation has failed, even before stop() is called
+    bool isRecording() const { return m_recording && !m_failed; }
     std::string getCurrentFilename() const { return m_currentFilename; }
     
 private:
-    std::string generateFilename();
+    struct Stream {
+        std::string label;
+        bool fromHud = true;            // HUD-burned or clean source frame
+        double scale = 1.0;
+        cv::Size size;
+        bool primary = false;           // Sampled for the bytes-written metric
+        std::string filename;
+        int segment = 0;
+        uint64_t segmentFrames = 0;
+        cv::VideoWriter writer;
+        std::unique_ptr<ParallelEncoder> encoder;   // Instead of writer with encoder "parallel"
+        std::thread thread;
+        
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<cv::Mat> queue;
+        bool stopping = false;
+    };
+    
+    void addStream(const std::string& label, bool fromHud, double scale);
+    bool openSegment(Stream& stream);
+    void closeSegment(Stream& stream);
+    void encodeThread(Stream& stream);
+    void ioThread();
+    void applyRetention();
+    int fourcc() const;
+    std::string generateBaseName();
     
     RecordingConfig m_config;
-    cv::VideoWriter m_writer;
+    bool m_parallel = false;            // GOP-parallel libav encoder instead of cv::VideoWriter
+    std::vector<std::unique_ptr<Stream>> m_streams;
     bool m_recording = false;
+    std::atomic<bool> m_failed{false};  // Set by an encoder thread whose rotation failed
     std::string m_currentFilename;
+    std::string m_baseName;
+    double m_fps = 0;
+    uint64_t m_framesPerSegment = 0;    // 0 = one file per stream
+    std::atomic<int> m_queued{0};
+    RawRecorder m_raw;
+    
+    // Finished segments waiting for fsync, and files retention must not touch
+    std::thread m_ioThread;
+    std::mutex m_ioMutex;
+    std::condition_variable m_ioReady;
+    std::deque<std::string> m_closedSegments;
+    std::set<std::string> m_openFiles;      // File names being written
+    bool m_ioStopping = false;
 };
 
 } // namespace sar
@@ -0,0 +1,356 @@
+#include "replay.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace sar {
+
+static Counter& s_replayFrames = Metrics::instance().counter(
+    "sar_replay_frames_total", "Live frames encoded into the replay cache");
+static Counter& s_replayDropped = Metrics::instance().counter(
+    "sar_replay_dropped_frames_total", "Live frames skipped because the replay encoders were busy");
+static Gauge& s_replayBytes = Metrics::instance().gauge(
+    "sar_replay_buffer_bytes", "Memory held by the replay cache");
+static Gauge& s_replaySeconds = Metrics::instance().gauge(
+    "sar_replay_buffer_seconds", "How far back the replay cache reaches");
+static Histogram& s_encodeTime = Metrics::instance().stage("replay_encode");
+
+// SDL_HAT_* bit values; the joystick state stores SDL's raw hat byte
+static constexpr uint8_t kHatUp = 0x01;
+static constexpr uint8_t kHatRight = 0x02;
+static constexpr uint8_t kHatDown = 0x04;
+static constexpr uint8_t kHatLeft = 0x08;
+
+// A held hat steps once, then scrubs continuously after this delay
+static constexpr double kScrubRepeatDelay = 0.4;
+
+// The cursor must rest this long before the full-resolution frame is decoded
+static constexpr double kDecodeRestSeconds = 0.08;
+
+Replay::Replay() {}
+
+Replay::~Replay() {
+    shutdown();
+}
+
+bool Replay::init(const ReplayConfig& config) {
+    m_config = config;
+    if (!config.enabled) return false;
+    
+    m_budgetBytes = static_cast<size_t>(std::max(16, config.budget_mb)) << 20;
+    m_running = true;
+    for (int i = 0; i < std::max(1, config.workers); i++) {
+        m_workers.emplace_back(&Replay::workerThread, this);
+    }
+    
+    std::cout << "Instant replay: " << (m_budgetBytes >> 20) << " MB cache, hat " << config.hat << " scrubs" << std::endl;
+    return true;
+}
+
+void Replay::shutdown() {
+    if (!m_running) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_jobs.clear();
+    m_decoded.release();
+    m_bytes = 0;
+    m_active = false;
+}
+
+void Replay::push(const cv::Mat& frame, uint64_t sequence) {
+    if (!m_running || frame.empty()) return;
+    
+    auto now = std::chrono::steady_clock::now();
+    if (m_lastPush.time_since_epoch().count() != 0) {
+        double interval = std::chrono::duration<double>(now - m_lastPush).count();
+        if (interval > 0) m_fps = m_fps * 0.95 + (1.0 / interval) * 0.05;
+    }
+    m_lastPush = now;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        
+        if (!m_entries.empty() && sequence <= m_entries.back().sequence) {
+            std::cout << "Replay: frame sequence restarted, clearing " << m_entries.size() << " cached frames"
+                      << std::endl;
+            clear();
+        }
+        
+        // Never queue behind the encoders; a skipped frame only makes scrubbing coarser
+        if (m_jobs.size() >= m_workers.size() * 2) {
+            s_replayDropped.inc();
+            return;
+        }
+        m_entries.push_back(Entry{sequence, now, {}, cv::Mat(), 0});
+        m_jobs.push_back(Job{sequence, frame, m_generation});
+    }
+    m_wake.notify_one();
+}
+
+void Replay::workerThread() {
+    applyThreadTopology("replay");
+    
+    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, m_config.quality};
+    std::vector<uint8_t> jpeg;
+    cv::Mat thumbnail;
+    
+    while (true) {
+        Job job;
+        uint64_t decode = 0;
+        uint64_t generation = 0;
+        std::vector<uint8_t> compressed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] {
+                return !m_running || !m_jobs.empty() ||
+                       (m_decodeWanted != m_decodedSequence && m_decodeWanted != m_decoding);
+            });
+            if (!m_running) break;
+            
+            // A decode the operator is waiting for goes ahead of background encodes
+            if (m_decodeWanted != m_decodedSequence && m_decodeWanted != m_decoding) {
+                size_t index = findIndex(m_decodeWanted);
+                if (index < m_entries.size() && m_entries[index].sequence == m_decodeWanted &&
+                    !m_entries[index].jpeg.empty()) {
+                    decode = m_decodeWanted;
+                    m_decoding = decode;
+                    compressed = m_entries[index].jpeg;
+                } else if (m_jobs.empty()) {
+                    // Evicted or never encoded; the thumbnail is all there is
+                    m_decodedSequence = m_decodeWanted;
+                    m_decoded.release();
+                    continue;
+                }
+            }
+            if (!decode) {
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+            generation = decode ? m_generation : job.generation;
+        }
+        
+        if (decode) {
+            SAR_TRACE_SCOPE("replay.decode");
+            cv::Mat full = cv::imdecode(compressed, cv::IMREAD_COLOR);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (generation != m_generation) continue;     // Ring cleared meanwhile
+            m_decoded = full;
+            m_decodedSequence = decode;
+            m_decoding = 0;
+            continue;
+        }
+        
+        {
+            SAR_TRACE_SCOPE("replay.encode");
+            ScopedTimer timer(s_encodeTime);
+            cv::imencode(".jpg", job.frame, jpeg, params);
+            int width = std::min(m_config.thumbnail_width, job.frame.cols);
+            int height = std::max(1, job.frame.rows * width / std::max(1, job.frame.cols));
+            cv::resize(job.frame, thumbnail, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+            job.frame.release();
+        }
+        
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t index = findIndex(job.sequence);
+        // After a clear() the same sequence number can belong to a different frame
+        if (generation == m_generation && index < m_entries.size() && m_entries[index].sequence == job.sequence) {
+            Entry& entry = m_entries[index];
+            entry.jpeg.swap(jpeg);
+            entry.thumbnail = thumbnail;
+            thumbnail = cv::Mat();
+            entry.bytes = entry.jpeg.size() + entry.thumbnail.total() * entry.thumbnail.elemSize();
+            m_bytes += entry.bytes;
+            evict();
+        }
+        jpeg.clear();
+        s_replayFrames.inc();
+    }
+}
+
+void Replay::evict() {
+    while (m_bytes > m_budgetBytes && m_entries.size() > 1) {
+        m_bytes -= m_entries.front().bytes;
+        m_entries.pop_front();
+    }
+    s_replayBytes.set(static_cast<double>(m_bytes));
+    s_replaySeconds.set(std::chrono::duration<double>(m_entries.back().time - m_entries.front().time).count());
+}
+
+void Replay::clear() {
+    m_entries.clear();
+    m_jobs.clear();
+    m_bytes = 0;
+    m_generation++;
+    m_decodeWanted = 0;
+    m_decoding = 0;
+    m_decodedSequence = 0;
+    m_decoded.release();
+    m_active = false;
+    s_replayBytes.set(0.0);
+    s_replaySeconds.set(0.0);
+}
+
+size_t Replay::findIndex(uint64_t sequence) const {
+    if (m_entries.empty()) return 0;
+    auto it = std::upper_bound(m_entries.begin(), m_entries.end(), sequence,
+                               [](uint64_t s, const Entry& e) { return s < e.sequence; });
+    return it == m_entries.begin() ? 0 : static_cast<size_t>(it - m_entries.begin()) - 1;
+}
+
+void Replay::update(const std::vector<uint8_t>& hats, double dt) {
+    if (!m_running) return;
+    
+    uint8_t hat = m_config.hat >= 0 && m_config.hat < static_cast<int>(hats.size()) ? hats[m_config.hat] : 0;
+    uint8_t pressed = hat & ~m_lastHat;
+    m_lastHat = hat;
+    
+    // Each press is a single frame-accurate step; holding scrubs at scrub_speed
+    if (pressed & kHatLeft) step(-1);
+    if (pressed & kHatRight) step(1);
+    if (pressed & kHatDown) jump(-m_config.jump_seconds);
+    if (pressed & kHatUp) jump(m_config.jump_seconds);
+    
+    int direction = (hat & kHatLeft) ? -1 : (hat & kHatRight) ? 1 : 0;
+    if (direction != 0 && m_active) {
+        m_heldSeconds += dt;
+        if (m_heldSeconds > kScrubRepeatDelay) {
+            m_scrubFrames += dt * m_fps * m_config.scrub_speed;
+            int frames = static_cast<int>(m_scrubFrames);
+            if (frames > 0) {
+                m_scrubFrames -= frames;
+                moveCursor(direction * frames);
+            }
+        }
+    } else {
+        m_heldSeconds = 0;
+        m_scrubFrames = 0;
+    }
+    
+    // Ask for the full-resolution frame once the cursor settles
+    if (m_active && hat == 0) {
+        m_restSeconds += dt;
+        if (m_restSeconds >= kDecodeRestSeconds) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_decodeWanted != m_cursor) {
+                m_decodeWanted = m_cursor;
+                m_wake.notify_one();
+            }
+        }
+    }
+}
+
+void Replay::step(int frames) {
+    if (!m_running) return;
+    
+    if (!m_active) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.empty()) return;
+        m_cursor = m_entries.back().sequence;
+        m_active = true;
+        Trace::instant("replay.enter");
+    }
+    moveCursor(frames);
+}
+
+void Replay::goLive() {
+    if (!m_active) return;
+    m_active = false;
+    Trace::instant("replay.live");
+}
+
+void Replay::moveCursor(int frames) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.empty()) return;
+    
+    long index = static_cast<long>(findIndex(m_cursor)) + frames;
+    index = std::clamp(index, 0L, static_cast<long>(m_entries.size()) - 1);
+    m_cursor = m_entries[static_cast<size_t>(index)].sequence;
+    m_restSeconds = 0;
+}
+
+void Replay::jump(double seconds) {
+    if (!m_active) step(0);
+    if (!m_active) return;
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = findIndex(m_cursor);
+    auto target = m_entries[index].time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(seconds));
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), target,
+                               [](const Entry& e, std::chrono::steady_clock::time_point t) { return e.time < t; });
+    if (it == m_entries.end()) --it;
+    m_cursor = it->sequence;
+    m_restSeconds = 0;
+}
+
+bool Replay::render(cv::Mat& out, cv::Size size) {
+    if (!m_active) return false;
+    
+    cv::Mat source;
+    bool exact = false;
+    double behind = 0;
+    double position = 1.0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_entries.empty()) return false;
+        
+        // The cursor's entry may have been evicted; hold on to the oldest one instead
+        size_t index = findIndex(m_cursor);
+        const Entry& entry = m_entries[index];
+        m_cursor = entry.sequence;
+        
+        if (m_decodedSequence == m_cursor && !m_decoded.empty()) {
+            source = m_decoded;
+            exact = true;
+        } else {
+            source = entry.thumbnail;
+        }
+        
+        double span = std::chrono::duration<double>(m_entries.back().time - m_entries.front().time).count();
+        behind = std::chrono::duration<double>(m_entries.back().time - entry.time).count();
+        position = span > 0 ? 1.0 - behind / span : 1.0;
+    }
+    
+    {
+        SAR_TRACE_SCOPE("replay.render");
+        if (source.empty()) {
+            out.create(size, CV_8UC3);
+            out.setTo(cv::Scalar(0, 0, 0));
+        } else if (source.size() == size) {
+            source.copyTo(out);
+        } else {
+            cv::resize(source, out, size, 0, 0, exact ? cv::INTER_AREA : cv::INTER_LINEAR);
+        }
+        
+        // Banner and timeline in red, so a replay is never mistaken for the live feed
+        const cv::Scalar red(0, 0, 255);
+        char text[64];
+        std::snprintf(text, sizeof(text), "REPLAY  -%.1fs%s", behind, exact ? "" : "  SCRUB");
+        cv::putText(out, text, cv::Point(20, 40), cv::FONT_HERSHEY_SIMPLEX, 0.9, red, 2, cv::LINE_AA);
+        
+        int left = 20;
+        int right = out.cols - 20;
+        int y = out.rows - 24;
+        cv::rectangle(out, cv::Point(left, y - 4), cv::Point(right, y + 4), red, 1);
+        int x = left + static_cast<int>(std::lround((right - left) * position));
+        cv::rectangle(out, cv::Point(x - 3, y - 9), cv::Point(x + 3, y + 9), red, cv::FILLED);
+    }
+    return true;
+}
+
+} // namespace sar
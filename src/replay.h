@@ -0,0 +1,95 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "config.h"
+
+namespace sar {
+
+// Instant replay. Every live frame is JPEG-encoded by a small worker pool into a
+// memory-budgeted ring, together with a small uncompressed thumbnail. Scrubbing
+// shows the thumbnails immediately; once the cursor rests, the exact frame is
+// decoded at full resolution in the background. Capture and recording carry on
+// live the whole time.
+class Replay {
+public:
+    Replay();
+    ~Replay();
+    
+    bool init(const ReplayConfig& config);
+    void shutdown();
+    
+    // Render thread: caches a reference to the live frame (encoded off-thread). A
+    // sequence that goes backwards (source or frame-bus writer restarted) starts a
+    // new ring, since the old frames can no longer be ordered against the new ones.
+    void push(const cv::Mat& frame, uint64_t sequence);
+    
+    // Render thread, once per tick: hat left/right scrubs, up/down jumps
+    void update(const std::vector<uint8_t>& hats, double dt);
+    
+    // Keyboard/button controls; stepping enters replay from live
+    void step(int frames);
+    void goLive();
+    bool isActive() const { return m_active; }
+    
+    // Draws the frame under the cursor, sized like the live view, with the replay banner
+    bool render(cv::Mat& out, cv::Size size);
+    
+private:
+    struct Entry {
+        uint64_t sequence;
+        std::chrono::steady_clock::time_point time;
+        std::vector<uint8_t> jpeg;      // Empty until encoded
+        cv::Mat thumbnail;
+        size_t bytes = 0;
+    };
+    
+    struct Job {
+        uint64_t sequence;
+        cv::Mat frame;
+        uint64_t generation;
+    };
+    
+    void workerThread();
+    void evict();
+    void clear();                                  // Lock held
+    size_t findIndex(uint64_t sequence) const;     // Nearest entry at or before; lock held
+    void moveCursor(int frames);
+    void jump(double seconds);
+    
+    ReplayConfig m_config;
+    size_t m_budgetBytes = 0;
+    
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Entry> m_entries;        // Oldest first, ascending sequence
+    size_t m_bytes = 0;
+    std::deque<Job> m_jobs;
+    uint64_t m_generation = 0;          // Bumped by clear(); work from before it is discarded
+    uint64_t m_decodeWanted = 0;        // Sequence the render thread wants at full resolution
+    uint64_t m_decoding = 0;
+    uint64_t m_decodedSequence = 0;
+    cv::Mat m_decoded;
+    
+    std::vector<std::thread> m_workers;
+    std::atomic<bool> m_running{false};
+    
+    // Render thread only
+    bool m_active = false;
+    uint64_t m_cursor = 0;
+    uint8_t m_lastHat = 0;
+    double m_heldSeconds = 0;
+    double m_scrubFrames = 0;           // Fractional frames accumulated while held
+    double m_restSeconds = 0;
+    double m_fps = 30.0;                // Smoothed live rate, for scrub speed
+    std::chrono::steady_clock::time_point m_lastPush;
+};
+
+} // namespace sar
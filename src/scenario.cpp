@@ -0,0 +1,367 @@
+#include "scenario.h"
+#include "geo.h"
+#include "metrics.h"
+#include "trace.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace sar {
+
+using json = nlohmann::json;
+
+static constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+static constexpr double kMetresPerDegree = 111195.08;     // Of latitude, on the mean-radius sphere
+
+// Mip levels stop halving at this size
+static constexpr int kMinLevelSize = 2;
+
+static Gauge& s_visible = Metrics::instance().gauge(
+    "sar_scenario_visible_targets", "Scenario targets drawn into the last frame");
+static Counter& s_truthRecords = Metrics::instance().counter(
+    "sar_scenario_truth_records_total", "Ground-truth rows logged for drawn scenario targets");
+static Counter& s_overBudget = Metrics::instance().counter(
+    "sar_scenario_over_budget_total", "Frames whose target compositing exceeded budget_ms");
+static Histogram& s_compositeTime = Metrics::instance().stage("scenario");
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Scenario::Scenario() {}
+
+Scenario::~Scenario() {
+    shutdown();
+}
+
+bool Scenario::init(const ScenarioConfig& config) {
+    m_config = config;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    if (m_config.file.empty()) {
+        std::cerr << "Scenario: no file set, target injection disabled" << std::endl;
+        return false;
+    }
+    
+    if (!loadScenario(m_config.file)) {
+        m_sprites.clear();
+        m_targets.clear();
+        return false;
+    }
+    
+    openGroundTruth();
+    restart();
+    m_active = true;
+    
+    std::cout << "Scenario: " << m_targets.size() << " target(s), " << m_sprites.size()
+              << " sprite(s) from " << m_config.file << std::endl;
+    return true;
+}
+
+void Scenario::shutdown() {
+    if (!m_active) return;
+    m_active = false;
+    
+    if (m_truth.is_open()) {
+        m_truth.close();
+        std::cout << "Scenario: ground truth written to " << m_truthPath << std::endl;
+    }
+    s_visible.set(0);
+}
+
+void Scenario::restart() {
+    m_epochNs = steadyNs();
+    if (m_active) {
+        std::cout << "Scenario clock restarted" << std::endl;
+    }
+}
+
+bool Scenario::loadScenario(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Scenario: cannot open " << path << std::endl;
+        return false;
+    }
+    
+    // Sprite images are relative to the scenario file
+    const std::filesystem::path base = std::filesystem::path(path).parent_path();
+    auto resolve = [&](const std::string& name) {
+        std::filesystem::path p(name);
+        return (p.is_relative() ? base / p : p).string();
+    };
+    
+    try {
+        json j = json::parse(file);
+        
+        if (j.contains("sprites")) {
+            for (auto& [name, s] : j["sprites"].items()) {
+                if (!s.contains("image")) {
+                    std::cerr << "Scenario: sprite '" << name << "' has no image" << std::endl;
+                    return false;
+                }
+                double metres = s.contains("metres") ? s["metres"].get<double>() : 1.0;
+                if (!loadSprite(name, resolve(s["image"].get<std::string>()), metres)) {
+                    return false;
+                }
+            }
+        }
+        
+        if (j.contains("targets")) {
+            for (auto& t : j["targets"]) {
+                Target target;
+                if (t.contains("id")) target.id = t["id"].get<std::string>();
+                if (target.id.empty()) target.id = "t" + std::to_string(m_targets.size() + 1);
+                
+                std::string sprite = t.contains("sprite") ? t["sprite"].get<std::string>() : "";
+                auto it = std::find_if(m_sprites.begin(), m_sprites.end(),
+                                       [&](const Sprite& s) { return s.name == sprite; });
+                if (it == m_sprites.end()) {
+                    std::cerr << "Scenario: target '" << target.id << "' uses unknown sprite '" << sprite << "'" << std::endl;
+                    return false;
+                }
+                target.sprite = static_cast<int>(it - m_sprites.begin());
+                
+                if (t.contains("start")) target.start = t["start"].get<double>();
+                if (t.contains("end")) target.end = t["end"].get<double>();
+                if (t.contains("fade")) target.fade = t["fade"].get<double>();
+                if (t.contains("scale")) target.scale = t["scale"].get<double>();
+                if (t.contains("opacity")) target.opacity = std::clamp(t["opacity"].get<double>(), 0.0, 1.0);
+                
+                // World positions and drift are [north, east]; frame ones [x, y]
+                std::vector<double> drift = t.contains("drift") ? t["drift"].get<std::vector<double>>()
+                                                                : std::vector<double>();
+                drift.resize(2, 0.0);
+                if (t.contains("world")) {
+                    auto p = t["world"].get<std::vector<double>>();
+                    if (p.size() < 2) {
+                        std::cerr << "Scenario: target '" << target.id << "' world needs [latitude, longitude]" << std::endl;
+                        return false;
+                    }
+                    target.world = true;
+                    target.y = p[0];
+                    target.x = p[1];
+                    target.driftY = drift[0];
+                    target.driftX = drift[1];
+                } else {
+                    auto p = t.contains("frame") ? t["frame"].get<std::vector<double>>() : std::vector<double>();
+                    p.resize(2, 0.5);
+                    target.x = p[0];
+                    target.y = p[1];
+                    target.driftX = drift[0];
+                    target.driftY = drift[1];
+                }
+                m_targets.push_back(target);
+            }
+        }
+    } catch (const json::exception& e) {
+        std::cerr << "Scenario: error parsing " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    
+    if (m_targets.empty()) {
+        std::cerr << "Scenario: " << path << " has no targets" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Scenario::loadSprite(const std::string& name, const std::string& path, double metres) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_UNCHANGED);
+    if (image.empty()) {
+        std::cerr << "Scenario: cannot read sprite image " << path << std::endl;
+        return false;
+    }
+    
+    if (image.depth() == CV_16U) {
+        image.convertTo(image, CV_8U, 1.0 / 257.0);
+    } else if (image.depth() != CV_8U) {
+        image.convertTo(image, CV_8U);
+    }
+    if (image.channels() == 1) {
+        cv::cvtColor(image, image, cv::COLOR_GRAY2BGRA);
+    } else if (image.channels() == 3) {
+        cv::cvtColor(image, image, cv::COLOR_BGR2BGRA);
+    }
+    
+    Sprite sprite;
+    sprite.name = name;
+    sprite.metres = metres;
+    
+    // Premultiplied, so resampling never bleeds the colour of transparent pixels
+    // into the edge and blending is one multiply and one add
+    std::vector<cv::Mat> channels;
+    cv::split(image, channels);
+    Level full;
+    full.alpha = channels[3];
+    channels.pop_back();
+    cv::merge(channels, full.color);
+    cv::Mat alpha3;
+    cv::cvtColor(full.alpha, alpha3, cv::COLOR_GRAY2BGR);
+    cv::multiply(full.color, alpha3, full.color, 1.0 / 255.0);
+    sprite.levels.push_back(full);
+    
+    // Each level is Gaussian-filtered and halved, so a distant target is never
+    // sampled from more than twice its drawn size
+    while (std::min(sprite.levels.back().color.cols, sprite.levels.back().color.rows) > kMinLevelSize) {
+        Level next;
+        cv::pyrDown(sprite.levels.back().color, next.color);
+        cv::pyrDown(sprite.levels.back().alpha, next.alpha);
+        sprite.levels.push_back(next);
+    }
+    
+    m_sprites.push_back(sprite);
+    return true;
+}
+
+void Scenario::openGroundTruth() {
+    if (m_config.ground_truth_dir.empty()) return;
+    
+    std::error_code ec;
+    std::filesystem::create_directories(m_config.ground_truth_dir, ec);
+    
+    auto now = std::time(nullptr);
+    auto tm = std::localtime(&now);
+    std::stringstream ss;
+    ss << m_config.ground_truth_dir << "/truth_" << std::put_time(tm, "%Y%m%d_%H%M%S") << ".csv";
+    m_truthPath = ss.str();
+    
+    m_truth.open(m_truthPath);
+    if (!m_truth.is_open()) {
+        std::cerr << "Scenario: cannot write ground truth to " << m_truthPath << std::endl;
+        return;
+    }
+    m_truth << std::fixed;
+    m_truth << "unix_ms,sequence,scenario_s,id,sprite,x,y,width,height,opacity,latitude,longitude\n";
+}
+
+void Scenario::composite(cv::Mat& frame, const Level& level, double left, double top, double scaleX,
+                         double scaleY, double opacity, cv::Rect& drawn) {
+    const int x0 = static_cast<int>(std::floor(left));
+    const int y0 = static_cast<int>(std::floor(top));
+    const int x1 = static_cast<int>(std::ceil(left + level.color.cols * scaleX));
+    const int y1 = static_cast<int>(std::ceil(top + level.color.rows * scaleY));
+    drawn = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (drawn.empty()) return;
+    
+    // Sprite pixel centres onto the clipped rectangle; the fractional offset keeps
+    // slow drift smooth instead of stepping a whole pixel at a time
+    const cv::Matx23d warp(scaleX, 0.0, left - drawn.x + 0.5 * scaleX - 0.5,
+                           0.0, scaleY, top - drawn.y + 0.5 * scaleY - 0.5);
+    cv::warpAffine(level.color, m_color, warp, drawn.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar());
+    cv::warpAffine(level.alpha, m_alpha, warp, drawn.size(), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar());
+    
+    // out = color * opacity + out * (255 - alpha * opacity) / 255, on OpenCV's
+    // vectorised 8-bit arithmetic and only inside the target's rectangle
+    if (opacity < 1.0) {
+        m_color.convertTo(m_color, -1, opacity);
+    }
+    m_alpha.convertTo(m_inverse, CV_8U, -opacity, 255.0);
+    cv::cvtColor(m_inverse, m_inverse3, cv::COLOR_GRAY2BGR);
+    cv::Mat out = frame(drawn);
+    cv::multiply(out, m_inverse3, out, 1.0 / 255.0);
+    cv::add(out, m_color, out);
+}
+
+void Scenario::apply(cv::Mat& frame, const GimbalState& gimbal, const PlatformTelemetry* platform,
+                     const PlaybackStatus* playback, uint64_t sequence) {
+    if (!m_active || frame.empty() || frame.type() != CV_8UC3) return;
+    
+    SAR_TRACE_SCOPE("scenario");
+    ScopedTimer timer(s_compositeTime);
+    auto start = std::chrono::steady_clock::now();
+    
+    // Recorded footage follows the file position, so a scenario replays with it
+    const double now = playback ? playback->positionSeconds : (steadyNs() - m_epochNs.load()) / 1e9;
+    const int64_t unixMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    
+    // Reported gimbal angles win over the simulated ones, as for the ground point
+    const float pan = platform && platform->hasGimbal ? platform->gimbalPan : gimbal.pan;
+    const float tilt = platform && platform->hasGimbal ? platform->gimbalTilt : gimbal.tilt;
+    const double aspect = static_cast<double>(frame.rows) / frame.cols;
+    const double focal = frame.cols * 0.5 / std::tan(std::max(gimbal.hfov, 0.01f) * 0.5 * kDegToRad);
+    
+    int visible = 0;
+    for (const Target& target : m_targets) {
+        const bool bounded = target.end > target.start;
+        if (now < target.start || (bounded && now >= target.end)) continue;
+        
+        const double age = now - target.start;
+        double opacity = target.opacity;
+        if (target.fade > 0.0) {
+            opacity *= std::min(1.0, age / target.fade);
+            if (bounded) opacity *= std::min(1.0, (target.end - now) / target.fade);
+        }
+        if (opacity < 1.0 / 255.0) continue;
+        
+        const Sprite& sprite = m_sprites[target.sprite];
+        const cv::Mat& full = sprite.levels.front().color;
+        
+        double cx, cy, width;
+        double latitude = 0.0, longitude = 0.0;
+        if (target.world) {
+            if (!platform) continue;
+            latitude = target.y + target.driftY * age / kMetresPerDegree;
+            longitude = target.x + target.driftX * age / (kMetresPerDegree * std::cos(target.y * kDegToRad));
+            ImagePoint point = projectGroundPoint(*platform, pan, tilt, gimbal.hfov, aspect, latitude, longitude);
+            if (!point.valid) continue;
+            cx = point.x * frame.cols;
+            cy = point.y * frame.rows;
+            width = sprite.metres * target.scale * focal / point.depth;
+        } else {
+            cx = (target.x + target.driftX * age) * frame.cols;
+            cy = (target.y + target.driftY * age) * frame.rows;
+            width = full.cols * target.scale;
+        }
+        
+        // Under a pixel it would not be resolvable, so it is neither drawn nor logged
+        if (width < 1.0) continue;
+        const double height = width * full.rows / full.cols;
+        const double left = cx - width * 0.5;
+        const double top = cy - height * 0.5;
+        if (left >= frame.cols || top >= frame.rows || left + width <= 0.0 || top + height <= 0.0) continue;
+        
+        // Smallest mip level still at least as large as the target
+        int index = 0;
+        if (width < full.cols) {
+            index = std::min(static_cast<int>(std::floor(std::log2(full.cols / width))),
+                             static_cast<int>(sprite.levels.size()) - 1);
+        }
+        const Level& level = sprite.levels[index];
+        
+        cv::Rect drawn;
+        composite(frame, level, left, top, width / level.color.cols, height / level.color.rows, opacity, drawn);
+        if (drawn.empty()) continue;
+        visible++;
+        
+        if (m_truth.is_open()) {
+            m_truth << unixMs << ',' << sequence << ',' << std::setprecision(3) << now << ','
+                    << target.id << ',' << sprite.name << ',' << std::setprecision(1) << cx << ',' << cy << ','
+                    << width << ',' << height << ',' << std::setprecision(2) << opacity << ',';
+            if (target.world) {
+                m_truth << std::setprecision(7) << latitude << ',' << longitude;
+            } else {
+                m_truth << ',';
+            }
+            m_truth << '\n';
+            s_truthRecords.inc();
+        }
+    }
+    s_visible.set(visible);
+    
+    double costMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (m_config.budget_ms > 0 && costMs > m_config.budget_ms) {
+        s_overBudget.inc();
+    }
+}
+
+} // namespace sar
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "gimbal.h"
+#include "playback.h"
+#include "telemetry.h"
+
+namespace sar {
+
+// Composites timed synthetic targets (people in water, rafts, debris) into the
+// source frames for spotting drills, and logs where each one was drawn so
+// trainee calls can be scored. Targets are placed in frame fractions, or at a
+// latitude/longitude projected through the platform pose and gimbal. Each sprite
+// keeps a premultiplied mip chain, and blending touches only the target's own
+// rectangle of the frame.
+class Scenario {
+public:
+    Scenario();
+    ~Scenario();
+    
+    bool init(const ScenarioConfig& config);
+    void shutdown();
+    
+    // In place, before the sensor effects; one caller at a time. platform is null
+    // without fresh telemetry (world targets are then skipped), playback null for
+    // live sources, which run on the wall clock instead of the file position.
+    void apply(cv::Mat& frame, const GimbalState& gimbal, const PlatformTelemetry* platform,
+               const PlaybackStatus* playback, uint64_t sequence);
+    
+    // Restarts the wall clock for live sources; safe from any thread
+    void restart();
+    
+    bool isActive() const { return m_active; }
+    
+private:
+    struct Level {
+        cv::Mat color;                  // Premultiplied by alpha
+        cv::Mat alpha;
+    };
+    
+    struct Sprite {
+        std::string name;
+        double metres = 1.0;            // Real width, for world targets
+        std::vector<Level> levels;      // Full size, then halved down to a few pixels
+    };
+    
+    struct Target {
+        std::string id;
+        int sprite = 0;
+        double start = 0.0;             // Scenario seconds
+        double end = 0.0;               // <= start: until the scenario ends
+        double fade = 0.0;              // Seconds to fade in and out
+        bool world = false;
+        double x = 0.0;                 // Frame fraction, or longitude for world targets
+        double y = 0.0;                 // Frame fraction, or latitude
+        double driftX = 0.0;            // Fraction/s, or metres/s east
+        double driftY = 0.0;            // Fraction/s, or metres/s north
+        double scale = 1.0;
+        double opacity = 1.0;
+    };
+    
+    bool loadScenario(const std::string& path);
+    bool loadSprite(const std::string& name, const std::string& path, double metres);
+    void openGroundTruth();
+    void composite(cv::Mat& frame, const Level& level, double left, double top, double scaleX,
+                   double scaleY, double opacity, cv::Rect& drawn);
+    
+    ScenarioConfig m_config;
+    bool m_active = false;
+    
+    std::vector<Sprite> m_sprites;
+    std::vector<Target> m_targets;
+    
+    std::atomic<int64_t> m_epochNs{0};  // Steady-clock start of the live scenario clock
+    
+    // Per-target scratch, reused across frames
+    cv::Mat m_color;
+    cv::Mat m_alpha;
+    cv::Mat m_inverse;
+    cv::Mat m_inverse3;
+    
+    std::ofstream m_truth;
+    std::string m_truthPath;
+};
+
+} // namespace sar
@@ -0,0 +1,201 @@
+#include "telemetry.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <chrono>
+
+namespace sar {
+
+// Poll interval for noticing shutdown while no packets arrive
+static constexpr int kReceiveTimeoutMs = 100;
+
+// A sequence this far behind the last one is a restarted sender, not reordering
+static constexpr int32_t kRestartThreshold = 1000;
+
+static Counter& s_packets = Metrics::instance().counter(
+    "sar_telemetry_packets_total", "Platform telemetry datagrams accepted");
+static Counter& s_invalid = Metrics::instance().counter(
+    "sar_telemetry_invalid_packets_total", "Datagrams rejected for size, magic or version");
+static Counter& s_lost = Metrics::instance().counter(
+    "sar_telemetry_lost_packets_total", "Telemetry datagrams missing from the sequence");
+
+static uint16_t getU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t getU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static float getF32(const uint8_t* p) {
+    uint32_t bits = getU32(p);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static double getF64(const uint8_t* p) {
+    uint64_t bits = getU64(p);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static int64_t steadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TelemetryReceiver::TelemetryReceiver() {}
+
+TelemetryReceiver::~TelemetryReceiver() {
+    shutdown();
+}
+
+bool TelemetryReceiver::init(const TelemetryConfig& config) {
+    m_config = config;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    sockaddr_in addr;
+    if (!netInit() || !makeAddress(m_config.bind, m_config.port, addr)) {
+        std::cerr << "Telemetry: invalid bind address " << m_config.bind << std::endl;
+        return false;
+    }
+    
+    m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (m_socket == kInvalidSocket) {
+        std::cerr << "Telemetry: failed to create socket" << std::endl;
+        return false;
+    }
+    
+    // Room for bursts while the receiver thread is descheduled
+    int bufferSize = 1 << 20;
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bufferSize), sizeof(bufferSize));
+    
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "Telemetry: cannot bind " << m_config.bind << ":" << m_config.port << std::endl;
+        closeSocket(m_socket);
+        m_socket = kInvalidSocket;
+        return false;
+    }
+    
+    m_running = true;
+    m_thread = std::thread(&TelemetryReceiver::receiverThread, this);
+    
+    std::cout << "Telemetry: listening on " << m_config.bind << ":" << m_config.port << std::endl;
+    return true;
+}
+
+void TelemetryReceiver::shutdown() {
+    if (!m_running) return;
+    
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    
+    closeSocket(m_socket);
+    m_socket = kInvalidSocket;
+    
+    TelemetryStats stats = getStats();
+    std::cout << "Telemetry stopped: " << stats.received << " packets, " << stats.lost << " lost, "
+              << stats.invalid << " invalid" << std::endl;
+}
+
+double TelemetryReceiver::ageMs(const PlatformTelemetry& telemetry) const {
+    if (telemetry.receivedNs == 0) return -1.0;
+    return (steadyNowNs() - telemetry.receivedNs) / 1e6;
+}
+
+bool TelemetryReceiver::isStale(const PlatformTelemetry& telemetry) const {
+    double age = ageMs(telemetry);
+    return age < 0 || age > m_config.stale_ms;
+}
+
+TelemetryStats TelemetryReceiver::getStats() const {
+    TelemetryStats stats;
+    stats.received = m_received.load();
+    stats.invalid = m_invalid.load();
+    stats.lost = m_lost.load();
+    return stats;
+}
+
+bool TelemetryReceiver::parse(const uint8_t* data, size_t size, PlatformTelemetry& out) const {
+    if (size != kTelemetryPacketSize || std::memcmp(data, "SART", 4) != 0 ||
+        data[4] != kTelemetryPacketVersion) {
+        return false;
+    }
+    
+    uint16_t flags = getU16(data + 6);
+    out.hasPosition = (flags & 1) != 0;
+    out.hasAttitude = (flags & 2) != 0;
+    out.hasGimbal = (flags & 4) != 0;
+    out.sequence = getU32(data + 8);
+    out.sourceTimeUs = getU64(data + 12);
+    out.latitude = getF64(data + 20);
+    out.longitude = getF64(data + 28);
+    out.altitudeMsl = getF32(data + 36);
+    out.altitudeAgl = getF32(data + 40);
+    out.heading = getF32(data + 44);
+    out.pitch = getF32(data + 48);
+    out.roll = getF32(data + 52);
+    out.groundSpeed = getF32(data + 56);
+    out.gimbalPan = getF32(data + 60);
+    out.gimbalTilt = getF32(data + 64);
+    return true;
+}
+
+void TelemetryReceiver::receiverThread() {
+    applyThreadTopology("telemetry");
+    
+    PlatformTelemetry telemetry;
+    bool haveSequence = false;
+    uint32_t lastSequence = 0;
+    
+    while (m_running) {
+        if (!waitReadable(m_socket, kReceiveTimeoutMs)) continue;
+        
+        // Parse straight out of the member buffer into a stack struct: no allocation
+        auto received = recv(m_socket, reinterpret_cast<char*>(m_buffer), sizeof(m_buffer), 0);
+        if (received <= 0) continue;
+        
+        SAR_TRACE_SCOPE("telemetry.packet");
+        if (!parse(m_buffer, static_cast<size_t>(received), telemetry)) {
+            m_invalid++;
+            s_invalid.inc();
+            continue;
+        }
+        
+        if (haveSequence && telemetry.sequence != lastSequence + 1) {
+            // Reordered or duplicate datagrams are dropped, gaps count as lost, and a
+            // large jump backwards means the sender restarted
+            int32_t delta = static_cast<int32_t>(telemetry.sequence - lastSequence);
+            if (delta <= 0 && delta > -kRestartThreshold) continue;
+            if (delta > 1) {
+                m_lost += static_cast<uint64_t>(delta - 1);
+                s_lost.inc(static_cast<uint64_t>(delta - 1));
+            }
+        }
+        haveSequence = true;
+        lastSequence = telemetry.sequence;
+        
+        telemetry.receivedNs = steadyNowNs();
+        m_latest.store(telemetry);
+        m_received++;
+        s_packets.inc();
+    }
+}
+
+} // namespace sar
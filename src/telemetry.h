@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+#include "config.h"
+#include "net.h"
+
+namespace sar {
+
+// Wire format of one platform telemetry datagram (little-endian, 68 bytes):
+//
+//   offset  type  field
+//    0      u8[4] magic "SART"
+//    4      u8    version (1)
+//    5      u8    reserved
+//    6      u16   flags: bit 0 position, bit 1 attitude, bit 2 gimbal valid
+//    8      u32   sequence, +1 per datagram
+//   12      u64   timestamp, microseconds (sender clock)
+//   20      f64   latitude (deg, WGS84)
+//   28      f64   longitude (deg)
+//   36      f32   altitude MSL (m)
+//   40      f32   altitude AGL (m)
+//   44      f32   heading (deg true, 0..360)
+//   48      f32   pitch (deg, nose up positive)
+//   52      f32   roll (deg, right wing down positive)
+//   56      f32   ground speed (m/s)
+//   60      f32   gimbal pan relative to the nose (deg, positive right)
+//   64      f32   gimbal tilt (deg, positive up)
+static constexpr size_t kTelemetryPacketSize = 68;
+static constexpr uint8_t kTelemetryPacketVersion = 1;
+
+struct PlatformTelemetry {
+    bool hasPosition = false;
+    bool hasAttitude = false;
+    bool hasGimbal = false;
+    uint32_t sequence = 0;
+    uint64_t sourceTimeUs = 0;
+    int64_t receivedNs = 0;         // Local steady clock; 0 until the first packet
+    double latitude = 0;
+    double longitude = 0;
+    float altitudeMsl = 0;
+    float altitudeAgl = 0;
+    float heading = 0;
+    float pitch = 0;
+    float roll = 0;
+    float groundSpeed = 0;
+    float gimbalPan = 0;
+    float gimbalTilt = 0;
+};
+
+// Single-writer latest-value store. Readers never block the writer and retry if
+// they overlap a write; the payload lives in relaxed atomic words so a torn read
+// is detected rather than undefined.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    
+public:
+    void store(const T& value) {
+        uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+    
+    T load() const {
+        uint64_t words[kWords];
+        while (true) {
+            uint32_t before = m_seq.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            for (size_t i = 0; i < kWords; i++) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == before) break;
+        }
+        
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+    
+private:
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<uint64_t> m_words[kWords] = {};
+};
+
+struct TelemetryStats {
+    uint64_t received = 0;
+    uint64_t invalid = 0;           // Wrong size, magic or version
+    uint64_t lost = 0;              // Sequence gaps
+};
+
+// Receives platform telemetry on its own thread; the render loop polls latest()
+class TelemetryReceiver {
+public:
+    TelemetryReceiver();
+    ~TelemetryReceiver();
+    
+    bool init(const TelemetryConfig& config);
+    void shutdown();
+    
+    // Lock-free; safe to call every frame
+    PlatformTelemetry latest() const { return m_latest.load(); }
+    
+    // Milliseconds since the last packet, negative if none has arrived
+    double ageMs(const PlatformTelemetry& telemetry) const;
+    bool isStale(const PlatformTelemetry& telemetry) const;
+    
+    TelemetryStats getStats() const;
+    bool isRunning() const { return m_running.load(); }
+    
+private:
+    void receiverThread();
+    bool parse(const uint8_t* data, size_t size, PlatformTelemetry& out) const;
+    
+    TelemetryConfig m_config;
+    SocketHandle m_socket = kInvalidSocket;
+    uint8_t m_buffer[512] = {};
+    
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    SeqLock<PlatformTelemetry> m_latest;
+    
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_invalid{0};
+    std::atomic<uint64_t> m_lost{0};
+};
+
+} // namespace sar
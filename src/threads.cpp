@@ -0,0 +1,145 @@
+#include "threads.h"
+#include "trace.h"
+#include <iostream>
+#include <sstream>
+#include <mutex>
+
+#ifdef __linux__
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#ifdef SAR_HAVE_NUMA
+#include <numa.h>
+#endif
+
+namespace sar {
+
+static std::mutex g_topologyMutex;
+static ThreadsConfig g_threads;
+
+#ifdef __linux__
+// CPUs the process was started with (taskset, cgroup); unpinned roles get them back
+static cpu_set_t g_processCpus;
+static bool g_haveProcessCpus = false;
+#endif
+
+void configureThreads(const ThreadsConfig& config) {
+    std::lock_guard<std::mutex> lock(g_topologyMutex);
+    g_threads = config;
+#ifdef __linux__
+    if (!g_haveProcessCpus) {
+        CPU_ZERO(&g_processCpus);
+        g_haveProcessCpus = sched_getaffinity(0, sizeof(g_processCpus), &g_processCpus) == 0;
+    }
+#endif
+}
+
+#ifdef SAR_HAVE_NUMA
+static int resolveMemoryNode(const ThreadConfig& tc) {
+    if (numa_available() < 0) return -1;
+    if (tc.memory_node >= 0) return tc.memory_node;
+    
+    // Place buffers next to the thread that consumes them
+    auto it = g_threads.find(tc.memory_follows);
+    if (it != g_threads.end() && !it->second.cpus.empty()) {
+        return numa_node_of_cpu(it->second.cpus.front());
+    }
+    return -1;
+}
+#endif
+
+void applyThreadTopology(const std::string& role) {
+    std::lock_guard<std::mutex> lock(g_topologyMutex);
+    
+    ThreadConfig tc;
+    auto it = g_threads.find(role);
+    if (it != g_threads.end()) {
+        tc = it->second;
+    }
+    if (tc.name.empty()) {
+        tc.name = "sar-" + role;
+    }
+    Trace::setThreadName(tc.name);
+    
+    std::stringstream report;
+    report << "Thread " << role << ": name " << tc.name.substr(0, 15);
+    
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), tc.name.substr(0, 15).c_str());
+    
+    // A new thread inherits its creator's affinity and scheduling, and many are
+    // spawned from pinned ones (the render thread starts the recorder, replay and
+    // graph workers). Roles without settings of their own are put back to the
+    // defaults rather than left on the creator's cores or priority.
+    if (!tc.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        report << ", cpus";
+        for (int cpu : tc.cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                report << " " << cpu << " [INVALID]";
+                continue;
+            }
+            CPU_SET(cpu, &set);
+            report << " " << cpu;
+        }
+        int err = CPU_COUNT(&set) > 0 ? pthread_setaffinity_np(pthread_self(), sizeof(set), &set) : EINVAL;
+        report << (err == 0 ? "" : " [FAILED]");
+    } else if (g_haveProcessCpus) {
+        pthread_setaffinity_np(pthread_self(), sizeof(g_processCpus), &g_processCpus);
+    }
+    
+    // Linux applies nice values per thread (by TID)
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (tc.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = tc.fifo_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        report << ", SCHED_FIFO " << tc.fifo_priority
+               << (err == 0 ? "" : " [FAILED: needs CAP_SYS_NICE]");
+    } else {
+        int policy = SCHED_OTHER;
+        sched_param param{};
+        if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && policy != SCHED_OTHER) {
+            param.sched_priority = 0;
+            pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+        }
+        if (tc.nice != 0) {
+            int err = setpriority(PRIO_PROCESS, static_cast<id_t>(tid), tc.nice);
+            report << ", nice " << tc.nice << (err == 0 ? "" : " [FAILED]");
+        } else {
+            // Best effort: going back up from a positive nice needs CAP_SYS_NICE
+            errno = 0;
+            if (getpriority(PRIO_PROCESS, static_cast<id_t>(tid)) != 0 && errno == 0) {
+                setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 0);
+            }
+        }
+    }
+    
+#ifdef SAR_HAVE_NUMA
+    int node = resolveMemoryNode(tc);
+    if (node >= 0) {
+        numa_set_preferred(node);
+        report << ", memory node " << node;
+    }
+#endif
+#elif defined(__APPLE__)
+    pthread_setname_np(tc.name.substr(0, 15).c_str());
+    if (!tc.cpus.empty() || tc.fifo_priority > 0 || tc.nice != 0) {
+        report << " (affinity/priority not supported on this platform)";
+    }
+#else
+    report << " (thread topology not supported on this platform)";
+#endif
+    
+    std::cout << report.str() << std::endl;
+}
+
+} // namespace sar
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include "config.h"
+
+namespace sar {
+
+// Pipeline thread topology: CPU affinity, scheduling and naming per role.
+// configureThreads() is called once at startup; each pipeline thread then calls
+// applyThreadTopology() with its role as the first thing it does.
+void configureThreads(const ThreadsConfig& config);
+void applyThreadTopology(const std::string& role);
+
+} // namespace sar
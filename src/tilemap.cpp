@@ -0,0 +1,324 @@
+#include "tilemap.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace sar {
+
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kMaxLatitude = 85.05112878;    // Web Mercator limit
+static constexpr size_t kMaxQueuedTiles = 256;
+
+static Counter& s_tileHits = Metrics::instance().counter(
+    "sar_map_tile_hits_total", "Map tiles composited from the decoded cache");
+static Counter& s_tileMisses = Metrics::instance().counter(
+    "sar_map_tile_misses_total", "Map tiles not yet decoded when needed");
+static Counter& s_tilesDecoded = Metrics::instance().counter(
+    "sar_map_tiles_decoded_total", "Map tiles decoded by the background worker");
+static Histogram& s_renderTime = Metrics::instance().stage("map");
+
+static uint32_t readU32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t readU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+TileMap::TileMap() {}
+
+TileMap::~TileMap() {
+    shutdown();
+}
+
+bool TileMap::init(const MapConfig& config) {
+    m_config = config;
+    
+    if (!m_config.enabled) {
+        return false;
+    }
+    
+    if (!m_file.open(m_config.tile_pack)) {
+        std::cerr << "Map: cannot open tile pack " << m_config.tile_pack << std::endl;
+        return false;
+    }
+    
+    const uint8_t* data = m_file.data();
+    const size_t size = m_file.size();
+    if (size < kTilePackHeaderSize || std::memcmp(data, "SARTILES", 8) != 0 || readU32(data + 8) != 1) {
+        std::cerr << "Map: " << m_config.tile_pack << " is not a version 1 tile pack" << std::endl;
+        m_file.close();
+        return false;
+    }
+    
+    m_tileSize = static_cast<int>(readU32(data + 12));
+    uint32_t count = readU32(data + 16);
+    if (m_tileSize <= 0 || kTilePackHeaderSize + static_cast<size_t>(count) * kTilePackEntrySize > size) {
+        std::cerr << "Map: truncated tile pack index" << std::endl;
+        m_file.close();
+        return false;
+    }
+    
+    // Only the requested zoom level is indexed; tile bytes stay in the mapping
+    m_index.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* e = data + kTilePackHeaderSize + static_cast<size_t>(i) * kTilePackEntrySize;
+        if (e[0] != m_config.zoom) continue;
+        
+        IndexEntry entry;
+        entry.key = tileKey(e[0], readU32(e + 4), readU32(e + 8));
+        entry.length = readU32(e + 12);
+        entry.offset = readU64(e + 16);
+        // Written so a huge offset can't wrap the sum past the check
+        if (entry.length > size || entry.offset > size - entry.length) continue;
+        m_index.push_back(entry);
+    }
+    std::sort(m_index.begin(), m_index.end(),
+              [](const IndexEntry& a, const IndexEntry& b) { return a.key < b.key; });
+    
+    if (m_index.empty()) {
+        std::cerr << "Map: no tiles at zoom " << m_config.zoom << " in " << m_config.tile_pack << std::endl;
+        m_file.close();
+        return false;
+    }
+    
+    if (m_config.cache_tiles < 9) m_config.cache_tiles = 9;
+    m_worldSize = static_cast<double>(m_tileSize) * std::pow(2.0, m_config.zoom);
+    
+    m_running = true;
+    m_thread = std::thread(&TileMap::workerThread, this);
+    
+    std::cout << "Map: " << m_index.size() << " tiles at zoom " << m_config.zoom << " from "
+              << m_config.tile_pack << std::endl;
+    return true;
+}
+
+void TileMap::shutdown() {
+    if (m_running) {
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_running = false;
+        }
+        m_queueCv.notify_all();
+        
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+    
+    m_cache.clear();
+    m_lru.clear();
+    m_index.clear();
+    m_file.close();
+}
+
+uint64_t TileMap::tileKey(int zoom, uint32_t x, uint32_t y) {
+    return (static_cast<uint64_t>(zoom) << 56) | (static_cast<uint64_t>(x & 0xFFFFFFF) << 28) | (y & 0xFFFFFFF);
+}
+
+cv::Point2d TileMap::project(double latitude, double longitude) const {
+    // Web Mercator, in pixels of the whole world at the configured zoom
+    double lat = std::clamp(latitude, -kMaxLatitude, kMaxLatitude) * kPi / 180.0;
+    double x = (longitude + 180.0) / 360.0 * m_worldSize;
+    double y = (1.0 - std::log(std::tan(lat) + 1.0 / std::cos(lat)) / kPi) / 2.0 * m_worldSize;
+    return cv::Point2d(x, y);
+}
+
+const TileMap::IndexEntry* TileMap::find(uint64_t key) const {
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), key,
+                               [](const IndexEntry& e, uint64_t k) { return e.key < k; });
+    return (it != m_index.end() && it->key == key) ? &*it : nullptr;
+}
+
+bool TileMap::cachedTile(uint64_t key, cv::Mat& tile) {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    auto it = m_cache.find(key);
+    if (it == m_cache.end()) return false;
+    
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    tile = it->second.tile;
+    return true;
+}
+
+void TileMap::request(uint64_t key, bool urgent) {
+    if (!find(key)) return;
+    
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_queued.count(key)) return;
+        if (m_queue.size() >= kMaxQueuedTiles) {
+            if (!urgent) return;
+            m_queued.erase(m_queue.back());
+            m_queue.pop_back();
+        }
+        
+        // Tiles on screen jump ahead of look-ahead tiles
+        if (urgent) {
+            m_queue.push_front(key);
+        } else {
+            m_queue.push_back(key);
+        }
+        m_queued.insert(key);
+    }
+    m_queueCv.notify_one();
+}
+
+void TileMap::prefetch(const PlatformTelemetry& platform) {
+    // Where the platform will be after prefetch_seconds on its current track
+    double distance = platform.groundSpeed * m_config.prefetch_seconds;
+    double heading = platform.heading * kPi / 180.0;
+    double lat = platform.latitude + distance * std::cos(heading) / 111320.0;
+    double lon = platform.longitude +
+                 distance * std::sin(heading) / (111320.0 * std::cos(platform.latitude * kPi / 180.0));
+    
+    cv::Point2d ahead = project(lat, lon);
+    int tx = static_cast<int>(ahead.x / m_tileSize);
+    int ty = static_cast<int>(ahead.y / m_tileSize);
+    
+    uint64_t key = tileKey(m_config.zoom, tx, ty);
+    if (key == m_lastPrefetch) return;
+    m_lastPrefetch = key;
+    
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            if (tx + dx < 0 || ty + dy < 0) continue;
+            uint64_t k = tileKey(m_config.zoom, tx + dx, ty + dy);
+            cv::Mat unused;
+            if (!cachedTile(k, unused)) request(k, false);
+        }
+    }
+}
+
+void TileMap::render(cv::Mat& frame, const cv::Rect& roi, const PlatformTelemetry& platform,
+                     const GroundPoint& target) {
+    if (!isOpen() || !platform.hasPosition) return;
+    
+    SAR_TRACE_SCOPE("map.render");
+    ScopedTimer timer(s_renderTime);
+    
+    cv::Rect view = roi & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (view.width <= 0 || view.height <= 0) return;
+    
+    // Global pixel coordinates of the inset's top-left corner
+    cv::Point2d center = project(platform.latitude, platform.longitude);
+    double originX = center.x - roi.width / 2.0;
+    double originY = center.y - roi.height / 2.0;
+    
+    int tx0 = static_cast<int>(std::floor((originX + (view.x - roi.x)) / m_tileSize));
+    int ty0 = static_cast<int>(std::floor((originY + (view.y - roi.y)) / m_tileSize));
+    int tx1 = static_cast<int>(std::floor((originX + (view.br().x - roi.x) - 1) / m_tileSize));
+    int ty1 = static_cast<int>(std::floor((originY + (view.br().y - roi.y) - 1) / m_tileSize));
+    
+    cv::Mat tile;
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            // Tile rectangle in frame coordinates, clipped to the inset
+            cv::Rect tileRect(roi.x + static_cast<int>(std::lround(tx * static_cast<double>(m_tileSize) - originX)),
+                              roi.y + static_cast<int>(std::lround(ty * static_cast<double>(m_tileSize) - originY)),
+                              m_tileSize, m_tileSize);
+            cv::Rect dst = tileRect & view;
+            if (dst.width <= 0 || dst.height <= 0) continue;
+            
+            uint64_t key = tileKey(m_config.zoom, static_cast<uint32_t>(tx), static_cast<uint32_t>(ty));
+            cv::Mat patch = frame(dst);
+            if (tx >= 0 && ty >= 0 && cachedTile(key, tile) && tile.type() == frame.type() &&
+                tile.cols == m_tileSize && tile.rows == m_tileSize) {
+                s_tileHits.inc();
+                tile(cv::Rect(dst.x - tileRect.x, dst.y - tileRect.y, dst.width, dst.height))
+                    .copyTo(patch);
+            } else {
+                s_tileMisses.inc();
+                patch.setTo(cv::Scalar(40, 40, 40));
+                if (tx >= 0 && ty >= 0) request(key, true);
+            }
+        }
+    }
+    
+    prefetch(platform);
+    
+    // Overlays are drawn into the inset itself, so OpenCV clips them to it; a distant
+    // ground point would otherwise draw its line of sight across the live video
+    cv::Mat inset = frame(view);
+    const cv::Point insetOrigin(roi.x - view.x, roi.y - view.y);
+    
+    // Crosshair ground point and line of sight
+    cv::Point own(insetOrigin.x + roi.width / 2, insetOrigin.y + roi.height / 2);
+    if (target.valid) {
+        cv::Point2d p = project(target.latitude, target.longitude);
+        cv::Point tgt(insetOrigin.x + cvRound(p.x - originX), insetOrigin.y + cvRound(p.y - originY));
+        cv::line(inset, own, tgt, cv::Scalar(0, 200, 255), 1, cv::LINE_AA);
+        if (cv::Rect(0, 0, inset.cols, inset.rows).contains(tgt)) {
+            cv::circle(inset, tgt, 4, cv::Scalar(0, 200, 255), 2, cv::LINE_AA);
+        }
+    }
+    
+    // Platform marker pointing along the heading
+    double h = platform.heading * kPi / 180.0;
+    cv::Point2d fwd(std::sin(h), -std::cos(h));
+    cv::Point2d right(-fwd.y, fwd.x);
+    cv::Point marker[3] = {
+        own + cv::Point(cvRound(fwd.x * 9), cvRound(fwd.y * 9)),
+        own + cv::Point(cvRound(-fwd.x * 6 + right.x * 6), cvRound(-fwd.y * 6 + right.y * 6)),
+        own + cv::Point(cvRound(-fwd.x * 6 - right.x * 6), cvRound(-fwd.y * 6 - right.y * 6))
+    };
+    cv::fillConvexPoly(inset, marker, 3, cv::Scalar(0, 255, 0), cv::LINE_AA);
+    
+    cv::rectangle(frame, view, cv::Scalar(200, 200, 200), 1);
+}
+
+void TileMap::workerThread() {
+    applyThreadTopology("map");
+    
+    while (true) {
+        uint64_t key;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueCv.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+            if (!m_running) break;
+            
+            key = m_queue.front();
+            m_queue.pop_front();
+            m_queued.erase(key);
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
+            if (m_cache.count(key)) continue;
+        }
+        
+        const IndexEntry* entry = find(key);
+        if (!entry) continue;
+        
+        // Decode straight from the mapping; the page cache is the only copy of the bytes
+        cv::Mat tile;
+        {
+            SAR_TRACE_SCOPE("map.decode");
+            cv::Mat encoded(1, static_cast<int>(entry->length), CV_8U,
+                            const_cast<uint8_t*>(m_file.data() + entry->offset));
+            tile = cv::imdecode(encoded, cv::IMREAD_COLOR);
+        }
+        if (tile.empty()) continue;
+        if (tile.cols != m_tileSize || tile.rows != m_tileSize) {
+            cv::resize(tile, tile, cv::Size(m_tileSize, m_tileSize), 0, 0, cv::INTER_AREA);
+        }
+        s_tilesDecoded.inc();
+        
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_lru.push_front(key);
+        m_cache[key] = CacheEntry{tile, m_lru.begin()};
+        while (static_cast<int>(m_cache.size()) > m_config.cache_tiles) {
+            m_cache.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+    }
+}
+
+} // namespace sar
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "config.h"
+#include "geo.h"
+#include "mapped_file.h"
+#include "telemetry.h"
+
+namespace sar {
+
+// Tile pack layout (little-endian), one file holding pre-rendered XYZ tiles:
+//
+//   header (24 bytes): u8[8] magic "SARTILES", u32 version (1), u32 tile size (px),
+//                      u32 tile count, u32 reserved
+//   index  (24 bytes per tile): u8 zoom, u8[3] reserved, u32 x, u32 y,
+//                      u32 length, u64 offset of the encoded PNG/JPEG
+//   tile data
+static constexpr size_t kTilePackHeaderSize = 24;
+static constexpr size_t kTilePackEntrySize = 24;
+
+// North-up moving map drawn from a memory-mapped tile pack. The render thread only
+// ever composites tiles that are already decoded; misses and look-ahead tiles are
+// decoded by a background worker into an LRU cache.
+class TileMap {
+public:
+    TileMap();
+    ~TileMap();
+    
+    bool init(const MapConfig& config);
+    void shutdown();
+    
+    bool isOpen() const { return m_file.isOpen(); }
+    int insetSize() const { return m_config.size; }
+    
+    // Draws the inset into roi, centred on the platform with the crosshair ground point
+    void render(cv::Mat& frame, const cv::Rect& roi, const PlatformTelemetry& platform,
+                const GroundPoint& target);
+    
+private:
+    struct IndexEntry {
+        uint64_t key;
+        uint64_t offset;
+        uint32_t length;
+    };
+    
+    struct CacheEntry {
+        cv::Mat tile;
+        std::list<uint64_t>::iterator lru;
+    };
+    
+    static uint64_t tileKey(int zoom, uint32_t x, uint32_t y);
+    cv::Point2d project(double latitude, double longitude) const;
+    
+    const IndexEntry* find(uint64_t key) const;
+    bool cachedTile(uint64_t key, cv::Mat& tile);
+    void request(uint64_t key, bool urgent);
+    void prefetch(const PlatformTelemetry& platform);
+    void workerThread();
+    
+    MapConfig m_config;
+    MappedFile m_file;
+    std::vector<IndexEntry> m_index;    // Sorted by key
+    int m_tileSize = 256;
+    double m_worldSize = 0;             // World width in pixels at m_config.zoom
+    
+    std::mutex m_cacheMutex;
+    std::list<uint64_t> m_lru;          // Most recently used first
+    std::unordered_map<uint64_t, CacheEntry> m_cache;
+    
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueCv;
+    std::deque<uint64_t> m_queue;
+    std::unordered_set<uint64_t> m_queued;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    
+    uint64_t m_lastPrefetch = 0;
+};
+
+} // namespace sar
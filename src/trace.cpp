@@ -0,0 +1,180 @@
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sar {
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    int64_t start;
+    int64_t duration;               // Negative for instant events
+};
+
+// Written only by its owning thread. The exporter copies a snapshot and then
+// discards any slot the writer may have lapped while it was copying.
+struct ThreadBuffer {
+    int tid = 0;
+    std::string name;
+    std::unique_ptr<TraceEvent[]> events;
+    uint64_t mask = 0;
+    std::atomic<uint64_t> head{0};
+};
+
+std::mutex s_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;  // Kept after threads exit
+TraceConfig s_config;
+uint64_t s_capacity = 0;
+int64_t s_origin = 0;
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+thread_local std::string t_name;
+
+ThreadBuffer* threadBuffer() {
+    if (t_buffer) return t_buffer;
+    
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->events = std::make_unique<TraceEvent[]>(s_capacity);
+    buffer->mask = s_capacity - 1;
+    
+    std::lock_guard<std::mutex> lock(s_mutex);
+    buffer->tid = static_cast<int>(s_buffers.size()) + 1;
+    buffer->name = t_name.empty() ? "thread " + std::to_string(buffer->tid) : t_name;
+    t_buffer = buffer.get();
+    s_buffers.push_back(std::move(buffer));
+    return t_buffer;
+}
+
+void push(const char* name, int64_t start, int64_t duration) {
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head & buffer->mask] = TraceEvent{name, start, duration};
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::string escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+void Trace::init(const TraceConfig& config) {
+    s_config = config;
+    
+    // Power-of-two ring so the slot index is a mask
+    s_capacity = 1024;
+    while (s_capacity < static_cast<uint64_t>(config.buffer_events) && s_capacity < (1u << 22)) {
+        s_capacity *= 2;
+    }
+    s_origin = now();
+    
+    if (!config.enabled) return;
+    
+    if (!config.output_dir.empty()) {
+        std::filesystem::create_directories(config.output_dir);
+    }
+    s_enabled.store(true, std::memory_order_relaxed);
+    
+    std::cout << "Tracing enabled: " << s_capacity << " events per thread, output to "
+              << config.output_dir << std::endl;
+}
+
+void Trace::setThreadName(const std::string& name) {
+    t_name = name;
+    if (t_buffer) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        t_buffer->name = name;
+    }
+}
+
+void Trace::complete(const char* name, int64_t startNs, int64_t endNs) {
+    push(name, startNs, endNs - startNs);
+}
+
+void Trace::instant(const char* name) {
+    if (!enabled()) return;
+    push(name, now(), -1);
+}
+
+int64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string Trace::flush() {
+    if (!enabled()) return "";
+    
+    auto wallNow = std::time(nullptr);
+    std::stringstream path;
+    path << s_config.output_dir << "/trace_" << std::put_time(std::localtime(&wallNow), "%Y%m%d_%H%M%S")
+         << ".json";
+    
+    std::ofstream file(path.str());
+    if (!file.is_open()) {
+        std::cerr << "Failed to write trace: " << path.str() << std::endl;
+        return "";
+    }
+    
+    std::lock_guard<std::mutex> lock(s_mutex);
+    std::vector<TraceEvent> snapshot;
+    size_t written = 0;
+    
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"sar-simulator\"}}";
+    file << std::fixed << std::setprecision(3);
+    
+    for (const auto& buffer : s_buffers) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+             << ",\"args\":{\"name\":\"" << escape(buffer->name) << "\"}}";
+        
+        const uint64_t capacity = buffer->mask + 1;
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first = head > capacity ? head - capacity : 0;
+        
+        snapshot.clear();
+        for (uint64_t i = first; i < head; i++) {
+            snapshot.push_back(buffer->events[i & buffer->mask]);
+        }
+        
+        // The copy races the writer on purpose: taking a lock would put one on every
+        // span. Slots it reached again during the copy may be torn, including the one
+        // it may still be filling at index `after`; drop them all.
+        uint64_t after = buffer->head.load(std::memory_order_acquire);
+        uint64_t valid = after >= capacity ? after - capacity + 1 : 0;
+        size_t skip = valid > first ? static_cast<size_t>(std::min(valid - first, head - first)) : 0;
+        
+        for (size_t i = skip; i < snapshot.size(); i++) {
+            const TraceEvent& e = snapshot[i];
+            double ts = (e.start - s_origin) / 1000.0;
+            file << ",\n{\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << buffer->tid
+                 << ",\"ts\":" << ts;
+            if (e.duration >= 0) {
+                file << ",\"ph\":\"X\",\"dur\":" << e.duration / 1000.0 << "}";
+            } else {
+                file << ",\"ph\":\"i\",\"s\":\"t\"}";
+            }
+            written++;
+        }
+    }
+    file << "\n]}\n";
+    
+    std::cout << "Trace written: " << path.str() << " (" << written << " events)" << std::endl;
+    return path.str();
+}
+
+} // namespace sar
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "config.h"
+
+namespace sar {
+
+// Scoped spans are written into a per-thread ring (single producer, no locks) and
+// exported as Chrome trace-event JSON, which chrome://tracing and ui.perfetto.dev
+// both open. When tracing is disabled a span costs one relaxed atomic load.
+class Trace {
+public:
+    static void init(const TraceConfig& config);
+    
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    
+    // Label for the calling thread in the exported trace
+    static void setThreadName(const std::string& name);
+    
+    // name must outlive the process (a string literal); only the pointer is stored
+    static void complete(const char* name, int64_t startNs, int64_t endNs);
+    static void instant(const char* name);
+    
+    static int64_t now();
+    
+    // Async-signal-safe; the render loop performs the flush
+    static void requestFlush() { s_flushRequested.store(true, std::memory_order_relaxed); }
+    static bool takeFlushRequest() { return s_flushRequested.exchange(false, std::memory_order_relaxed); }
+    
+    // Writes everything currently held in the rings; returns the file path or empty
+    static std::string flush();
+    
+private:
+    static inline std::atomic<bool> s_enabled{false};
+    static inline std::atomic<bool> s_flushRequested{false};
+};
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : m_name(name), m_active(Trace::enabled()), m_start(m_active ? Trace::now() : 0) {}
+    ~TraceScope() {
+        if (m_active) Trace::complete(m_name, m_start, Trace::now());
+    }
+    
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+    
+private:
+    const char* m_name;
+    bool m_active;
+    int64_t m_start;
+};
+
+} // namespace sar
+
+#define SAR_TRACE_CONCAT_(a, b) a##b
+#define SAR_TRACE_CONCAT(a, b) SAR_TRACE_CONCAT_(a, b)
+#define SAR_TRACE_SCOPE(name) ::sar::TraceScope SAR_TRACE_CONCAT(sarTraceScope_, __LINE__)(name)
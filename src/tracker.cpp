@@ -0,0 +1,253 @@
+#include "tracker.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace sar {
+
+static constexpr float kGaussianSigma = 2.0f;   // Desired response peak width (filter pixels)
+static constexpr float kRegularisation = 1e-3f; // Keeps H finite where the spectrum is weak
+static constexpr int kSidelobeExclusion = 5;    // Half-size of the peak area excluded from PSR
+static constexpr int kMaxSkippedFrames = 4;
+
+Tracker::Tracker() {}
+
+void Tracker::init(const TrackerConfig& config) {
+    m_config = config;
+    
+    // Power-of-two filter size keeps the DFT on its fastest radix-2 path
+    m_size = 16;
+    while (m_size < config.filter_size && m_size < 256) {
+        m_size *= 2;
+    }
+    if (m_config.window < m_size / 2) m_config.window = m_size / 2;
+    m_windowScale = static_cast<float>(m_config.window) / m_size;
+    
+    const cv::Size size(m_size, m_size);
+    cv::createHanningWindow(m_cosWindow, size, CV_32F);
+    
+    // Gaussian peak at the window centre; its spectrum is the training target
+    cv::Mat target(size, CV_32F);
+    const float c = m_size / 2.0f;
+    for (int y = 0; y < m_size; y++) {
+        float* row = target.ptr<float>(y);
+        for (int x = 0; x < m_size; x++) {
+            float dx = x - c;
+            float dy = y - c;
+            row[x] = std::exp(-(dx * dx + dy * dy) / (2.0f * kGaussianSigma * kGaussianSigma));
+        }
+    }
+    cv::dft(target, m_targetSpectrum, cv::DFT_COMPLEX_OUTPUT);
+    
+    m_patch.create(size, CV_32F);
+    m_spectrum.create(size, CV_32FC2);
+    m_numerator.create(size, CV_32FC2);
+    m_denominator.create(size, CV_32FC2);
+    m_scratch.create(size, CV_32FC2);
+    m_filter.create(size, CV_32FC2);
+    m_responseSpectrum.create(size, CV_32FC2);
+    m_response.create(size, CV_32F);
+}
+
+bool Tracker::start(const cv::Mat& frame) {
+    if (!m_config.enabled || frame.empty()) return false;
+    
+    m_frameSize = frame.size();
+    m_window = m_config.window;
+    m_windowScale = static_cast<float>(m_window) / m_size;
+    m_center = cv::Point2f(frame.cols / 2.0f, frame.rows / 2.0f);
+    m_velocity = cv::Point2f(0, 0);
+    m_framesToSkip = 0;
+    
+    extractPatch(frame, m_center);
+    computeSpectrum();
+    train(1.0);
+    
+    m_state = TrackState();
+    m_state.active = true;
+    
+    float half = m_window * 0.25f;
+    m_state.box = cv::Rect2f(m_center.x - half, m_center.y - half, half * 2, half * 2);
+    
+    std::cout << "Tracker locked at " << m_center.x << ", " << m_center.y << std::endl;
+    return true;
+}
+
+void Tracker::stop() {
+    if (m_state.active) {
+        std::cout << "Tracker released (" << m_state.skipped << " updates skipped)" << std::endl;
+    }
+    m_state.active = false;
+}
+
+void Tracker::update(const cv::Mat& frame) {
+    if (!m_state.active) return;
+    
+    if (frame.size() != m_frameSize) {
+        // Same view at another resolution (a dual-resolution source switched): scale
+        // the window with it, so the filter keeps seeing the same patch of scene
+        double sx = static_cast<double>(frame.cols) / m_frameSize.width;
+        double sy = static_cast<double>(frame.rows) / m_frameSize.height;
+        if (std::abs(sx - sy) > 0.01 * sx) {
+            stop();
+            return;
+        }
+        m_center = m_center * static_cast<float>(sx);
+        m_velocity = m_velocity * static_cast<float>(sx);
+        m_window = std::max(m_size / 2, static_cast<int>(std::lround(m_window * sx)));
+        m_windowScale = static_cast<float>(m_window) / m_size;
+        m_frameSize = frame.size();
+    }
+    
+    const cv::Point2f frameCenter(frame.cols / 2.0f, frame.rows / 2.0f);
+    
+    if (m_framesToSkip > 0) {
+        // Over budget: coast on the last velocity instead of stalling the frame
+        m_framesToSkip--;
+        m_state.skipped++;
+        m_center += m_velocity;
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        
+        extractPatch(frame, m_center);
+        computeSpectrum();
+        
+        cv::Point2f shift;
+        float psr = correlate(shift);
+        m_state.psr = psr;
+        m_state.lost = psr < m_config.psr_threshold;
+        
+        if (!m_state.lost) {
+            cv::Point2f delta(shift.x * m_windowScale, shift.y * m_windowScale);
+            m_center += delta;
+            m_velocity = m_velocity * 0.5 + delta * 0.5;
+            
+            extractPatch(frame, m_center);
+            computeSpectrum();
+            train(m_config.learning_rate);
+        } else {
+            m_velocity = m_velocity * 0.9;
+            m_center += m_velocity;
+        }
+        
+        double costMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        m_state.costMs = m_state.costMs * 0.9 + costMs * 0.1;
+        
+        if (costMs > m_config.budget_ms && m_config.budget_ms > 0) {
+            int skip = static_cast<int>(std::ceil(costMs / m_config.budget_ms)) - 1;
+            m_framesToSkip = std::min(skip, kMaxSkippedFrames);
+        }
+    }
+    
+    m_center.x = std::clamp(m_center.x, 0.0f, static_cast<float>(frame.cols - 1));
+    m_center.y = std::clamp(m_center.y, 0.0f, static_cast<float>(frame.rows - 1));
+    
+    float half = m_window * 0.25f;
+    m_state.box = cv::Rect2f(m_center.x - half, m_center.y - half, half * 2, half * 2);
+    m_state.offset = m_center - frameCenter;
+}
+
+void Tracker::getSteering(float& pan, float& tilt) const {
+    pan = 0.0f;
+    tilt = 0.0f;
+    if (!m_state.active || m_state.lost || m_frameSize.width <= 0) return;
+    
+    pan = std::clamp(m_config.steering_gain * m_state.offset.x / (m_frameSize.width * 0.5f), -1.0f, 1.0f);
+    tilt = std::clamp(m_config.steering_gain * m_state.offset.y / (m_frameSize.height * 0.5f), -1.0f, 1.0f);
+}
+
+void Tracker::extractPatch(const cv::Mat& frame, cv::Point2f center) {
+    // Only the ROI is touched; getRectSubPix replicates borders near the frame edge
+    cv::getRectSubPix(frame, cv::Size(m_window, m_window), center, m_patchColor);
+    
+    if (m_patchColor.channels() == 3) {
+        cv::cvtColor(m_patchColor, m_patchGray, cv::COLOR_BGR2GRAY);
+    } else {
+        m_patchColor.copyTo(m_patchGray);
+    }
+    
+    const cv::Mat* gray = &m_patchGray;
+    if (m_patchGray.cols != m_size) {
+        cv::resize(m_patchGray, m_patchResized, cv::Size(m_size, m_size), 0, 0, cv::INTER_AREA);
+        gray = &m_patchResized;
+    }
+    
+    // log(1 + x), zero mean / unit variance, cosine window
+    gray->convertTo(m_patch, CV_32F, 1.0, 1.0);
+    cv::log(m_patch, m_patch);
+    
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(m_patch, mean, stddev);
+    double scale = 1.0 / (stddev[0] + 1e-5);
+    m_patch.convertTo(m_patch, CV_32F, scale, -mean[0] * scale);
+    cv::multiply(m_patch, m_cosWindow, m_patch);
+}
+
+void Tracker::computeSpectrum() {
+    cv::dft(m_patch, m_spectrum, cv::DFT_COMPLEX_OUTPUT);
+}
+
+void Tracker::train(double rate) {
+    // A = G . conj(F)
+    cv::mulSpectrums(m_targetSpectrum, m_spectrum, m_scratch, 0, true);
+    if (rate >= 1.0) {
+        m_scratch.copyTo(m_numerator);
+    } else {
+        cv::addWeighted(m_numerator, 1.0 - rate, m_scratch, rate, 0.0, m_numerator);
+    }
+    
+    // B = F . conj(F) (purely real)
+    cv::mulSpectrums(m_spectrum, m_spectrum, m_scratch, 0, true);
+    if (rate >= 1.0) {
+        m_scratch.copyTo(m_denominator);
+    } else {
+        cv::addWeighted(m_denominator, 1.0 - rate, m_scratch, rate, 0.0, m_denominator);
+    }
+    
+    // H* = A / B
+    for (int y = 0; y < m_size; y++) {
+        const cv::Vec2f* a = m_numerator.ptr<cv::Vec2f>(y);
+        const cv::Vec2f* b = m_denominator.ptr<cv::Vec2f>(y);
+        cv::Vec2f* h = m_filter.ptr<cv::Vec2f>(y);
+        for (int x = 0; x < m_size; x++) {
+            float inv = 1.0f / (b[x][0] + kRegularisation);
+            h[x][0] = a[x][0] * inv;
+            h[x][1] = a[x][1] * inv;
+        }
+    }
+}
+
+float Tracker::correlate(cv::Point2f& shift) {
+    cv::mulSpectrums(m_spectrum, m_filter, m_responseSpectrum, 0, false);
+    cv::idft(m_responseSpectrum, m_response, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+    
+    double peak;
+    cv::Point peakLoc;
+    cv::minMaxLoc(m_response, nullptr, &peak, nullptr, &peakLoc);
+    
+    shift = cv::Point2f(static_cast<float>(peakLoc.x - m_size / 2),
+                        static_cast<float>(peakLoc.y - m_size / 2));
+    
+    // Peak-to-sidelobe ratio over the response excluding the area around the peak
+    double sum = 0.0;
+    double sumSq = 0.0;
+    int count = 0;
+    for (int y = 0; y < m_size; y++) {
+        const float* row = m_response.ptr<float>(y);
+        bool nearRow = std::abs(y - peakLoc.y) <= kSidelobeExclusion;
+        for (int x = 0; x < m_size; x++) {
+            if (nearRow && std::abs(x - peakLoc.x) <= kSidelobeExclusion) continue;
+            sum += row[x];
+            sumSq += row[x] * row[x];
+            count++;
+        }
+    }
+    
+    double mean = sum / count;
+    double stddev = std::sqrt(std::max(sumSq / count - mean * mean, 1e-12));
+    return static_cast<float>((peak - mean) / stddev);
+}
+
+} // namespace sar
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "config.h"
+
+namespace sar {
+
+struct TrackState {
+    bool active = false;
+    bool lost = false;              // Peak too weak; position is coasting
+    cv::Rect2f box;                 // Source frame pixel coordinates
+    cv::Point2f offset;             // Target centre minus frame centre (pixels)
+    float psr = 0.0f;
+    double costMs = 0.0;            // Smoothed cost of a filter update
+    uint64_t skipped = 0;           // Updates skipped to stay within budget
+};
+
+// MOSSE correlation-filter tracker. All spectra and scratch buffers are sized once at
+// lock time and reused, so a frame costs one small ROI resample and two fixed-size DFTs.
+class Tracker {
+public:
+    Tracker();
+    
+    void init(const TrackerConfig& config);
+    
+    // Lock onto the region centred on the frame (under the crosshair)
+    bool start(const cv::Mat& frame);
+    void stop();
+    
+    void update(const cv::Mat& frame);
+    
+    bool isActive() const { return m_state.active; }
+    const TrackState& getState() const { return m_state; }
+    
+    // Normalised -1.0..1.0 pan/tilt rate commands that re-centre the target
+    void getSteering(float& pan, float& tilt) const;
+    
+private:
+    void extractPatch(const cv::Mat& frame, cv::Point2f center);
+    void computeSpectrum();
+    void train(double rate);
+    float correlate(cv::Point2f& shift);
+    
+    TrackerConfig m_config;
+    TrackState m_state;
+    
+    cv::Point2f m_center;
+    cv::Point2f m_velocity;         // Pixels per frame, used to coast skipped frames
+    cv::Size m_frameSize;
+    int m_window = 96;              // Source pixels tracked; follows the source resolution
+    int m_size = 64;
+    float m_windowScale = 1.0f;     // Source pixels per filter pixel
+    int m_framesToSkip = 0;
+    
+    // Preallocated buffers (m_size x m_size)
+    cv::Mat m_patchColor;
+    cv::Mat m_patchGray;
+    cv::Mat m_patchResized;
+    cv::Mat m_patch;
+    cv::Mat m_cosWindow;
+    cv::Mat m_targetSpectrum;       // G
+    cv::Mat m_spectrum;             // F
+    cv::Mat m_numerator;            // A = G . conj(F)
+    cv::Mat m_denominator;          // B = F . conj(F)
+    cv::Mat m_scratch;
+    cv::Mat m_filter;               // H* = A / B
+    cv::Mat m_responseSpectrum;
+    cv::Mat m_response;
+};
+
+} // namespace sar
@@ -1,17 +1,106 @@
 #include "video.h"
+#include "threads.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cstdlib>
 
 namespace sar {
 
+// Low-latency mode: never drain more than this many queued frames in one go
+static constexpr int kMaxDrainFrames = 30;
+
+static Counter& s_framesCaptured = Metrics::instance().counter(
+    "sar_capture_frames_total", "Frames published by the capture thread");
+static Counter& s_framesDropped = Metrics::instance().counter(
+    "sar_capture_dropped_frames_total", "Stale frames skipped by low-latency ingest");
+static Counter& s_reconnects = Metrics::instance().counter(
+    "sar_video_reconnects_total", "Successful video source reconnects");
+static Gauge& s_captureFps = Metrics::instance().gauge(
+    "sar_capture_fps", "Frames published by the capture thread per second");
+static Gauge& s_connected = Metrics::instance().gauge(
+    "sar_video_connected", "1 while the video source is connected");
+static Gauge& s_captureLag = Metrics::instance().gauge(
+    "sar_capture_lag_ms", "Smoothed source-to-publish lag in low-latency mode");
+static Counter& s_busPublished = Metrics::instance().counter(
+    "sar_frame_bus_published_total", "Frames written to the shared-memory frame bus");
+static Counter& s_busOverruns = Metrics::instance().counter(
+    "sar_frame_bus_overruns_total", "Bus frames overwritten by the writer while being copied out");
+static Counter& s_switches = Metrics::instance().counter(
+    "sar_video_source_switches_total", "Switches between the substream and the main stream");
+static Gauge& s_mainStream = Metrics::instance().gauge(
+    "sar_video_main_stream", "1 while the high-resolution main stream is shown");
+static Gauge& s_standby = Metrics::instance().gauge(
+    "sar_video_standby_decoding", "1 while the other stream is decoding ahead of a switch");
+static Histogram& s_readTime = Metrics::instance().stage("capture_read");
+
+// "shm:<name>" reads frames another simulator publishes on the frame bus
+static constexpr const char* kBusSourcePrefix = "shm:";
+
+static bool isBusSource(const std::string& source) {
+    return source.rfind(kBusSourcePrefix, 0) == 0;
+}
+
+static bool isFileSource(const std::string& source) {
+    if (isBusSource(source)) return false;
+    try {
+        std::stoi(source);
+        return false;
+    } catch (...) {
+        return source.find("://") == std::string::npos;
+    }
+}
+
+static void setLowDelayCaptureOptions() {
+    // Ask the FFmpeg backend not to buffer; respect options the user already set
+    if (std::getenv("OPENCV_FFMPEG_CAPTURE_OPTIONS")) return;
+#ifdef _WIN32
+    _putenv_s("OPENCV_FFMPEG_CAPTURE_OPTIONS", "fflags;nobuffer|flags;low_delay");
+#else
+    setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", "fflags;nobuffer|flags;low_delay", 0);
+#endif
+}
+
 Video::Video() {}
 
 Video::~Video() {
     shutdown();
 }
 
-bool Video::init(const VideoConfig& config) {
+bool Video::init(const VideoConfig& config, const PlaybackConfig& playback, const FrameBusConfig& frameBus) {
     m_config = config;
+    m_playbackConfig = playback;
+    
+    if (isBusSource(config.source)) {
+        m_busName = config.source.substr(std::string(kBusSourcePrefix).size());
+    }
+    if (frameBus.enabled) {
+        if (frameBus.name == m_busName) {
+            std::cerr << "Frame bus: not republishing '" << m_busName << "' onto itself" << std::endl;
+        } else {
+            m_busWriter.open(frameBus.name, frameBus.slots);
+        }
+    }
+    
+    if (playback.enabled && isFileSource(config.source)) {
+        m_playback = std::make_unique<Playback>();
+    }
+    
+    // Files are paced by the reader, so stale-frame dropping only applies to live sources
+    m_lowLatency = config.low_latency && !isFileSource(config.source) && m_busName.empty();
+    if (m_lowLatency) {
+        setLowDelayCaptureOptions();
+    }
+    
+    m_dual = !config.main_source.empty() && !isFileSource(config.source) && m_busName.empty();
+    if (m_dual) {
+        std::cout << "Video: substream " << config.source << ", main stream " << config.main_source
+                  << " from zoom " << config.switch_zoom << "x" << std::endl;
+    } else if (!config.main_source.empty()) {
+        std::cerr << "Video: main_source only applies to live sources, ignored" << std::endl;
+    }
     
     if (!openSource()) {
         std::cerr << "Warning: Could not open video source. Will retry in background." << std::endl;
@@ -30,70 +119,296 @@ void Video::shutdown() {
     if (m_thread.joinable()) {
         m_thread.join();
     }
+    stopWarm();
+    if (m_warmThread.joinable()) {
+        m_warmThread.join();
+    }
     
-    if (m_capture.isOpened()) {
-        m_capture.release();
+    for (auto& capture : m_captures) {
+        if (capture.isOpened()) {
+            capture.release();
+        }
+    }
+    if (m_playback) {
+        m_playback->close();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_busReader.detach();
     }
+    m_busWriter.close();
     
     m_connected = false;
 }
 
 bool Video::openSource() {
-    // Guard against concurrent access (init vs captureThread)
-    std::lock_guard<std::mutex> lock(m_frameMutex);
+    // m_capture is only touched by init() before the capture thread starts, by the
+    // capture thread itself, and by shutdown() after it has joined, so no lock is held
+    // here; holding m_frameMutex would stall getFrame() for the whole (re)connect.
     
-    // Try to parse as integer (camera index) or string (URL/file)
-    try {
-        int cameraIndex = std::stoi(m_config.source);
-        m_capture.open(cameraIndex);
-    } catch (...) {
-        // Not an integer, treat as URL or file path
-        m_capture.open(m_config.source);
+    if (!m_busName.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            if (!m_busReader.attach(m_busName)) {
+                m_connected = false;
+                return false;
+            }
+            // Left behind by a writer that died; wait for a new one to replace it
+            if (!m_busReader.writerAlive()) {
+                m_busReader.detach();
+                m_connected = false;
+                return false;
+            }
+        }
+        
+        // Geometry is only known once the first frame arrives; fps follows the writer
+        FrameView view;
+        if (m_busReader.acquire(view)) {
+            setFormat(view.width, view.height, m_config.fps);
+        } else {
+            setFormat(0, 0, m_config.fps);
+        }
+        
+        std::cout << "Frame bus attached: " << m_busName << std::endl;
+        m_connected = true;
+        return true;
+    }
+    
+    if (m_playback) {
+        if (!m_playback->open(m_config.source, m_playbackConfig)) {
+            m_connected = false;
+            return false;
+        }
+        setFormat(m_playback->getWidth(), m_playback->getHeight(), m_playback->getFps());
+        
+        std::cout << "Video file opened for playback: " << m_config.source << std::endl;
+        std::cout << "  Resolution: " << m_format.width << "x" << m_format.height << " @ " << m_format.fps << " fps, "
+                  << m_playbackConfig.decode_ahead << " frames decoded ahead" << std::endl;
+        
+        m_connected = true;
+        return true;
     }
     
-    if (!m_capture.isOpened()) {
+    const bool main = m_onMain.load();
+    if (!openCapture(*m_capture, main)) {
         m_connected = false;
         return false;
     }
     
-    // Set capture properties
-    m_capture.set(cv::CAP_PROP_FRAME_WIDTH, m_config.width);
-    m_capture.set(cv::CAP_PROP_FRAME_HEIGHT, m_config.height);
-    m_capture.set(cv::CAP_PROP_FPS, m_config.fps);
+    if (m_lowLatency) {
+        m_epoch = std::chrono::steady_clock::now();
+        m_hasSkewBase = false;
+    }
     
     // Get actual properties (may differ from requested)
-    m_width = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_WIDTH));
-    m_height = static_cast<int>(m_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
-    m_fps = m_capture.get(cv::CAP_PROP_FPS);
+    int width = static_cast<int>(m_capture->get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(m_capture->get(cv::CAP_PROP_FRAME_HEIGHT));
+    double fps = m_capture->get(cv::CAP_PROP_FPS);
     
-    if (m_fps <= 0) m_fps = 30.0; // Default fallback
+    if (fps <= 0) fps = 30.0; // Default fallback
     
     // Set sensible defaults if camera reports 0 (common with some drivers)
-    if (m_width <= 0) m_width = m_config.width;
-    if (m_height <= 0) m_height = m_config.height;
+    if (width <= 0) width = main ? m_config.main_width : m_config.width;
+    if (height <= 0) height = main ? m_config.main_height : m_config.height;
+    setFormat(width, height, fps);
     
-    std::cout << "Video source opened: " << m_config.source << std::endl;
-    std::cout << "  Resolution: " << m_width << "x" << m_height << " @ " << m_fps << " fps" << std::endl;
+    std::cout << "Video source opened: " << (main ? m_config.main_source : m_config.source) << std::endl;
+    std::cout << "  Resolution: " << width << "x" << height << " @ " << fps << " fps" << std::endl;
     
     m_connected = true;
     return true;
 }
 
+bool Video::openCapture(cv::VideoCapture& capture, bool main) {
+    const std::string& source = main ? m_config.main_source : m_config.source;
+    
+    // Try to parse as integer (camera index) or string (URL/file)
+    try {
+        int cameraIndex = std::stoi(source);
+        capture.open(cameraIndex);
+    } catch (...) {
+        // Not an integer, treat as URL or file path
+        capture.open(source);
+    }
+    
+    if (!capture.isOpened()) {
+        return false;
+    }
+    
+    // Set capture properties
+    capture.set(cv::CAP_PROP_FRAME_WIDTH, main ? m_config.main_width : m_config.width);
+    capture.set(cv::CAP_PROP_FRAME_HEIGHT, main ? m_config.main_height : m_config.height);
+    capture.set(cv::CAP_PROP_FPS, m_config.fps);
+    
+    if (m_lowLatency) {
+        // Keep the backend queue as short as it allows; the rest is drained with grab()
+        capture.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    }
+    return true;
+}
+
+void Video::updateSources() {
+    const float zoom = m_zoom.load();
+    const bool onMain = m_onMain.load();
+    const float low = m_config.switch_zoom - std::max(m_config.switch_band, 0.0f);
+    
+    // Up at switch_zoom, back down only below the band, so hovering never flaps;
+    // inside the band the other stream stays warm either way
+    const bool wantMain = onMain ? zoom >= low : zoom >= m_config.switch_zoom;
+    const bool wantStandby = wantMain != onMain || (zoom >= low && zoom < m_config.switch_zoom);
+    
+    std::unique_lock<std::mutex> lock(m_warmMutex);
+    if (!wantStandby) {
+        if (m_warming) {
+            lock.unlock();
+            stopWarm();
+        }
+        return;
+    }
+    if (!m_warming) {
+        lock.unlock();
+        startWarm();
+        return;
+    }
+    if (wantMain == onMain || m_warmFrames.load() < std::max(1, m_config.warm_frames)) {
+        // The zoom went back before the swap; let the standby keep decoding
+        if (m_handover) {
+            m_handover = false;
+            lock.unlock();
+            m_warmCv.notify_all();
+        }
+        return;
+    }
+    
+    // The warm thread parks after its current read; this thread keeps publishing
+    // from the old stream until then, so the display never goes blank
+    if (!m_parked) {
+        m_handover = true;
+        return;
+    }
+    
+    std::swap(m_capture, m_standby);
+    m_onMain = wantMain;
+    m_warmFrames = std::max(1, m_config.warm_frames);     // The old stream was live until now
+    m_handover = false;
+    lock.unlock();
+    m_warmCv.notify_all();
+    
+    int width = static_cast<int>(m_capture->get(cv::CAP_PROP_FRAME_WIDTH));
+    int height = static_cast<int>(m_capture->get(cv::CAP_PROP_FRAME_HEIGHT));
+    if (width <= 0) width = wantMain ? m_config.main_width : m_config.width;
+    if (height <= 0) height = wantMain ? m_config.main_height : m_config.height;
+    double fps = m_capture->get(cv::CAP_PROP_FPS);
+    setFormat(width, height, fps > 0 ? fps : m_format.fps);
+    
+    // Timestamps restart with the stream
+    if (m_lowLatency) {
+        m_epoch = std::chrono::steady_clock::now();
+        m_hasSkewBase = false;
+    }
+    
+    Trace::instant("capture.switch");
+    s_switches.inc();
+    s_mainStream.set(wantMain ? 1.0 : 0.0);
+    std::cout << "Video: switched to " << (wantMain ? "main stream" : "substream") << " (" << width << "x"
+              << height << ") at zoom " << zoom << "x" << std::endl;
+}
+
+void Video::startWarm() {
+    // A stopped warm thread finishes its last read before exiting
+    if (m_warmThread.joinable()) {
+        m_warmThread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_warmMutex);
+        m_warming = true;
+        m_handover = false;
+        m_parked = false;
+    }
+    m_warmFrames = 0;
+    s_standby.set(1.0);
+    m_warmThread = std::thread(&Video::warmThread, this);
+}
+
+void Video::stopWarm() {
+    {
+        std::lock_guard<std::mutex> lock(m_warmMutex);
+        m_warming = false;
+        m_handover = false;
+    }
+    m_warmCv.notify_all();
+}
+
+void Video::warmThread() {
+    applyThreadTopology("capture");
+    
+    cv::Mat frame;
+    while (m_running) {
+        {
+            std::unique_lock<std::mutex> lock(m_warmMutex);
+            if (m_handover) {
+                m_parked = true;
+                m_warmCv.wait(lock, [this] { return !m_handover || !m_warming; });
+                m_parked = false;
+            }
+            if (!m_warming) break;
+        }
+        
+        // m_standby may point at the other capture after a swap; re-read it every pass
+        cv::VideoCapture& standby = *m_standby;
+        if (!standby.isOpened()) {
+            SAR_TRACE_SCOPE("capture.warm_open");
+            if (!openCapture(standby, !m_onMain.load())) {
+                std::unique_lock<std::mutex> lock(m_warmMutex);
+                m_warmCv.wait_for(lock, std::chrono::milliseconds(m_config.reconnect_delay_ms),
+                                  [this] { return !m_warming; });
+                continue;
+            }
+            m_warmFrames = 0;
+        }
+        
+        // Decoded and dropped; it only has to be current when the swap comes
+        if (standby.read(frame) && !frame.empty()) {
+            m_warmFrames++;
+        } else {
+            standby.release();
+            m_warmFrames = 0;
+        }
+    }
+    
+    // Nothing decodes the stream that is not shown once the zoom leaves the band
+    m_standby->release();
+    m_warmFrames = 0;
+    s_standby.set(0.0);
+}
+
 void Video::captureThread() {
+    applyThreadTopology("capture");
+    
+    if (m_playback) {
+        playbackThread();
+        return;
+    }
+    if (!m_busName.empty()) {
+        busThread();
+        return;
+    }
+    
     cv::Mat frame;
-    cv::VideoCapture localCapture;
     bool needsReconnect = false;
+    auto reportStart = std::chrono::steady_clock::now();
+    uint64_t reportDropped = 0;
+    auto fpsStart = std::chrono::steady_clock::now();
+    int fpsCount = 0;
     
     while (m_running) {
         // Check if we need to reconnect
-        {
-            std::lock_guard<std::mutex> lock(m_frameMutex);
-            if (!m_capture.isOpened()) {
-                needsReconnect = true;
-            }
+        if (!m_capture->isOpened()) {
+            needsReconnect = true;
         }
         
         if (needsReconnect) {
+            SAR_TRACE_SCOPE("capture.reconnect");
             m_connected = false;
             
             // Try to reconnect
@@ -101,49 +416,286 @@ void Video::captureThread() {
             
             if (m_running && openSource()) {
                 std::cout << "Video source reconnected." << std::endl;
+                s_reconnects.inc();
             }
             needsReconnect = false;
             continue;
         }
         
-        // Read frame (don't hold lock during blocking read)
-        bool readSuccess = false;
+        if (m_dual) {
+            updateSources();
+        }
+        
+        // Read frame without holding the frame lock
+        bool readSuccess;
         {
-            std::lock_guard<std::mutex> lock(m_frameMutex);
-            if (m_capture.isOpened()) {
-                readSuccess = m_capture.read(frame);
-            }
+            SAR_TRACE_SCOPE("capture.read");
+            ScopedTimer timer(s_readTime);
+            readSuccess = m_lowLatency ? grabLatest(frame) : m_capture->read(frame);
         }
         
         if (readSuccess && !frame.empty()) {
-            std::lock_guard<std::mutex> lock(m_frameMutex);
-            m_latestFrame = frame.clone();
-            m_newFrame = true;
-            m_connected = true;
+            publish(frame);
+            fpsCount++;
+            
+            if (m_lowLatency) {
+                double lag = measureLag();
+                if (lag >= 0) {
+                    m_latencyMs = m_latencyMs.load() * 0.9 + lag * 0.1;
+                    s_captureLag.set(m_latencyMs.load());
+                }
+            }
         } else if (!readSuccess) {
             // Read failed, probably disconnected
-            {
-                std::lock_guard<std::mutex> lock(m_frameMutex);
-                m_capture.release();
-            }
+            Trace::instant("capture.disconnected");
+            m_capture->release();
             m_connected = false;
+            s_connected.set(0.0);
             std::cout << "Video source disconnected. Attempting to reconnect..." << std::endl;
             needsReconnect = true;
         }
         
-        // Small sleep to prevent busy-spinning
+        auto fpsNow = std::chrono::steady_clock::now();
+        double fpsElapsed = std::chrono::duration<double>(fpsNow - fpsStart).count();
+        if (fpsElapsed >= 1.0) {
+            s_captureFps.set(fpsCount / fpsElapsed);
+            fpsCount = 0;
+            fpsStart = fpsNow;
+        }
+        
+        if (m_lowLatency) {
+            // grab() blocks until the next frame arrives, so no sleep is needed
+            auto now = std::chrono::steady_clock::now();
+            if (now - reportStart >= std::chrono::seconds(10)) {
+                uint64_t dropped = m_droppedFrames.load();
+                if (dropped != reportDropped) {
+                    std::cout << "Video ingest: lag " << static_cast<int>(m_latencyMs.load()) << " ms, "
+                              << (dropped - reportDropped) << " stale frames dropped" << std::endl;
+                }
+                reportDropped = dropped;
+                reportStart = now;
+            }
+        } else {
+            // Small sleep to prevent busy-spinning
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void Video::playbackThread() {
+    // Playback::present() blocks until the next frame is due, so this loop is paced
+    // by the file's timestamps rather than by read() returning
+    cv::Mat frame;
+    auto fpsStart = std::chrono::steady_clock::now();
+    int fpsCount = 0;
+    
+    while (m_running) {
+        if (!m_connected) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_config.reconnect_delay_ms));
+            if (m_running && openSource()) {
+                s_reconnects.inc();
+            }
+            continue;
+        }
+        
+        if (m_playback->present(frame, 100)) {
+            publish(frame);
+            fpsCount++;
+        }
+        
+        auto fpsNow = std::chrono::steady_clock::now();
+        double fpsElapsed = std::chrono::duration<double>(fpsNow - fpsStart).count();
+        if (fpsElapsed >= 1.0) {
+            s_captureFps.set(fpsCount / fpsElapsed);
+            fpsCount = 0;
+            fpsStart = fpsNow;
+        }
+    }
+}
+
+void Video::busThread() {
+    // The pixels stay in shared memory and getFrame() copies straight out of the
+    // writer's slot; this thread only follows the writer's sequence and reattaches
+    // when it restarts or changes resolution
+    auto fpsStart = std::chrono::steady_clock::now();
+    int fpsCount = 0;
+    auto lastFrame = std::chrono::steady_clock::now();
+    
+    while (m_running) {
+        // A writer that died without closing leaves its segment behind, and a restarted
+        // writer replaces it under the same name; only a fresh attach reaches the new one
+        bool stalled = m_connected && std::chrono::steady_clock::now() - lastFrame >
+                                      std::chrono::milliseconds(m_config.reconnect_delay_ms);
+        if (!m_connected || m_busReader.writerClosed() || (stalled && !m_busReader.writerAlive())) {
+            if (m_connected) {
+                Trace::instant("capture.bus_closed");
+                std::cout << "Frame bus writer " << (stalled ? "lost" : "closed") << ". Reattaching..." << std::endl;
+                std::lock_guard<std::mutex> lock(m_frameMutex);
+                m_busReader.detach();
+                m_busSequence = 0;
+                m_connected = false;
+                s_connected.set(0.0);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_config.reconnect_delay_ms));
+            if (m_running && openSource()) {
+                s_reconnects.inc();
+                lastFrame = std::chrono::steady_clock::now();
+            }
+            continue;
+        }
+        
+        FrameView view;
+        if (m_busReader.acquire(view, m_busSequence)) {
+            std::lock_guard<std::mutex> lock(m_frameMutex);
+            // getFrame() may have counted this frame already
+            if (view.sequence > m_busSequence) {
+                m_busSequence = view.sequence;
+                m_frameSequence++;
+            }
+            m_format.width = view.width;
+            m_format.height = view.height;
+            m_newFrame = true;
+            fpsCount++;
+            lastFrame = std::chrono::steady_clock::now();
+            s_framesCaptured.inc();
+            s_connected.set(1.0);
+        } else if (stalled) {
+            // Writer still running but quiet (paused or blocked); keep its last frame
+            s_connected.set(0.0);
+        }
+        
+        auto fpsNow = std::chrono::steady_clock::now();
+        double fpsElapsed = std::chrono::duration<double>(fpsNow - fpsStart).count();
+        if (fpsElapsed >= 1.0) {
+            s_captureFps.set(fpsCount / fpsElapsed);
+            fpsCount = 0;
+            fpsStart = fpsNow;
+        }
+        
+        // Polling at ~1 kHz keeps the added latency under a millisecond
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
 
+void Video::publish(cv::Mat& frame) {
+    if (m_busWriter.publish(frame.data, frame.cols, frame.rows, frame.type(), frame.step,
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::steady_clock::now().time_since_epoch()).count())) {
+        s_busPublished.inc();
+    }
+    
+    // Publish by handing over the buffer; the next read allocates a fresh one
+    {
+        SAR_TRACE_SCOPE("capture.publish");
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        m_latestFrame = frame;
+        m_frameSequence++;
+        m_newFrame = true;
+        m_connected = true;
+    }
+    frame = cv::Mat();
+    s_framesCaptured.inc();
+    s_connected.set(1.0);
+}
+
+VideoFormat Video::getFormat() const {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    return m_format;
+}
+
+void Video::setFormat(int width, int height, double fps) {
+    std::lock_guard<std::mutex> lock(m_frameMutex);
+    m_format.width = width;
+    m_format.height = height;
+    m_format.fps = fps;
+}
+
+bool Video::grabLatest(cv::Mat& frame) {
+    using Clock = std::chrono::steady_clock;
+    const double frameIntervalMs = 1000.0 / m_format.fps;
+    int drained = 0;
+    
+    // Pull queued packets with the cheap grab() and only retrieve() the one we show
+    while (true) {
+        auto start = Clock::now();
+        if (!m_capture->grab()) {
+            return false;
+        }
+        double grabMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        
+        // With timestamps, drop while over the latency bound; without them, a grab that
+        // returns well inside the frame interval came out of a buffer rather than the wire
+        double lag = measureLag();
+        bool stale = (lag >= 0) ? lag > m_config.max_latency_ms : grabMs < frameIntervalMs * 0.25;
+        
+        if (!stale || drained >= kMaxDrainFrames) break;
+        drained++;
+    }
+    
+    if (drained > 0) {
+        Trace::instant("capture.drop_stale");
+        m_droppedFrames += drained;
+        s_framesDropped.inc(drained);
+    }
+    
+    return m_capture->retrieve(frame);
+}
+
+double Video::measureLag() {
+    // Returns how far the last grabbed frame trails real time relative to the best
+    // (lowest-delay) frame seen since connecting, or -1 if the source has no timestamps
+    double pts = m_capture->get(cv::CAP_PROP_POS_MSEC);
+    if (pts <= 0) {
+        return -1.0;
+    }
+    
+    double wall = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_epoch).count();
+    double skew = wall - pts;
+    if (!m_hasSkewBase || skew < m_skewBase) {
+        m_skewBase = skew;
+        m_hasSkewBase = true;
+    }
+    return skew - m_skewBase;
+}
+
 bool Video::getFrame(cv::Mat& frame) {
+    uint64_t sequence;
+    return getFrame(frame, sequence);
+}
+
+bool Video::getFrame(cv::Mat& frame, uint64_t& sequence) {
     std::lock_guard<std::mutex> lock(m_frameMutex);
     
+    if (!m_busName.empty()) {
+        // Copy out of the writer's slot, then confirm it wasn't overwritten meanwhile;
+        // a lapped copy is retried on the newest frame
+        for (int attempt = 0; attempt < 3 && m_busSequence != 0; attempt++) {
+            FrameView view;
+            if (!m_busReader.acquire(view)) break;
+            cv::Mat shared(view.height, view.width, view.type, const_cast<uint8_t*>(view.data), view.stride);
+            frame = shared.clone();
+            if (m_busReader.stillValid(view)) {
+                // The writer's numbering restarts with it, which would look like time
+                // going backwards to the detector and HUD; hand out our own instead
+                if (view.sequence > m_busSequence) {
+                    m_busSequence = view.sequence;
+                    m_frameSequence++;
+                }
+                sequence = m_frameSequence;
+                m_newFrame = false;
+                return true;
+            }
+            s_busOverruns.inc();
+        }
+        return false;
+    }
+    
     if (m_latestFrame.empty()) {
         return false;
     }
     
     frame = m_latestFrame.clone();
+    sequence = m_frameSequence;
     m_newFrame = false;
     return true;
 }
@@ -5,42 +5,111 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include "config.h"
+#include "playback.h"
+#include "frame_bus.h"
 
 namespace sar {
 
+// Geometry and rate of the frames the source is delivering, taken together
+struct VideoFormat {
+    int width = 0;
+    int height = 0;
+    double fps = 0;
+};
+
 class Video {
 public:
     Video();
     ~Video();
     
-    bool init(const VideoConfig& config);
+    bool init(const VideoConfig& config, const PlaybackConfig& playback, const FrameBusConfig& frameBus);
     void shutdown();
     
     bool getFrame(cv::Mat& frame);
+    bool getFrame(cv::Mat& frame, uint64_t& sequence);
     bool isConnected() const { return m_connected.load(); }
     
-    int getWidth() const { return m_width; }
-    int getHeight() const { return m_height; }
-    double getFps() const { return m_fps; }
+    // Any thread. The source can change resolution (stream switch, bus writer restart),
+    // so callers needing more than one field take a single snapshot.
+    VideoFormat getFormat() const;
+    int getWidth() const { return getFormat().width; }
+    int getHeight() const { return getFormat().height; }
+    double getFps() const { return getFormat().fps; }
+    
+    // Low-latency ingest statistics
+    double getLatencyMs() const { return m_latencyMs.load(); }
+    uint64_t getDroppedFrames() const { return m_droppedFrames.load(); }
+    
+    // File playback controls; nullptr for live sources or with playback disabled
+    Playback* getPlayback() { return m_playback.get(); }
+    
+    // Dual-resolution sources follow the simulated zoom; safe from any thread
+    void setZoom(float zoom) { m_zoom = zoom; }
+    bool onMainStream() const { return m_onMain.load(); }
     
 private:
     void captureThread();
+    void playbackThread();
+    void busThread();
+    void warmThread();
     bool openSource();
+    bool openCapture(cv::VideoCapture& capture, bool main);
+    void updateSources();
+    void startWarm();
+    void stopWarm();
+    void publish(cv::Mat& frame);
+    bool grabLatest(cv::Mat& frame);
+    void setFormat(int width, int height, double fps);
+    double measureLag();
     
     VideoConfig m_config;
-    cv::VideoCapture m_capture;
+    PlaybackConfig m_playbackConfig;
+    cv::VideoCapture m_captures[2];
+    cv::VideoCapture* m_capture = &m_captures[0];   // Shown; owned by the capture thread
+    cv::VideoCapture* m_standby = &m_captures[1];   // Warming up; owned by the warm thread while it runs
+    std::unique_ptr<Playback> m_playback;
+    
+    // Shared-memory frame bus: publishing side, and the "shm:<name>" source side
+    FrameBusWriter m_busWriter;
+    FrameBusReader m_busReader;         // Attach/detach under m_frameMutex
+    std::string m_busName;
+    uint64_t m_busSequence = 0;         // Writer's numbering; restarts with the writer
     
     std::thread m_thread;
-    std::mutex m_frameMutex;
+    mutable std::mutex m_frameMutex;
     cv::Mat m_latestFrame;
+    uint64_t m_frameSequence = 0;       // Ours, never goes backwards; also counts bus frames
     std::atomic<bool> m_running{false};
     std::atomic<bool> m_connected{false};
     std::atomic<bool> m_newFrame{false};
     
-    int m_width = 0;
-    int m_height = 0;
-    double m_fps = 0;
+    VideoFormat m_format;               // Under m_frameMutex; the source's thread may read it unlocked
+    
+    // Low-latency mode state (capture thread only, except the atomics)
+    bool m_lowLatency = false;
+    std::chrono::steady_clock::time_point m_epoch;
+    double m_skewBase = 0;
+    bool m_hasSkewBase = false;
+    std::atomic<double> m_latencyMs{0};
+    std::atomic<uint64_t> m_droppedFrames{0};
+    
+    // Dual-resolution switching. The warm thread decodes the other stream while the
+    // zoom is near the threshold, and parks when asked so the capture thread can
+    // swap the two captures between reads.
+    bool m_dual = false;
+    std::atomic<float> m_zoom{1.0f};
+    std::atomic<bool> m_onMain{false};
+    std::thread m_warmThread;
+    std::mutex m_warmMutex;
+    std::condition_variable m_warmCv;
+    bool m_warming = false;             // Under m_warmMutex: the warm thread should keep going
+    bool m_handover = false;            // Under m_warmMutex: the capture thread wants the standby
+    bool m_parked = false;              // Under m_warmMutex: the warm thread is waiting for the swap
+    std::atomic<int> m_warmFrames{0};   // Decoded by the standby since it opened
 };
 
 } // namespace sar
@@ -0,0 +1,485 @@
+// Soak harness: runs the capture -> effects -> detector -> HUD -> recorder pipeline
+// headlessly for a long time while forcing video reconnects, joystick hot-plugs and
+// recording toggles, and checks that the process does not leak memory, file
+// descriptors or threads, and that every frame handed to the recorder is written.
+//
+// Registered with ctest as a short run; for a training-day run use e.g.
+//   sar_soak --duration 28800 --report soak_8h.csv
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <thread>
+#include <SDL.h>
+#include <opencv2/opencv.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "config.h"
+#include "joystick.h"
+#include "video.h"
+#include "hud.h"
+#include "recorder.h"
+#include "detector.h"
+#include "gimbal.h"
+#include "effects.h"
+#include "metrics.h"
+
+using namespace sar;
+namespace fs = std::filesystem;
+
+struct SoakOptions {
+    double duration = 60.0;            // Seconds
+    std::string source;                // Empty = generate a clip
+    std::string report = "soak_report.csv";
+    double cycleSeconds = 6.0;         // Recording toggles every cycle
+    double reconnectSeconds = 15.0;    // Video shutdown/init
+    double replugSeconds = 20.0;       // Virtual joystick detach/attach
+    double sampleSeconds = 1.0;
+    double warmupSeconds = 10.0;       // Excluded from the baseline
+    double maxRssGrowthMb = 64.0;
+    int fdSlack = 4;
+    int threadSlack = 2;
+    int frameSlack = 0;                // Allowed frames-in vs frames-written mismatch per recording
+};
+
+struct ProcessStats {
+    double rssMb = -1;
+    int fds = -1;                      // Handles on Windows
+    int threads = -1;
+};
+
+struct Sample {
+    double elapsed;
+    ProcessStats stats;
+    bool recording;
+    uint64_t framesIn;
+    uint64_t framesWritten;
+    uint64_t framesDropped;
+    int reconnects;
+    int replugs;
+};
+
+static ProcessStats sampleProcess() {
+    ProcessStats stats;
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    if (statm >> pages >> resident) {
+        stats.rssMb = resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+    }
+    std::error_code ec;
+    stats.fds = static_cast<int>(std::distance(fs::directory_iterator("/proc/self/fd", ec), fs::directory_iterator()));
+    stats.threads = static_cast<int>(std::distance(fs::directory_iterator("/proc/self/task", ec), fs::directory_iterator()));
+#elif defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        stats.rssMb = counters.WorkingSetSize / (1024.0 * 1024.0);
+    }
+    DWORD handles = 0;
+    if (GetProcessHandleCount(GetCurrentProcess(), &handles)) {
+        stats.fds = static_cast<int>(handles);
+    }
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if (snapshot != INVALID_HANDLE_VALUE) {
+        THREADENTRY32 entry;
+        entry.dwSize = sizeof(entry);
+        int count = 0;
+        for (BOOL ok = Thread32First(snapshot, &entry); ok; ok = Thread32Next(snapshot, &entry)) {
+            if (entry.th32OwnerProcessID == GetCurrentProcessId()) count++;
+        }
+        CloseHandle(snapshot);
+        stats.threads = count;
+    }
+#endif
+    return stats;
+}
+
+// Reads a counter from the metrics exposition, so the harness sees exactly what a scrape would
+static uint64_t metricValue(const std::string& name) {
+    std::istringstream text(Metrics::instance().render());
+    std::string line;
+    while (std::getline(text, line)) {
+        if (line.size() > name.size() && line.compare(0, name.size(), name) == 0 && line[name.size()] == ' ') {
+            return std::stoull(line.substr(name.size() + 1));
+        }
+    }
+    return 0;
+}
+
+// A few seconds of moving shapes, so the detector and encoder see real motion
+static bool generateClip(const std::string& path) {
+    const cv::Size size(640, 360);
+    const int fps = 30;
+    cv::VideoWriter writer(path, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps, size);
+    if (!writer.isOpened()) return false;
+    
+    cv::Mat frame(size, CV_8UC3);
+    for (int i = 0; i < fps * 5; i++) {
+        frame.setTo(cv::Scalar(90, 70, 40));
+        int x = (i * 7) % size.width;
+        cv::rectangle(frame, cv::Rect(x, 150, 40, 24), cv::Scalar(20, 120, 255), -1);
+        cv::circle(frame, cv::Point(size.width - x, 80 + (i % 60)), 10, cv::Scalar(230, 230, 230), -1);
+        cv::putText(frame, std::to_string(i), cv::Point(10, 340), cv::FONT_HERSHEY_SIMPLEX, 0.8,
+                    cv::Scalar(255, 255, 255), 2);
+        writer.write(frame);
+    }
+    return true;
+}
+
+static int countFrames(const std::string& path) {
+    cv::VideoCapture capture(path);
+    if (!capture.isOpened()) return -1;
+    int count = 0;
+    cv::Mat frame;
+    while (capture.read(frame)) count++;
+    return count;
+}
+
+static void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [options]\n\n";
+    std::cout << "  --duration <s>          Run time (default 60)\n";
+    std::cout << "  --source <path>         Video file to loop (default: a generated clip)\n";
+    std::cout << "  --report <path>         Time-series CSV (default soak_report.csv)\n";
+    std::cout << "  --cycle <s>             Recording toggle period (default 6)\n";
+    std::cout << "  --reconnect <s>         Video reconnect period (default 15)\n";
+    std::cout << "  --replug <s>            Joystick unplug/replug period (default 20)\n";
+    std::cout << "  --max-rss-growth <MB>   Allowed RSS growth over the baseline (default 64)\n";
+    std::cout << "  --fd-slack <n>          Allowed fd/handle growth (default 4)\n";
+    std::cout << "  --thread-slack <n>      Allowed thread growth (default 2)\n";
+    std::cout << "  --frame-slack <n>       Allowed frames-in/written mismatch per recording (default 0)\n";
+}
+
+int main(int argc, char* argv[]) {
+    SoakOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--duration" && hasValue) options.duration = std::stod(argv[++i]);
+        else if (arg == "--source" && hasValue) options.source = argv[++i];
+        else if (arg == "--report" && hasValue) options.report = argv[++i];
+        else if (arg == "--cycle" && hasValue) options.cycleSeconds = std::stod(argv[++i]);
+        else if (arg == "--reconnect" && hasValue) options.reconnectSeconds = std::stod(argv[++i]);
+        else if (arg == "--replug" && hasValue) options.replugSeconds = std::stod(argv[++i]);
+        else if (arg == "--max-rss-growth" && hasValue) options.maxRssGrowthMb = std::stod(argv[++i]);
+        else if (arg == "--fd-slack" && hasValue) options.fdSlack = std::stoi(argv[++i]);
+        else if (arg == "--thread-slack" && hasValue) options.threadSlack = std::stoi(argv[++i]);
+        else if (arg == "--frame-slack" && hasValue) options.frameSlack = std::stoi(argv[++i]);
+        else {
+            printUsage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
+    options.warmupSeconds = std::min(options.warmupSeconds, options.duration / 4);
+    
+    fs::path workDir = fs::temp_directory_path() / ("sar_soak_" + std::to_string(
+        std::chrono::steady_clock::now().time_since_epoch().count()));
+    fs::create_directories(workDir / "recordings");
+    
+    Config config;
+    config.video.source = options.source;
+    if (config.video.source.empty()) {
+        config.video.source = (workDir / "clip.avi").string();
+        if (!generateClip(config.video.source)) {
+            std::cerr << "Soak: cannot write the generated clip (no MJPG encoder?)" << std::endl;
+            return 1;
+        }
+    }
+    config.recording.output_dir = (workDir / "recordings").string();
+    config.recording.format = "avi";
+    config.recording.codec = "MJPG";
+    // The frame accounting below follows one file: no clean, proxy or raw stream,
+    // no segments, whatever the defaults become
+    config.recording.include_hud = true;
+    config.recording.dual_stream = false;
+    config.recording.proxy_scale = 0.0;
+    config.recording.segment_seconds = 0.0;
+    config.recording.raw = false;
+    config.recording.encoder = "opencv";
+    config.detector.enabled = true;
+    config.effects.enabled = true;
+    config.joystick.button_mapping["record_toggle"] = 0;
+    
+    // A virtual joystick stands in for the operator's stick
+    if (SDL_Init(SDL_INIT_JOYSTICK) < 0) {
+        std::cerr << "Soak: SDL init failed: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    int virtualIndex = SDL_JoystickAttachVirtual(SDL_JOYSTICK_TYPE_GAMECONTROLLER, 3, 4, 1);
+    SDL_Joystick* virtualStick = virtualIndex >= 0 ? SDL_JoystickOpen(virtualIndex) : nullptr;
+    if (!virtualStick) {
+        std::cerr << "Soak: virtual joystick unavailable: " << SDL_GetError() << std::endl;
+    }
+#else
+    int virtualIndex = -1;
+    SDL_Joystick* virtualStick = nullptr;
+    std::cerr << "Soak: SDL " << SDL_MAJOR_VERSION << "." << SDL_MINOR_VERSION
+              << " has no virtual joysticks; joystick injection skipped" << std::endl;
+#endif
+    
+    Joystick joystick;
+    joystick.init(config.joystick);
+    
+    Video video;
+    if (!video.init(config.video, config.playback, config.frame_bus)) {
+        std::cerr << "Soak: cannot open " << config.video.source << std::endl;
+        return 1;
+    }
+    
+    Gimbal gimbal;
+    gimbal.init(config.gimbal);
+    Effects effects;
+    effects.init(config.effects, config.gimbal);
+    Detector detector;
+    detector.init(config.detector);
+    Hud hud;
+    hud.init(config.hud);
+    Recorder recorder;
+    recorder.init(config.recording);
+    
+    // Frame accounting for the recording in progress
+    uint64_t framesIn = 0;
+    uint64_t totalIn = 0;
+    uint64_t writtenAtStart = 0;
+    uint64_t droppedAtStart = 0;
+    std::string recordingFile;
+    int failures = 0;
+    int recordings = 0;
+    int startFailures = 0;
+    
+    auto startRecording = [&]() {
+        VideoFormat format = video.getFormat();
+        if (format.width <= 0 || format.height <= 0) return;
+        writtenAtStart = metricValue("sar_recorder_frames_total");
+        droppedAtStart = metricValue("sar_recorder_dropped_frames_total");
+        framesIn = 0;
+        if (!recorder.start(format.width, format.height, format.fps)) {
+            startFailures++;
+            std::cerr << "Soak: FAIL recording failed to start (" << format.width << "x" << format.height
+                      << " @ " << format.fps << " fps)" << std::endl;
+            failures++;
+            return;
+        }
+        recordingFile = recorder.getCurrentFilename();
+    };
+    
+    auto stopRecording = [&]() {
+        recorder.stop();
+        recordings++;
+        
+        uint64_t written = metricValue("sar_recorder_frames_total") - writtenAtStart;
+        uint64_t dropped = metricValue("sar_recorder_dropped_frames_total") - droppedAtStart;
+        int inFile = countFrames(recordingFile);
+        long long mismatch = static_cast<long long>(framesIn) - static_cast<long long>(written + dropped);
+        long long fileMismatch = inFile - static_cast<long long>(written);
+        if (std::llabs(mismatch) > options.frameSlack || std::llabs(fileMismatch) > options.frameSlack) {
+            std::cerr << "Soak: FAIL recording " << recordings << ": " << framesIn << " in, " << written
+                      << " written, " << dropped << " dropped, " << inFile << " in file" << std::endl;
+            failures++;
+        }
+        
+        // Keep an 8-hour run from filling the disk
+        std::error_code ec;
+        fs::remove(recordingFile, ec);
+    };
+    
+    joystick.setButtonCallback([&](int button, bool pressed) {
+        if (!pressed) return;
+        auto it = config.joystick.button_mapping.find("record_toggle");
+        if (it != config.joystick.button_mapping.end() && button == it->second) {
+            if (recorder.isRecording()) {
+                stopRecording();
+            } else {
+                startRecording();
+            }
+        }
+    });
+    
+    std::ofstream report(options.report);
+    report << "elapsed_s,rss_mb,fds,threads,recording,frames_in,frames_written,frames_dropped,reconnects,replugs\n";
+    
+    std::vector<Sample> samples;
+    int reconnects = 0;
+    int replugs = 0;
+    cv::Mat frame;
+    cv::Mat displayFrame;
+    DetectionResult detections;
+    uint64_t sequence = 0;
+    uint64_t lastSequence = 0;
+    
+    const auto start = std::chrono::steady_clock::now();
+    auto lastTick = start;
+    double nextToggle = options.cycleSeconds / 2;
+    double nextReconnect = options.reconnectSeconds;
+    double nextReplug = options.replugSeconds;
+    double nextSample = 0;
+    bool buttonHeld = false;
+    
+    std::cout << "Soak: " << options.duration << " s against " << config.video.source << std::endl;
+    
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        if (elapsed >= options.duration) break;
+        double dt = std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+        
+        // Sweep the stick; a press and release on the next tick toggles recording
+        if (virtualStick) {
+            SDL_JoystickSetVirtualAxis(virtualStick, 0, static_cast<Sint16>(30000 * std::sin(elapsed * 0.7)));
+            SDL_JoystickSetVirtualAxis(virtualStick, 1, static_cast<Sint16>(30000 * std::cos(elapsed * 0.4)));
+            SDL_JoystickSetVirtualAxis(virtualStick, 2, static_cast<Sint16>(30000 * std::sin(elapsed * 0.1)));
+            if (buttonHeld) {
+                SDL_JoystickSetVirtualButton(virtualStick, 0, SDL_RELEASED);
+                buttonHeld = false;
+            } else if (elapsed >= nextToggle) {
+                SDL_JoystickSetVirtualButton(virtualStick, 0, SDL_PRESSED);
+                buttonHeld = true;
+                nextToggle += options.cycleSeconds;
+            }
+        } else if (elapsed >= nextToggle) {
+            if (recorder.isRecording()) stopRecording(); else startRecording();
+            nextToggle += options.cycleSeconds;
+        }
+        
+        joystick.update();
+        const JoystickState& stick = joystick.getState();
+        gimbal.update(stick.getPan(), stick.getTilt(), stick.connected ? stick.getZoom() : -1.0f, dt);
+        
+        if (video.getFrame(frame, sequence) && sequence != lastSequence) {
+            lastSequence = sequence;
+            effects.apply(frame, gimbal.getState(), GroundPoint(), sequence);
+            detector.submit(frame, sequence);
+            detector.getResult(detections);
+            
+            displayFrame = frame.clone();
+            if (detector.isRunning()) {
+                hud.setDetections(detections, detector.getStats(), sequence);
+            }
+            hud.setGimbal(gimbal.getState());
+            hud.render(displayFrame, stick, recorder.isRecording());
+            
+            if (recorder.isRecording()) {
+                recorder.writeFrame(frame, displayFrame);
+                framesIn++;
+                totalIn++;
+            }
+        }
+        
+        // Forced faults: drop and reopen the source, unplug and replug the stick
+        if (elapsed >= nextReconnect) {
+            video.shutdown();
+            if (!video.init(config.video, config.playback, config.frame_bus)) {
+                std::cerr << "Soak: FAIL reconnect " << reconnects + 1 << std::endl;
+                failures++;
+                break;
+            }
+            lastSequence = 0;
+            reconnects++;
+            nextReconnect += options.reconnectSeconds;
+        }
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+        if (virtualStick && elapsed >= nextReplug && !buttonHeld) {
+            SDL_JoystickClose(virtualStick);
+            SDL_JoystickDetachVirtual(virtualIndex);
+            joystick.update();
+            virtualIndex = SDL_JoystickAttachVirtual(SDL_JOYSTICK_TYPE_GAMECONTROLLER, 3, 4, 1);
+            virtualStick = virtualIndex >= 0 ? SDL_JoystickOpen(virtualIndex) : nullptr;
+            replugs++;
+            nextReplug += options.replugSeconds;
+        }
+#endif
+        
+        if (elapsed >= nextSample) {
+            Sample s{elapsed, sampleProcess(), recorder.isRecording(), totalIn,
+                     metricValue("sar_recorder_frames_total"), metricValue("sar_recorder_dropped_frames_total"),
+                     reconnects, replugs};
+            samples.push_back(s);
+            report << s.elapsed << ',' << s.stats.rssMb << ',' << s.stats.fds << ',' << s.stats.threads << ','
+                   << s.recording << ',' << s.framesIn << ',' << s.framesWritten << ',' << s.framesDropped << ','
+                   << s.reconnects << ',' << s.replugs << '\n';
+            report.flush();
+            nextSample += options.sampleSeconds;
+        }
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    
+    if (recorder.isRecording()) {
+        stopRecording();
+    }
+    
+    // Compare idle samples (recorder stopped) after warm-up with the first of them
+    const Sample* baseline = nullptr;
+    const Sample* peak = nullptr;
+    for (const auto& s : samples) {
+        if (s.recording || s.elapsed < options.warmupSeconds) continue;
+        if (!baseline) baseline = &s;
+        if (!peak || s.stats.rssMb > peak->stats.rssMb) peak = &s;
+        
+        if (s.stats.fds >= 0 && s.stats.fds > baseline->stats.fds + options.fdSlack) {
+            std::cerr << "Soak: FAIL fds " << baseline->stats.fds << " -> " << s.stats.fds
+                      << " at " << s.elapsed << " s" << std::endl;
+            failures++;
+            break;
+        }
+        if (s.stats.threads >= 0 && s.stats.threads > baseline->stats.threads + options.threadSlack) {
+            std::cerr << "Soak: FAIL threads " << baseline->stats.threads << " -> " << s.stats.threads
+                      << " at " << s.elapsed << " s" << std::endl;
+            failures++;
+            break;
+        }
+    }
+    if (baseline && peak && baseline->stats.rssMb >= 0 &&
+        peak->stats.rssMb - baseline->stats.rssMb > options.maxRssGrowthMb) {
+        std::cerr << "Soak: FAIL RSS " << baseline->stats.rssMb << " MB -> " << peak->stats.rssMb
+                  << " MB at " << peak->elapsed << " s" << std::endl;
+        failures++;
+    }
+    if (!baseline) {
+        std::cerr << "Soak: FAIL no idle samples after warm-up; run longer or shorten --cycle" << std::endl;
+        failures++;
+    }
+    if (recordings == 0 || totalIn == 0) {
+        std::cerr << "Soak: FAIL nothing was recorded" << std::endl;
+        failures++;
+    }
+    
+    recorder.stop();
+    detector.shutdown();
+    video.shutdown();
+    joystick.shutdown();
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    if (virtualStick) {
+        SDL_JoystickClose(virtualStick);
+        SDL_JoystickDetachVirtual(virtualIndex);
+    }
+#endif
+    SDL_Quit();
+    
+    std::error_code ec;
+    fs::remove_all(workDir, ec);
+    
+    std::cout << "Soak: " << recordings << " recordings (" << startFailures << " failed to start), "
+              << totalIn << " frames, " << reconnects
+              << " reconnects, " << replugs << " replugs; report " << options.report << std::endl;
+    if (baseline && peak) {
+        std::cout << "Soak: RSS " << baseline->stats.rssMb << " -> " << peak->stats.rssMb << " MB peak, fds "
+                  << baseline->stats.fds << ", threads " << baseline->stats.threads << std::endl;
+    }
+    std::cout << (failures == 0 ? "Soak: PASS" : "Soak: FAIL") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Unit checks for pieces whose contract is easy to break silently: wire formats,
+// sign conventions and file formats. Each check prints what it compared; the exit
+// status is the number of failures.
+//
+// Registered with ctest (ctest -L unit); runs in a few seconds without hardware.
+
+#include <iostream>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "gimbal.h"
+#include "gimbal_link.h"
+#include "governor.h"
+#include "raw_recorder.h"
+
+using namespace sar;
+
+static int g_failures = 0;
+
+#define CHECK(cond, what)                                                               \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::cerr << "  FAIL " << (what) << " (" << #cond << ")" << std::endl;      \
+            g_failures++;                                                               \
+        }                                                                               \
+    } while (0)
+
+static float readF32(const uint8_t* p) {
+    uint32_t bits = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                    (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Rate mode must move a real payload the same way the simulated gimbal moves
+static void testGimbalLinkTiltSign() {
+    GimbalConfig config;
+    for (float stick : {1.0f, -0.5f}) {
+        Gimbal gimbal;
+        gimbal.init(config);
+        float before = gimbal.getState().tilt;
+        gimbal.update(0.0f, stick, -1.0f, 0.1);
+        const GimbalState& state = gimbal.getState();
+        float simulated = state.tilt - before;
+        
+        uint8_t packet[kGimbalPacketSize] = {};
+        encodeGimbalCommand(packet, state, config, false, 0, 0);
+        float wireRate = readF32(packet + 24);
+        
+        CHECK(packet[5] == 0, "rate mode flag");
+        CHECK(simulated != 0.0f, "simulated gimbal moved");
+        CHECK((wireRate > 0.0f) == (simulated > 0.0f), "rate-mode tilt sign follows Gimbal::update");
+        CHECK(std::abs(wireRate - simulated / 0.1f) < 1e-3f, "rate-mode tilt magnitude (deg/s)");
+    }
+}
+
+// A source switching between substream and main stream mid-recording must not
+// lose frames; they are scaled to the session's first geometry
+static void testRawRecorderGeometryChange() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "sar_unit_raw";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    
+    RecordingConfig config;
+    config.output_dir = dir.string();
+    config.raw_workers = 2;
+    config.raw_chunk_mb = 16;
+    
+    RawRecorder recorder;
+    const std::string base = (dir / "session").string();
+    CHECK(recorder.start(base, 30.0, config), "raw recorder started");
+    
+    // Twelve frames stay under raw_queue_frames, so none is dropped for back-pressure
+    const cv::Size sizes[] = {{640, 360}, {1920, 1080}, {640, 360}};
+    int submitted = 0;
+    for (const cv::Size& size : sizes) {
+        for (int i = 0; i < 4; i++) {
+            cv::Mat frame(size, CV_8UC3, cv::Scalar(40 * i, 80, 120));
+            CHECK(recorder.submit(frame), "frame accepted at " + std::to_string(size.width) + "x" +
+                                          std::to_string(size.height));
+            submitted++;
+        }
+    }
+    recorder.stop();
+    
+    RawReader reader;
+    CHECK(reader.open(base + "_raw_0000.sarraw"), "raw session opens");
+    CHECK(reader.frameCount() == static_cast<uint64_t>(submitted), "every frame written");
+    CHECK(reader.getWidth() == 640 && reader.getHeight() == 360, "session keeps the first geometry");
+    
+    cv::Mat frame;
+    for (uint64_t n = 0; n < reader.frameCount(); n++) {
+        CHECK(reader.read(n, frame) && frame.cols == 640 && frame.rows == 360,
+              "frame " + std::to_string(n) + " decodes at session size");
+    }
+    reader.close();
+    fs::remove_all(dir);
+}
+
+// A damaged chunk must never be read outside its mapping: a corrupt footer entry
+// falls back to the record walk, and a truncated chunk keeps only whole records
+static void testRawReaderRejectsCorruptIndex() {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "sar_unit_raw_corrupt";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    
+    RecordingConfig config;
+    config.output_dir = dir.string();
+    config.raw_chunk_mb = 16;
+    
+    RawRecorder recorder;
+    const std::string base = (dir / "session").string();
+    CHECK(recorder.start(base, 30.0, config), "raw recorder started");
+    for (int i = 0; i < 4; i++) {
+        recorder.submit(cv::Mat(cv::Size(320, 240), CV_8UC3, cv::Scalar(30 * i, 60, 90)));
+    }
+    recorder.stop();
+    
+    const std::string path = base + "_raw_0000.sarraw";
+    const uint64_t size = fs::file_size(path);
+    RawChunkFooter footer{};
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(size - sizeof(footer)));
+        in.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+    }
+    CHECK(footer.count == 4, "chunk has a footer index");
+    
+    // Point the second entry far past the end of the file
+    {
+        std::fstream io(path, std::ios::binary | std::ios::in | std::ios::out);
+        const uint64_t bogus = ~0ull - 8;
+        io.seekp(static_cast<std::streamoff>(footer.indexOffset + sizeof(RawIndexEntry)));
+        io.write(reinterpret_cast<const char*>(&bogus), sizeof(bogus));
+    }
+    cv::Mat frame;
+    {
+        RawReader reader;
+        CHECK(reader.open(path), "chunk with a corrupt index opens");
+        CHECK(reader.frameCount() == 4, "corrupt index replaced by the record walk");
+        for (uint64_t n = 0; n < reader.frameCount(); n++) {
+            CHECK(reader.read(n, frame), "frame " + std::to_string(n) + " decodes after recovery");
+        }
+    }
+    
+    // Cut the chunk inside the third record: no footer, two whole records
+    fs::resize_file(path, footer.indexOffset / 2 + 1);
+    {
+        RawReader reader;
+        CHECK(reader.open(path), "truncated chunk opens");
+        CHECK(reader.frameCount() < 4, "partial record not indexed");
+        for (uint64_t n = 0; n < reader.frameCount(); n++) {
+            CHECK(reader.read(n, frame), "whole frame " + std::to_string(n) + " decodes");
+        }
+        CHECK(!reader.read(reader.frameCount(), frame), "read past the end fails");
+    }
+    fs::remove_all(dir);
+}
+
+// The stage over its own share is shed before earlier steps in shed_order, and
+// restored first when the load falls
+static void testGovernorShedsStageOverBudget() {
+    GovernorConfig config;
+    config.enabled = true;
+    config.target_fps = 100.0;      // 10 ms budget
+    config.degrade_seconds = 0.0;
+    config.restore_seconds = 0.0;
+    
+    Governor governor;
+    CHECK(governor.init(config, 30.0), "governor enabled");
+    
+    // 12 ms frames, 6 ms of it in effects (share 0.3 = 3 ms); hud_rate is first in order
+    GovernorCosts costs;
+    costs[GovernorStep::HudRate] = 1.0;
+    costs[GovernorStep::Effects] = 6.0;
+    for (int i = 0; i < 100 && governor.state().level == 0; i++) {
+        governor.update(12.0, costs);
+    }
+    CHECK(governor.state().level == 1, "one step shed");
+    CHECK(governor.state().reducedEffects, "effects shed first: over its own budget");
+    CHECK(governor.state().hudInterval == 1, "hud_rate kept: within its budget");
+    
+    // Still over with effects within budget: falls back to shed_order
+    costs[GovernorStep::Effects] = 1.0;
+    for (int i = 0; i < 100 && governor.state().level == 1; i++) {
+        governor.update(12.0, costs);
+    }
+    CHECK(governor.state().level == 2 && governor.state().hudInterval > 1, "then the next step in shed_order");
+    
+    // Light frames restore the last shed first
+    for (int i = 0; i < 100 && governor.state().level == 2; i++) {
+        governor.update(2.0, costs);
+    }
+    CHECK(governor.state().level == 1 && governor.state().reducedEffects && governor.state().hudInterval == 1,
+          "hud_rate restored before effects");
+}
+
+int main() {
+    const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+        {"gimbal_link_tilt_sign", testGimbalLinkTiltSign},
+        {"raw_recorder_geometry_change", testRawRecorderGeometryChange},
+        {"raw_reader_corrupt_index", testRawReaderRejectsCorruptIndex},
+        {"governor_stage_budgets", testGovernorShedsStageOverBudget},
+    };
+    
+    for (const auto& [name, test] : tests) {
+        int before = g_failures;
+        test();
+        std::cout << (g_failures == before ? "PASS " : "FAIL ") << name << std::endl;
+    }
+    return g_failures;
+}